@@ -0,0 +1,140 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "engine_context.h"
+#include "io_util.h"
+#include "mapped_archive.h"
+#include "timer.h"
+
+// Compares descriptor (batch) loading through readFile() + VectorArchive
+// against MappedFile + MappedArchive.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) file type: descriptor or batch,
+    // 2) number of iterations,
+    // 3) paths to files saved by example7.
+    if (argc < 4 || (strcmp(argv[1], "descriptor") != 0 && strcmp(argv[1], "batch") != 0)) {
+        std::cout << "Usage: " << argv[0] << " <descriptor|batch> <iterations> <file> [file ...]\n"
+                " *descriptor|batch - type of saved object\n"
+                " *iterations - number of passes over all files\n"
+                " *file - path to .xpk file\n"
+                << std::endl;
+        return -1;
+    }
+    const bool isBatch = strcmp(argv[1], "batch") == 0;
+    int iterations = atoi(argv[2]);
+    if (iterations < 1)
+        iterations = 1;
+    std::vector<std::string> paths(argv + 3, argv + argc);
+
+    EngineContext engineContext;
+    if (!engineContext.init(EngineContext::Settings()))
+        return -1;
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    if (!descriptorFactory)
+        return -1;
+
+    fsdk::IDescriptorPtr descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+    if (!descriptor) {
+        vlf::log::error("Failed to create face descriptor instance.");
+        return -1;
+    }
+
+    // Batch capacity is bounded by the largest file over a descriptor size.
+    fsdk::IDescriptorBatchPtr descriptorBatch;
+    if (isBatch) {
+        size_t maxFileSize = 0;
+        for (const std::string &path : paths) {
+            MappedFile file;
+            if (!file.open(path))
+                return -1;
+            maxFileSize = std::max(maxFileSize, file.size());
+        }
+        const size_t descriptorLength = std::max<size_t>(1, descriptor->getDescriptorLength());
+        descriptorBatch = fsdk::acquire(descriptorFactory->createDescriptorBatch(
+                fsdk::DT_CNN,
+                static_cast<int>(maxFileSize / descriptorLength + 1)
+        ));
+        if (!descriptorBatch) {
+            vlf::log::error("Failed to create face descriptor batch instance.");
+            return -1;
+        }
+    }
+    fsdk::ISerializableObject *object = isBatch ?
+            static_cast<fsdk::ISerializableObject*>(descriptorBatch.get()) :
+            static_cast<fsdk::ISerializableObject*>(descriptor.get());
+
+    auto loadVector = [&](const std::string &path) -> bool {
+        std::vector<uint8_t> data = readFile(path);
+        VectorArchive archive(data);
+        return object->load(&archive);
+    };
+
+    auto loadMapped = [&](const std::string &path, bool populate) -> bool {
+        MappedFile file;
+        if (!file.open(path, MappedFile::AccessSequential, populate))
+            return false;
+        MappedArchive archive(file);
+        return object->load(&archive);
+    };
+
+    std::printf("%-24s %12s %14s\n", "method", "total ms", "us per file");
+
+    auto report = [&](const char *name, double ms) {
+        const double files = static_cast<double>(iterations) * paths.size();
+        std::printf("%-24s %12.2f %14.2f\n", name, ms, 1000.0 * ms / files);
+    };
+
+    // Untimed pass over all files, so every method reads from a warm page
+    // cache and the first one does not pay for the disk alone.
+    for (const std::string &path : paths) {
+        if (!loadVector(path)) {
+            vlf::log::error("Failed to load \"%s\".", path.c_str());
+            return -1;
+        }
+    }
+
+    Timer timer;
+    for (int i = 0; i < iterations; ++i) {
+        for (const std::string &path : paths) {
+            if (!loadVector(path)) {
+                vlf::log::error("Failed to load \"%s\".", path.c_str());
+                return -1;
+            }
+        }
+    }
+    report("VectorArchive", timer.elapsedMs());
+
+    timer.reset();
+    for (int i = 0; i < iterations; ++i) {
+        for (const std::string &path : paths) {
+            if (!loadMapped(path, false)) {
+                vlf::log::error("Failed to load \"%s\".", path.c_str());
+                return -1;
+            }
+        }
+    }
+    report("MappedArchive", timer.elapsedMs());
+
+    timer.reset();
+    for (int i = 0; i < iterations; ++i) {
+        for (const std::string &path : paths) {
+            if (!loadMapped(path, true)) {
+                vlf::log::error("Failed to load \"%s\".", path.c_str());
+                return -1;
+            }
+        }
+    }
+    report("MappedArchive+populate", timer.elapsedMs());
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <vector>
+
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "estimation_batcher.h"
+#include "timer.h"
+
+namespace {
+
+enum { MaxDetections = 10 };
+
+// Detection confidence threshold of the examples.
+const float ConfidenceThreshold = 0.25f;
+
+}
+
+// Throughput of quality and complex estimation over the warps of many faces
+// from several images: one warp at a time as in the examples' face loop
+// against EstimationBatcher with batch sizes 1, 8, 32 and 128.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) number of warps estimated per run,
+    // 2) longest wait for a partial batch in milliseconds,
+    // 3) paths to PPM images.
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <warps> <maxWaitMs> <image.ppm> [image.ppm ...]\n"
+                " *warps - number of warps estimated per run, faces of the images are repeated\n"
+                " *maxWaitMs - longest wait for a partial batch\n"
+                " *image - path to PPM image with faces\n"
+                << std::endl;
+        return -1;
+    }
+    const int warpsCount = std::max(1, atoi(argv[1]));
+    const int maxWaitMs = std::max(0, atoi(argv[2]));
+
+    // Bring the models up and warm them up before anything is timed.
+    EngineContext::Settings engineSettings;
+    engineSettings.preload = true;
+    engineSettings.useExtractor = false;
+    engineSettings.useMatcher = false;
+    engineSettings.useEstimators = true;
+    EngineContext engineContext;
+    if (!engineContext.init(engineSettings))
+        return -1;
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    fsdk::IQualityEstimatorPtr qualityEstimator = engineContext.getQualityEstimator();
+    fsdk::IComplexEstimatorPtr complexEstimator = engineContext.getComplexEstimator();
+    if (!detector || !featureFactory || !warper || !qualityEstimator || !complexEstimator)
+        return -1;
+
+    // Warps of every confident face of every image.
+    std::vector<fsdk::Image> faceWarps;
+    for (int i = 3; i < argc; ++i) {
+        fsdk::Image image;
+        if (!image.loadFromPPM(argv[i])) {
+            vlf::log::error("Failed to load image: \"%s\".", argv[i]);
+            return -1;
+        }
+        fsdk::Detection detections[MaxDetections];
+        fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
+        const int detectionsCount = detectFaces(detector, image, 0, &detections[0], &landmarks[0], MaxDetections);
+        if (detectionsCount < 0)
+            return -1;
+        for (int j = 0; j < detectionsCount; ++j) {
+            if (detections[j].score < ConfidenceThreshold)
+                continue;
+            fsdk::IFeatureSetPtr featureSet =
+                    fsdk::acquire(featureFactory->createFeatureSet(landmarks[j], detections[j].score));
+            fsdk::Image warp;
+            if (!featureSet || warper->warp(image, detections[j], featureSet, warp).isError()) {
+                vlf::log::error("Failed to create warped face.");
+                return -1;
+            }
+            faceWarps.push_back(warp);
+        }
+    }
+    if (faceWarps.empty()) {
+        vlf::log::error("No confident faces found.");
+        return -1;
+    }
+
+    // Warm up both estimators.
+    float quality;
+    fsdk::ComplexEstimation complexEstimation;
+    if (qualityEstimator->estimate(faceWarps[0], &quality).isError() ||
+        complexEstimator->estimate(faceWarps[0], complexEstimation).isError()) {
+        vlf::log::error("Failed to estimate warp.");
+        return -1;
+    }
+
+    std::printf("%d warp(s) from %d face(s), max wait %d ms\n",
+            warpsCount, static_cast<int>(faceWarps.size()), maxWaitMs);
+    std::printf("%-12s %12s %10s %10s %12s\n", "mode", "warps/sec", "batches", "full", "speedup");
+
+    // One warp at a time, both estimators in turn.
+    Timer timer;
+    for (int i = 0; i < warpsCount; ++i) {
+        const fsdk::Image &warp = faceWarps[i % faceWarps.size()];
+        if (qualityEstimator->estimate(warp, &quality).isError() ||
+            complexEstimator->estimate(warp, complexEstimation).isError()) {
+            vlf::log::error("Failed to estimate warp.");
+            return -1;
+        }
+    }
+    const double interleavedRate = warpsCount / timer.elapsedSec();
+    std::printf("%-12s %12.1f %10s %10s %11.2fx\n", "per face", interleavedRate, "-", "-", 1.0);
+
+    const int batchSizes[] = { 1, 8, 32, 128 };
+    for (int batchSize : batchSizes) {
+        EstimationBatcher::Settings settings;
+        settings.batchSize = batchSize;
+        settings.maxWaitMs = maxWaitMs;
+        EstimationBatcher batcher;
+        if (!batcher.start(qualityEstimator, complexEstimator, settings))
+            return -1;
+
+        std::vector<std::future<EstimationBatcher::Estimation>> estimations;
+        estimations.reserve(warpsCount);
+        timer.reset();
+        for (int i = 0; i < warpsCount; ++i)
+            estimations.push_back(batcher.submit(faceWarps[i % faceWarps.size()]));
+        for (std::future<EstimationBatcher::Estimation> &estimation : estimations) {
+            if (estimation.get().failed)
+                return -1;
+        }
+        const double rate = warpsCount / timer.elapsedSec();
+        batcher.stop();
+
+        const EstimationBatcher::Stats stats = batcher.getStats();
+        std::printf("batch %-6d %12.1f %10d %10d %11.2fx\n",
+                batchSize, rate, stats.batches, stats.fullBatches, rate / interleavedRate);
+    }
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "descriptor_matrix.h"
+#include "descriptor_synthesizer.h"
+#include "engine_context.h"
+#include "timer.h"
+
+// Compares 1:N matching through IDescriptorMatcher with BruteForceMatcher.
+// A gallery of the requested size is synthesized from noisy copies of the
+// descriptors of a gallery file (see example7). Queries are noisy copies of
+// random gallery members, so they match none of the rows exactly and the
+// agreement of both top-k lists is a real check.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to a gallery file,
+    // 2) number of gallery descriptors (default: 100000),
+    // 3) number of queries (default: 100),
+    // 4) number of nearest neighbors (default: 10),
+    // 5) noise added to seed descriptors (default: 0.05).
+    if (argc < 2 || argc > 6) {
+        std::cout << "Usage: " << argv[0] << " <gallery> [gallerySize] [queries] [k] [noise]\n"
+                " *gallery - path to gallery file with seed descriptors\n"
+                " *gallerySize - number of descriptors to search\n"
+                " *queries - number of queries\n"
+                " *k - number of nearest neighbors\n"
+                " *noise - standard deviation of noise per descriptor value\n"
+                << std::endl;
+        return -1;
+    }
+    const char *galleryPath = argv[1];
+    const int gallerySize = argc > 2 ? atoi(argv[2]) : 100000;
+    const int queriesCount = argc > 3 ? atoi(argv[3]) : 100;
+    const int k = argc > 4 ? atoi(argv[4]) : 10;
+    const float noise = argc > 5 ? static_cast<float>(atof(argv[5])) : 0.05f;
+    if (gallerySize < 1 || queriesCount < 1 || k < 1 || k > gallerySize || noise < 0.f) {
+        vlf::log::error("Invalid arguments.");
+        return -1;
+    }
+
+    EngineContext::Settings settings;
+    settings.useExtractor = false;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
+        return -1;
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    fsdk::IDescriptorMatcherPtr descriptorMatcher = engineContext.getMatcher();
+    if (!descriptorFactory || !descriptorMatcher)
+        return -1;
+
+    DescriptorSynthesizer synthesizer;
+    if (!synthesizer.init(descriptorFactory, galleryPath))
+        return -1;
+    const DescriptorMatrix &seeds = synthesizer.getSeeds();
+    const int dimension = seeds.getDimension();
+    std::mt19937 random(42);
+    std::vector<float> values(seeds.getStride(), 0.f);
+
+    // Build the batch and its float mirror from noisy copies of the seeds.
+    fsdk::IDescriptorBatchPtr descriptorBatch =
+            fsdk::acquire(descriptorFactory->createDescriptorBatch(fsdk::DT_CNN, gallerySize));
+    if (!descriptorBatch) {
+        vlf::log::error("Failed to create face descriptor batch instance.");
+        return -1;
+    }
+    DescriptorMatrix matrix;
+    matrix.reserve(gallerySize);
+    for (int i = 0; i < gallerySize; ++i) {
+        perturb(seeds.getRow(i % seeds.getCount()), dimension, noise, random, &values[0]);
+        if (!synthesizer.create(&values[0]) ||
+                descriptorBatch->add(synthesizer.getDescriptor()).isError() ||
+                !matrix.add(synthesizer.getDescriptor())) {
+            vlf::log::error("Failed to build gallery.");
+            return -1;
+        }
+    }
+
+    // Queries: half the gallery noise around random gallery members.
+    // Every query gets its own descriptor, so only the search itself is timed.
+    std::uniform_int_distribution<int> pick(0, gallerySize - 1);
+    DescriptorMatrix queries;
+    queries.reserve(queriesCount);
+    std::vector<fsdk::IDescriptorPtr> queryDescriptors(queriesCount);
+    for (int q = 0; q < queriesCount; ++q) {
+        perturb(matrix.getRow(pick(random)), dimension, noise * 0.5f, random, &values[0]);
+        queryDescriptors[q] = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+        if (!queryDescriptors[q] || !synthesizer.create(&values[0], queryDescriptors[q]) ||
+                !queries.add(queryDescriptors[q])) {
+            vlf::log::error("Failed to create queries.");
+            return -1;
+        }
+    }
+
+    std::printf("gallery: %d, queries: %d, k: %d, dimension: %d, noise: %.3f\n",
+            gallerySize, queriesCount, k, dimension, noise);
+    std::printf("%-28s %12s %16s\n", "method", "ms/query", "Mdescriptors/s");
+
+    auto report = [&](const char *name, double ms) {
+        const double perQuery = ms / queriesCount;
+        std::printf("%-28s %12.3f %16.2f\n", name, perQuery, gallerySize / perQuery / 1000.0);
+    };
+
+    // SDK matcher over the whole batch; its k best rows are the reference.
+    std::vector<fsdk::MatchingResult> results(gallerySize);
+    std::vector<int> order(gallerySize);
+    std::vector<std::vector<int>> sdkTop(queriesCount);
+    std::vector<std::vector<float>> sdkScores(queriesCount);
+    double sdkMs = 0.0;
+    Timer timer;
+    for (int q = 0; q < queriesCount; ++q) {
+        timer.reset();
+        fsdk::Result<fsdk::FSDKError> descriptorMatcherResult = descriptorMatcher->match(
+                queryDescriptors[q],
+                descriptorBatch,
+                &results[0]
+        );
+        if (descriptorMatcherResult.isError()) {
+            vlf::log::error("Failed to match. Reason: %s.", descriptorMatcherResult.what());
+            return -1;
+        }
+        sdkMs += timer.elapsedMs();
+
+        for (int i = 0; i < gallerySize; ++i)
+            order[i] = i;
+        std::partial_sort(order.begin(), order.begin() + k, order.end(), [&](int a, int b) {
+            return results[a].similarity > results[b].similarity;
+        });
+        sdkTop[q].assign(order.begin(), order.begin() + k);
+        for (int i = 0; i < k; ++i)
+            sdkScores[q].push_back(results[order[i]].similarity);
+    }
+    report("IDescriptorMatcher", sdkMs);
+
+    // Distance ranking with every kernel this CPU supports.
+    std::vector<int> indices(k);
+    const SimdLevel bestLevel = detectSimdLevel();
+    for (int level = SimdNone; level <= bestLevel; ++level) {
+        BruteForceMatcher matcher(matrix, static_cast<SimdLevel>(level));
+        timer.reset();
+        for (int q = 0; q < queriesCount; ++q)
+            matcher.search(queries.getRow(q), k, &indices[0]);
+        std::string name = std::string("search ") + simdLevelName(static_cast<SimdLevel>(level));
+        report(name.c_str(), timer.elapsedMs());
+    }
+
+    // Full match: ranking plus SDK scoring of k results.
+    BruteForceMatcher matcher(matrix);
+    std::vector<fsdk::MatchingResult> topResults(k);
+    int topAgreements = 0;
+    int overlap = 0;
+    double maxScoreError = 0.0;
+    double matchMs = 0.0;
+    for (int q = 0; q < queriesCount; ++q) {
+        timer.reset();
+        const int found = matcher.match(
+                queryDescriptors[q],
+                descriptorBatch,
+                descriptorMatcher,
+                k,
+                &indices[0],
+                &topResults[0]
+        );
+        matchMs += timer.elapsedMs();
+        if (found < 0)
+            return -1;
+
+        if (found > 0 && indices[0] == sdkTop[q][0])
+            ++topAgreements;
+        for (int i = 0; i < found; ++i) {
+            if (std::find(sdkTop[q].begin(), sdkTop[q].end(), indices[i]) != sdkTop[q].end())
+                ++overlap;
+            maxScoreError = std::max(maxScoreError,
+                    static_cast<double>(std::abs(topResults[i].similarity - sdkScores[q][i])));
+        }
+    }
+    report("match (search + SDK score)", matchMs);
+
+    std::printf("top-1 agreement with IDescriptorMatcher: %d/%d\n", topAgreements, queriesCount);
+    std::printf("top-%d overlap with IDescriptorMatcher: %.4f\n", k,
+            static_cast<double>(overlap) / (static_cast<double>(queriesCount) * k));
+    std::printf("max similarity difference at equal rank: %.6f\n", maxScoreError);
+
+    return 0;
+}
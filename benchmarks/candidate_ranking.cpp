@@ -0,0 +1,200 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "candidate_ranking.h"
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "timer.h"
+
+namespace {
+
+enum { MaxDetections = 10 };
+
+// Facial feature detection confidence threshold of example1.
+const float ConfidenceThreshold = 0.25f;
+
+struct Faces {
+    fsdk::Image imageR;
+    fsdk::Detection detections[MaxDetections];
+    int count = 0;
+};
+
+// Totals of one policy over all images.
+struct Totals {
+    int featureDetections = 0;
+    int chosenFaces = 0;
+    int sameFaces = 0;
+    double confidenceSum = 0.0;
+    double ms = 0.0;
+};
+
+// Pick a face the way example1 does: detect facial features of the ranked
+// candidates and take the first confident one, or with RankingNone the most
+// confident of all. chosen is -1 when no face is confident enough.
+bool chooseFace(
+        const fsdk::IFeatureDetectorPtr &featureDetector,
+        const fsdk::IFeatureSetPtr &featureSet,
+        const Faces &faces,
+        RankingPolicy policy,
+        int maxCandidates,
+        int &chosen,
+        float &confidence,
+        int &featureDetections
+) {
+    const std::vector<int> candidates =
+            rankDetections(faces.detections, faces.count, policy, faces.imageR.getRect());
+    const int candidatesCount = maxCandidates > 0 ? std::min(maxCandidates, faces.count) : faces.count;
+
+    chosen = -1;
+    confidence = 0.f;
+    for (int i = 0; i < candidatesCount; ++i) {
+        const int index = candidates[i];
+        fsdk::Result<fsdk::FSDKError> featureSetResult =
+                featureDetector->detect(faces.imageR, faces.detections[index], featureSet);
+        if (featureSetResult.isError()) {
+            vlf::log::error("Failed to detect feature set. Reason: %s.", featureSetResult.what());
+            return false;
+        }
+        ++featureDetections;
+
+        const float featureConfidence = featureSet->getConfidence();
+        if (featureConfidence < ConfidenceThreshold || featureConfidence <= confidence)
+            continue;
+        chosen = index;
+        confidence = featureConfidence;
+        if (policy != RankingNone)
+            break;
+    }
+    return true;
+}
+
+}
+
+// Cost of the facial feature stage of example1 on multi-face images: VGG
+// feature detection of every detection against candidates ranked by score,
+// rect area or center prior, stopping at the first confident one. Reports
+// feature detections and time per image and how often the same face as the
+// exhaustive search is chosen.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) number of candidates tried, 0 for all,
+    // 2) number of iterations,
+    // 3) paths to PPM images.
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <candidates> <iterations> <image.ppm> [image.ppm ...]\n"
+                " *candidates - number of ranked faces tried, 0 for all\n"
+                " *iterations - number of runs per image and policy\n"
+                " *image - path to PPM image, preferably with several faces\n"
+                << std::endl;
+        return -1;
+    }
+    const int maxCandidates = std::max(0, atoi(argv[1]));
+    const int iterations = std::max(1, atoi(argv[2]));
+
+    EngineContext::Settings settings;
+    settings.detectorType = fsdk::ODT_DPM;
+    settings.preload = true;
+    settings.useFeatureDetector = true;
+    settings.useWarper = false;
+    settings.useExtractor = false;
+    settings.useMatcher = false;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
+        return -1;
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IFeatureDetectorPtr featureDetector = engineContext.getFeatureDetector();
+    if (!detector || !featureFactory || !featureDetector)
+        return -1;
+    fsdk::IFeatureSetPtr featureSet = fsdk::acquire(featureFactory->createFeatureSet());
+    if (!featureSet) {
+        vlf::log::error("Failed to create face feature set instance.");
+        return -1;
+    }
+
+    // Detect faces once; only the feature stage is measured.
+    std::vector<Faces> images;
+    int facesCount = 0;
+    for (int i = 3; i < argc; ++i) {
+        fsdk::Image image;
+        if (!image.loadFromPPM(argv[i])) {
+            vlf::log::error("Failed to load image: \"%s\".", argv[i]);
+            return -1;
+        }
+        Faces faces;
+        image.convert(faces.imageR, fsdk::Format::R8);
+        if (!faces.imageR) {
+            vlf::log::error("Conversion to grayscale has failed.");
+            return -1;
+        }
+        faces.count = detectFaces(detector, faces.imageR, 0, faces.detections, nullptr, MaxDetections);
+        if (faces.count < 0)
+            return -1;
+        facesCount += faces.count;
+        images.push_back(faces);
+    }
+    std::printf("%d image(s), %.1f faces per image, %d candidate(s), %d iteration(s)\n",
+            static_cast<int>(images.size()), static_cast<double>(facesCount) / images.size(),
+            maxCandidates, iterations);
+
+    // Faces chosen by the exhaustive search.
+    std::vector<int> reference(images.size());
+    for (size_t i = 0; i < images.size(); ++i) {
+        float confidence = 0.f;
+        int featureDetections = 0;
+        if (!chooseFace(featureDetector, featureSet, images[i], RankingNone, 0,
+                reference[i], confidence, featureDetections))
+            return -1;
+    }
+
+    std::printf("%-8s %12s %10s %9s %9s %11s\n",
+            "policy", "VGG/image", "ms/image", "speedup", "same face", "confidence");
+    double exhaustiveMs = 0.0;
+    const RankingPolicy policies[] = { RankingNone, RankingScore, RankingArea, RankingCenter };
+    for (RankingPolicy policy : policies) {
+        // The exhaustive search tries every face.
+        const int candidates = policy == RankingNone ? 0 : maxCandidates;
+        Totals totals;
+        for (size_t i = 0; i < images.size(); ++i) {
+            int chosen = -1;
+            float confidence = 0.f;
+            int featureDetections = 0;
+            Timer timer;
+            for (int iteration = 0; iteration < iterations; ++iteration) {
+                featureDetections = 0;
+                if (!chooseFace(featureDetector, featureSet, images[i], policy, candidates,
+                        chosen, confidence, featureDetections))
+                    return -1;
+            }
+            totals.ms += timer.elapsedMs() / iterations;
+            totals.featureDetections += featureDetections;
+            if (chosen >= 0) {
+                ++totals.chosenFaces;
+                totals.confidenceSum += confidence;
+            }
+            if (chosen == reference[i])
+                ++totals.sameFaces;
+        }
+        if (policy == RankingNone)
+            exhaustiveMs = totals.ms;
+
+        const double imagesCount = static_cast<double>(images.size());
+        std::printf("%-8s %12.2f %10.2f %8.2fx %8.1f%% %11.3f\n",
+                getRankingPolicyName(policy),
+                totals.featureDetections / imagesCount,
+                totals.ms / imagesCount,
+                totals.ms > 0.0 ? exhaustiveMs / totals.ms : 0.0,
+                100.0 * totals.sameFaces / imagesCount,
+                totals.chosenFaces > 0 ? totals.confidenceSum / totals.chosenFaces : 0.0);
+    }
+
+    return 0;
+}
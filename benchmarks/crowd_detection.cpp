@@ -0,0 +1,139 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "crowd_detector.h"
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "image_canvas.h"
+#include "timer.h"
+
+// Faces per second of detection plus feature set and warp of every kept face
+// on a dense scene: the fixed 10 face array of the examples against
+// CrowdDetector without pruning, with a minimal face size and with a top-N limit.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to a PPM image,
+    // 2) optional number of iterations,
+    // 3) optional minimal face side,
+    // 4) optional number of top faces,
+    // 5) optional canvas width and height.
+    if (argc < 2 || argc > 7 || argc == 6) {
+        std::cout << "Usage: " << argv[0] << " <image.ppm> [iterations] [minFace] [top] [width height]\n"
+                " *image - path to PPM image, repeated to fill the canvas\n"
+                " *iterations - number of runs per mode (default: 3)\n"
+                " *minFace - smallest face side kept by the pruning modes (default: 40)\n"
+                " *top - number of faces kept by the top-N mode (default: 20)\n"
+                " *width, height - canvas size (default: 3840x2160)\n"
+                << std::endl;
+        return -1;
+    }
+    const int iterations = std::max(1, argc > 2 ? atoi(argv[2]) : 3);
+    const int minFaceSize = argc > 3 ? atoi(argv[3]) : 40;
+    const int topCount = argc > 4 ? atoi(argv[4]) : 20;
+    const int width = argc > 6 ? atoi(argv[5]) : 3840;
+    const int height = argc > 6 ? atoi(argv[6]) : 2160;
+
+    fsdk::Image source;
+    if (!source.loadFromPPM(argv[1])) {
+        vlf::log::error("Failed to load image: \"%s\".", argv[1]);
+        return -1;
+    }
+    const fsdk::Image image = makeCanvas(source, width, height);
+    if (!image) {
+        vlf::log::error("Failed to create canvas.");
+        return -1;
+    }
+
+    // Bring the models up and warm them up before anything is timed.
+    EngineContext::Settings engineSettings;
+    engineSettings.preload = true;
+    engineSettings.useExtractor = false;
+    engineSettings.useMatcher = false;
+    EngineContext engineContext;
+    if (!engineContext.init(engineSettings))
+        return -1;
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    if (!detector || !featureFactory || !warper)
+        return -1;
+
+    std::vector<fsdk::Detection> detections;
+    std::vector<fsdk::IMTCNNDetector::Landmarks> landmarks;
+
+    // Feature set and warp of every face, the work pruning saves.
+    auto warpAll = [&](int count) -> bool {
+        for (int i = 0; i < count; ++i) {
+            fsdk::IFeatureSetPtr featureSet =
+                    fsdk::acquire(featureFactory->createFeatureSet(landmarks[i], detections[i].score));
+            fsdk::Image warp;
+            if (!featureSet || warper->warp(image, detections[i], featureSet, warp).isError())
+                return false;
+        }
+        return true;
+    };
+
+    // Fixed array of the examples.
+    auto runFixed = [&](int &detected) -> int {
+        enum { MaxDetections = 10 };
+        detections.resize(MaxDetections);
+        landmarks.resize(MaxDetections);
+        const int count = detectFaces(detector, image, 0, &detections[0], &landmarks[0], MaxDetections);
+        detected = count;
+        return count >= 0 && warpAll(count) ? count : -1;
+    };
+
+    auto runCrowd = [&](CrowdDetector &crowdDetector, int &detected) -> int {
+        const int count = crowdDetector.detect(image, detections, landmarks);
+        detected = crowdDetector.getStats().detected;
+        return count >= 0 && warpAll(count) ? count : -1;
+    };
+
+    CrowdDetector::Settings allSettings;
+    CrowdDetector::Settings minFaceSettings;
+    minFaceSettings.minFaceSize = minFaceSize;
+    CrowdDetector::Settings topSettings = minFaceSettings;
+    topSettings.topCount = topCount;
+    CrowdDetector crowdAll(detector, allSettings);
+    CrowdDetector crowdMinFace(detector, minFaceSettings);
+    CrowdDetector crowdTop(detector, topSettings);
+
+    std::printf("%dx%d canvas, %d iteration(s)\n", image.getWidth(), image.getHeight(), iterations);
+    std::printf("%-16s %9s %9s %10s %10s\n", "mode", "detected", "processed", "ms", "faces/sec");
+
+    auto report = [&](const char *mode, const std::function<int(int&)> &run) -> bool {
+        // The first run warms up and grows the buffers.
+        int detected = 0;
+        if (run(detected) < 0) {
+            vlf::log::error("Failed to process the canvas in mode %s.", mode);
+            return false;
+        }
+        int processed = 0;
+        Timer timer;
+        for (int i = 0; i < iterations; ++i)
+            processed = run(detected);
+        const double sec = timer.elapsedSec() / iterations;
+        std::printf("%-16s %9d %9d %10.1f %10.1f\n",
+                mode, detected, processed, sec * 1000.0, sec > 0.0 ? processed / sec : 0.0);
+        return true;
+    };
+
+    if (!report("fixed 10", runFixed) ||
+        !report("crowd", [&](int &detected) { return runCrowd(crowdAll, detected); }) ||
+        !report("crowd min face", [&](int &detected) { return runCrowd(crowdMinFace, detected); }) ||
+        !report("crowd top", [&](int &detected) { return runCrowd(crowdTop, detected); }))
+        return -1;
+
+    std::printf("crowd detection capacity grown to %d\n", crowdAll.getCapacity());
+
+    return 0;
+}
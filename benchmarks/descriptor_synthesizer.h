@@ -0,0 +1,108 @@
+#ifndef FACEENGINE_DESCRIPTOR_SYNTHESIZER_H
+#define FACEENGINE_DESCRIPTOR_SYNTHESIZER_H
+
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "descriptor_matrix.h"
+#include "gallery.h"
+#include "io_util.h"
+#include "mapped_archive.h"
+
+// Creates descriptors from float data.
+// Seeds are the real descriptors of a gallery file (see example7). The SDK
+// has no setter for raw descriptor data, so a serialized seed is used as a
+// template and its data block is overwritten.
+class DescriptorSynthesizer
+{
+public:
+    bool init(const fsdk::IDescriptorFactoryPtr &descriptorFactory, const std::string &galleryPath) {
+        bool loaded = GalleryFile::read(galleryPath, descriptorFactory,
+                [&](const fsdk::IDescriptorPtr &descriptor, const GalleryFile::Entry&) {
+                    if (m_blob.empty()) {
+                        VectorArchive vectorArchive(m_blob);
+                        if (!descriptor->save(&vectorArchive))
+                            return false;
+                    }
+                    return m_seeds.add(descriptor);
+                });
+        if (!loaded || m_seeds.getCount() == 0) {
+            vlf::log::error("Failed to load gallery: \"%s\".", galleryPath.c_str());
+            return false;
+        }
+        m_length = static_cast<uint32_t>(m_seeds.getDimension() * sizeof(float));
+
+        const uint8_t *data = reinterpret_cast<const uint8_t*>(m_seeds.getRow(0));
+        std::vector<uint8_t>::iterator it = std::search(m_blob.begin(), m_blob.end(), data, data + m_length);
+        if (it == m_blob.end()) {
+            vlf::log::error("Failed to locate descriptor data in serialized descriptor.");
+            return false;
+        }
+        m_offset = it - m_blob.begin();
+
+        m_descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+        if (!m_descriptor) {
+            vlf::log::error("Failed to create face descriptor instance.");
+            return false;
+        }
+
+        // Round trip the first seed to make sure the template is understood.
+        std::vector<float> check;
+        if (!create(m_seeds.getRow(0)) || !DescriptorMatrix::exportDescriptor(m_descriptor, check) ||
+                memcmp(check.data(), m_seeds.getRow(0), m_length) != 0) {
+            vlf::log::error("Unsupported descriptor serialization format.");
+            return false;
+        }
+        return true;
+    }
+
+    // Load data into the shared descriptor, valid until the next call.
+    bool create(const float *values) {
+        return create(values, m_descriptor);
+    }
+
+    // Load data into a descriptor of the caller.
+    bool create(const float *values, const fsdk::IDescriptorPtr &descriptor) {
+        memcpy(&m_blob[m_offset], values, m_length);
+        MappedArchive archive(m_blob.data(), m_blob.size());
+        if (!descriptor->load(&archive)) {
+            vlf::log::error("Failed to load descriptor.");
+            return false;
+        }
+        return true;
+    }
+
+    const fsdk::IDescriptorPtr &getDescriptor() const { return m_descriptor; }
+    const DescriptorMatrix &getSeeds() const { return m_seeds; }
+
+private:
+    DescriptorMatrix m_seeds;
+    std::vector<uint8_t> m_blob;
+    size_t m_offset = 0;
+    uint32_t m_length = 0;
+    fsdk::IDescriptorPtr m_descriptor;
+};
+
+// Add gaussian noise to a vector and restore its original length.
+inline void perturb(const float *source, int dimension, float sigma, std::mt19937 &random, float *target) {
+    std::normal_distribution<float> noise(0.f, sigma);
+    double sourceNorm = 0.0;
+    double targetNorm = 0.0;
+    for (int i = 0; i < dimension; ++i) {
+        target[i] = source[i] + noise(random);
+        sourceNorm += source[i] * source[i];
+        targetNorm += target[i] * target[i];
+    }
+    const float scale = targetNorm > 0.0 ? static_cast<float>(std::sqrt(sourceNorm / targetNorm)) : 1.f;
+    for (int i = 0; i < dimension; ++i)
+        target[i] *= scale;
+}
+
+#endif //FACEENGINE_DESCRIPTOR_SYNTHESIZER_H
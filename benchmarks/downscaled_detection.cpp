@@ -0,0 +1,227 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "timer.h"
+
+namespace {
+
+enum { MaxDetections = 10 };
+
+// A detected face matches a reference face at this overlap.
+const float MatchIoU = 0.5f;
+
+struct Faces {
+    fsdk::Detection detections[MaxDetections];
+    fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
+    int count = 0;
+};
+
+// Accuracy of one resolution against the full resolution faces.
+struct Accuracy {
+    int referenceFaces = 0;
+    int foundFaces = 0;
+    int matchedFaces = 0;
+    double iouSum = 0.0;
+    double landmarkErrorSum = 0.0;
+};
+
+float intersectionOverUnion(const fsdk::Rect &a, const fsdk::Rect &b) {
+    const int intersection = (a & b).getArea();
+    const int area = a.getArea() + b.getArea() - intersection;
+    return area > 0 ? static_cast<float>(intersection) / area : 0.f;
+}
+
+fsdk::Point2f getLandmark(const Faces &faces, int face, int index) {
+    fsdk::Point2f point = faces.landmarks[face].landmarks[index];
+    point.x += faces.detections[face].rect.x;
+    point.y += faces.detections[face].rect.y;
+    return point;
+}
+
+float getDistance(const fsdk::Point2f &a, const fsdk::Point2f &b) {
+    return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+// Pair every reference face with its best overlapping face and accumulate
+// IoU and the mean landmark error normalised by the inter-ocular distance.
+void compare(const Faces &reference, const Faces &faces, Accuracy &accuracy) {
+    accuracy.referenceFaces += reference.count;
+    accuracy.foundFaces += faces.count;
+    for (int i = 0; i < reference.count; ++i) {
+        int best = -1;
+        float bestIoU = 0.f;
+        for (int j = 0; j < faces.count; ++j) {
+            const float iou = intersectionOverUnion(reference.detections[i].rect, faces.detections[j].rect);
+            if (iou > bestIoU) {
+                best = j;
+                bestIoU = iou;
+            }
+        }
+        if (best < 0 || bestIoU < MatchIoU)
+            continue;
+
+        // The first two MTCNN landmarks are the eye centers.
+        const float eyes = getDistance(getLandmark(reference, i, 0), getLandmark(reference, i, 1));
+        float error = 0.f;
+        for (int k = 0; k < fsdk::IMTCNNDetector::Landmarks::LandmarksCount; ++k)
+            error += getDistance(getLandmark(reference, i, k), getLandmark(faces, best, k));
+        error /= fsdk::IMTCNNDetector::Landmarks::LandmarksCount;
+
+        ++accuracy.matchedFaces;
+        accuracy.iouSum += bestIoU;
+        accuracy.landmarkErrorSum += eyes > 0.f ? error / eyes : 0.f;
+    }
+}
+
+bool parseSides(const char *text, std::vector<int> &sides) {
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        const int side = atoi(item.c_str());
+        if (side < 1)
+            return false;
+        sides.push_back(side);
+    }
+    return !sides.empty();
+}
+
+}
+
+// MTCNN detection on full resolution images against detection on copies
+// downscaled to a max side, with the results mapped back. Reports mean time
+// per image (resampling included), recall and box IoU against the full
+// resolution faces and landmark error relative to the inter-ocular distance.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) comma separated list of max sides,
+    // 2) number of iterations,
+    // 3) paths to PPM images.
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <maxSides> <iterations> <image.ppm> [image.ppm ...]\n"
+                " *maxSides - comma separated larger sides of the detection image, e.g. 320,480,640,960\n"
+                " *iterations - number of runs per image and resolution\n"
+                " *image - path to PPM image\n"
+                << std::endl;
+        return -1;
+    }
+    std::vector<int> sides;
+    if (!parseSides(argv[1], sides)) {
+        vlf::log::error("Invalid max sides: %s.", argv[1]);
+        return -1;
+    }
+    int iterations = atoi(argv[2]);
+    if (iterations < 1)
+        iterations = 1;
+
+    std::vector<fsdk::Image> images;
+    for (int i = 3; i < argc; ++i) {
+        fsdk::Image image;
+        if (!image.loadFromPPM(argv[i])) {
+            vlf::log::error("Failed to load image: \"%s\".", argv[i]);
+            return -1;
+        }
+        images.push_back(image);
+    }
+
+    // Bring the models up and warm them up before anything is timed.
+    EngineContext::Settings engineSettings;
+    engineSettings.preload = true;
+    engineSettings.useWarper = false;
+    engineSettings.useExtractor = false;
+    engineSettings.useMatcher = false;
+    EngineContext engineContext;
+    if (!engineContext.init(engineSettings))
+        return -1;
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    if (!detector)
+        return -1;
+
+    // Mean time per image at a max side (0 is full resolution) and the faces of the last run.
+    auto run = [&](int maxSide, std::vector<Faces> &faces, double &resampleMs) -> double {
+        faces.assign(images.size(), Faces());
+        resampleMs = 0.0;
+        Timer timer;
+        for (int i = 0; i < iterations; ++i) {
+            for (size_t j = 0; j < images.size(); ++j) {
+                faces[j].count = detectFaces(
+                        detector,
+                        images[j],
+                        maxSide,
+                        &faces[j].detections[0],
+                        &faces[j].landmarks[0],
+                        MaxDetections
+                );
+            }
+        }
+        const double totalMs = timer.elapsedMs() / (iterations * images.size());
+
+        // Resampling alone, to show its share of the time.
+        timer.reset();
+        for (int i = 0; i < iterations; ++i) {
+            for (const fsdk::Image &image : images) {
+                fsdk::Image small;
+                downscaleImage(image, maxSide, small);
+            }
+        }
+        resampleMs = timer.elapsedMs() / (iterations * images.size());
+        return totalMs;
+    };
+
+    // The first run warms the detector up and is checked for failures.
+    std::vector<Faces> reference;
+    double resampleMs = 0.0;
+    run(0, reference, resampleMs);
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (reference[i].count < 0) {
+            vlf::log::error("Failed to detect faces in \"%s\".", argv[i + 3]);
+            return -1;
+        }
+    }
+    const double fullMs = run(0, reference, resampleMs);
+
+    int referenceFaces = 0;
+    for (const Faces &faces : reference)
+        referenceFaces += faces.count;
+    std::printf("%d image(s), %d face(s) at full resolution, %d iteration(s)\n",
+            static_cast<int>(images.size()), referenceFaces, iterations);
+    std::printf("%8s %10s %10s %8s %8s %8s %8s %10s\n",
+            "max side", "detect ms", "resize ms", "speedup", "faces", "recall", "mean IoU", "lmk error");
+    std::printf("%8s %10.2f %10.2f %7.2fx %8d %8.3f %8.3f %10.4f\n",
+            "full", fullMs, 0.0, 1.0, referenceFaces, 1.0, 1.0, 0.0);
+
+    for (int side : sides) {
+        std::vector<Faces> faces;
+        const double ms = run(side, faces, resampleMs);
+
+        Accuracy accuracy;
+        for (size_t i = 0; i < images.size(); ++i) {
+            if (faces[i].count < 0) {
+                vlf::log::error("Failed to detect faces in \"%s\".", argv[i + 3]);
+                return -1;
+            }
+            compare(reference[i], faces[i], accuracy);
+        }
+
+        std::printf("%8d %10.2f %10.2f %7.2fx %8d %8.3f %8.3f %10.4f\n",
+                side, ms, resampleMs, ms > 0.0 ? fullMs / ms : 0.0,
+                accuracy.foundFaces,
+                accuracy.referenceFaces > 0 ? static_cast<double>(accuracy.matchedFaces) / accuracy.referenceFaces : 1.0,
+                accuracy.matchedFaces > 0 ? accuracy.iouSum / accuracy.matchedFaces : 0.0,
+                accuracy.matchedFaces > 0 ? accuracy.landmarkErrorSum / accuracy.matchedFaces : 0.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "engine_context.h"
+#include "extraction_worker_pool.h"
+#include "timer.h"
+
+// Measures ExtractionWorkerPool throughput for 1..N threads.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to an image with a face,
+    // 2) maximal number of threads (default: number of cores),
+    // 3) number of images extracted per thread (default: 20).
+    if (argc < 2 || argc > 4) {
+        std::cout << "Usage: " << argv[0] << " <image> [maxThreads] [imagesPerThread]\n"
+                " *image - path to image (ppm)\n"
+                " *maxThreads - maximal number of threads\n"
+                " *imagesPerThread - number of extractions per thread\n"
+                << std::endl;
+        return -1;
+    }
+    char *imagePath = argv[1];
+    int maxThreads = argc > 2 ? atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    int imagesPerThread = argc > 3 ? atoi(argv[3]) : 20;
+    if (maxThreads < 1)
+        maxThreads = 1;
+    if (imagesPerThread < 1)
+        imagesPerThread = 1;
+
+    EngineContext engineContext;
+    if (!engineContext.init(EngineContext::Settings()))
+        return -1;
+
+    fsdk::Image image;
+    if (!image.loadFromPPM(imagePath)) {
+        vlf::log::error("Failed to load image: \"%s\".", imagePath);
+        return -1;
+    }
+
+    double singleThreadRate = 0.0;
+
+    std::printf("%8s %12s %14s %12s\n", "threads", "images/sec", "per thread", "efficiency");
+    for (int threadsCount = 1; threadsCount <= maxThreads; ++threadsCount) {
+        ExtractionWorkerPool::Settings settings;
+        settings.threadsCount = threadsCount;
+        ExtractionWorkerPool pool;
+        if (!pool.start(engineContext.getFaceEngine(), settings))
+            return -1;
+
+        // Warm up every worker once.
+        std::vector<std::future<fsdk::IDescriptorPtr>> futures;
+        for (int i = 0; i < threadsCount; ++i)
+            futures.push_back(pool.submit(image));
+        for (std::future<fsdk::IDescriptorPtr> &future : futures) {
+            if (!future.get()) {
+                vlf::log::error("No face found in \"%s\".", imagePath);
+                return -1;
+            }
+        }
+        futures.clear();
+
+        const int imagesCount = threadsCount * imagesPerThread;
+        Timer timer;
+        for (int i = 0; i < imagesCount; ++i)
+            futures.push_back(pool.submit(image));
+        for (std::future<fsdk::IDescriptorPtr> &future : futures)
+            future.get();
+        const double elapsedSec = timer.elapsedSec();
+
+        const double rate = imagesCount / elapsedSec;
+        if (threadsCount == 1)
+            singleThreadRate = rate;
+        std::printf("%8d %12.2f %14.2f %11.1f%%\n",
+                threadsCount,
+                rate,
+                rate / threadsCount,
+                100.0 * rate / (singleThreadRate * threadsCount)
+        );
+    }
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <FreeImage.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "freeimage_conversion.h"
+#include "thread_pool.h"
+#include "timer.h"
+
+namespace {
+
+// The conversion example4 used before: one FreeImage_GetPixelColor call per pixel.
+fsdk::Image convertPerPixel(FIBITMAP *sourceImage) {
+    unsigned width = FreeImage_GetWidth(sourceImage);
+    unsigned height = FreeImage_GetHeight(sourceImage);
+    fsdk::Image colorImage(width, height, fsdk::Format::R8G8B8);
+
+    uint8_t *data = colorImage.getDataAs<uint8_t>();
+    for (unsigned y = 0; y != height; ++y) {
+        for (unsigned x = 0; x != width; ++x) {
+            RGBQUAD pixel;
+            FreeImage_GetPixelColor(sourceImage, x, height - 1 - y, &pixel);
+            uint8_t *ptr = data + (y * width + x) * 3;
+            ptr[0] = pixel.rgbRed;
+            ptr[1] = pixel.rgbGreen;
+            ptr[2] = pixel.rgbBlue;
+        }
+    }
+    return colorImage;
+}
+
+bool isEqual(const fsdk::Image &a, const fsdk::Image &b) {
+    if (!a || !b || a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight())
+        return false;
+    const size_t rowSize = static_cast<size_t>(a.getWidth()) * 3;
+    for (int y = 0; y < a.getHeight(); ++y) {
+        if (memcmp(a.getScanLineAs<uint8_t>(y), b.getScanLineAs<uint8_t>(y), rowSize) != 0)
+            return false;
+    }
+    return true;
+}
+
+}
+
+// Compares the per pixel FIBITMAP conversion with the scanline one
+// for 32, 24, 16 and 8 bpp copies of an image.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to an image in any format FreeImage reads,
+    // 2) number of iterations (default: 5),
+    // 3) number of threads (default: number of cores),
+    // 4) megapixels the image is rescaled to (default: 12, 0 keeps the size).
+    if (argc < 2 || argc > 5) {
+        std::cout << "Usage: " << argv[0] << " <image> [iterations] [threads] [megapixels]\n"
+                " *image - path to image\n"
+                " *iterations - number of conversions per method\n"
+                " *threads - number of threads for the banded conversion\n"
+                " *megapixels - image size to test with\n"
+                << std::endl;
+        return -1;
+    }
+    const char *imagePath = argv[1];
+    int iterations = argc > 2 ? atoi(argv[2]) : 5;
+    int threadsCount = argc > 3 ? atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+    const double megapixels = argc > 4 ? atof(argv[4]) : 12.0;
+    if (iterations < 1)
+        iterations = 1;
+    if (threadsCount < 1)
+        threadsCount = 1;
+
+#ifdef FREEIMAGE_STATIC_LIB
+    FreeImage_Initialise();
+#endif
+
+    FREE_IMAGE_FORMAT format = FreeImage_GetFileType(imagePath, 0);
+    if (format == FIF_UNKNOWN)
+        format = FreeImage_GetFIFFromFilename(imagePath);
+    FIBITMAP *loaded = format != FIF_UNKNOWN ? FreeImage_Load(format, imagePath, 0) : nullptr;
+    if (!loaded) {
+        vlf::log::error("Failed to load image: \"%s\".", imagePath);
+        return -1;
+    }
+    FIBITMAP *source = FreeImage_ConvertTo24Bits(loaded);
+    FreeImage_Unload(loaded);
+    if (source && megapixels > 0.0) {
+        // Keep the aspect ratio.
+        const double scale = std::sqrt(megapixels * 1e6 /
+                (static_cast<double>(FreeImage_GetWidth(source)) * FreeImage_GetHeight(source)));
+        FIBITMAP *rescaled = FreeImage_Rescale(
+                source,
+                static_cast<int>(FreeImage_GetWidth(source) * scale),
+                static_cast<int>(FreeImage_GetHeight(source) * scale),
+                FILTER_BILINEAR
+        );
+        FreeImage_Unload(source);
+        source = rescaled;
+    }
+    if (!source) {
+        vlf::log::error("Failed to prepare image: \"%s\".", imagePath);
+        return -1;
+    }
+    vlf::log::info("Image %ux%u, %d thread(s).", FreeImage_GetWidth(source), FreeImage_GetHeight(source), threadsCount);
+
+    ThreadPool pool;
+    pool.start(threadsCount);
+
+    struct Variant {
+        const char *name;
+        FIBITMAP *bitmap;
+    };
+    Variant variants[] = {
+        { "32 bpp", FreeImage_ConvertTo32Bits(source) },
+        { "24 bpp", source },
+        { "16 bpp 565", FreeImage_ConvertTo16Bits565(source) },
+        { "8 bpp gray", FreeImage_ConvertToGreyscale(source) }
+    };
+
+    std::printf("%-12s %14s %14s %14s %10s\n", "source", "per pixel ms", "scanline ms", "threaded ms", "speedup");
+    bool succeeded = true;
+    for (const Variant &variant : variants) {
+        if (!variant.bitmap) {
+            vlf::log::error("Failed to create %s image.", variant.name);
+            succeeded = false;
+            continue;
+        }
+
+        const fsdk::Image expected = convertPerPixel(variant.bitmap);
+        if (!isEqual(expected, convertImage(variant.bitmap)) ||
+            !isEqual(expected, convertImage(variant.bitmap, &pool))) {
+            vlf::log::error("Scanline conversion of %s image differs from per pixel one.", variant.name);
+            succeeded = false;
+            continue;
+        }
+
+        Timer timer;
+        for (int i = 0; i < iterations; ++i)
+            convertPerPixel(variant.bitmap);
+        const double perPixelMs = timer.elapsedMs() / iterations;
+
+        timer.reset();
+        for (int i = 0; i < iterations; ++i)
+            convertImage(variant.bitmap);
+        const double scanlineMs = timer.elapsedMs() / iterations;
+
+        timer.reset();
+        for (int i = 0; i < iterations; ++i)
+            convertImage(variant.bitmap, &pool);
+        const double threadedMs = timer.elapsedMs() / iterations;
+
+        std::printf("%-12s %14.2f %14.2f %14.2f %9.1fx\n", variant.name, perPixelMs, scanlineMs, threadedMs,
+                threadedMs > 0.0 ? perPixelMs / threadedMs : 0.0);
+    }
+
+    for (const Variant &variant : variants) {
+        if (variant.bitmap)
+            FreeImage_Unload(variant.bitmap);
+    }
+
+#ifdef FREEIMAGE_STATIC_LIB
+    FreeImage_DeInitialise();
+#endif
+
+    return succeeded ? 0 : -1;
+}
@@ -0,0 +1,25 @@
+#ifndef FACEENGINE_IMAGE_CANVAS_H
+#define FACEENGINE_IMAGE_CANVAS_H
+
+#include <FaceEngine.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Fill a canvas by repeating an R8G8B8 source image, so one still has many small faces.
+inline fsdk::Image makeCanvas(const fsdk::Image &source, int width, int height) {
+    fsdk::Image canvas(width, height, fsdk::Format::R8G8B8);
+    if (!canvas)
+        return canvas;
+    const int rowSize = source.getWidth() * 3;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *sourceRow = source.getScanLineAs<uint8_t>(y % source.getHeight());
+        uint8_t *row = canvas.getScanLineAs<uint8_t>(y);
+        for (int x = 0; x < width * 3; x += rowSize)
+            memcpy(row + x, sourceRow, std::min(rowSize, width * 3 - x));
+    }
+    return canvas;
+}
+
+#endif //FACEENGINE_IMAGE_CANVAS_H
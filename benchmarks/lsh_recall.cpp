@@ -0,0 +1,180 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "descriptor_matrix.h"
+#include "descriptor_synthesizer.h"
+#include "engine_context.h"
+#include "latency_stats.h"
+#include "timer.h"
+
+namespace {
+
+// Parse a comma separated list of positive numbers.
+std::vector<int> parseList(const char *text) {
+    std::vector<int> values;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        const int value = atoi(item.c_str());
+        if (value > 0)
+            values.push_back(value);
+    }
+    return values;
+}
+
+}
+
+// Measures recall@K and latency of ILSHTable against exact search.
+// Galleries are synthesized around real descriptors from a gallery file,
+// so any size can be tested with a handful of faces.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to a gallery file with seed descriptors,
+    // 2) comma separated gallery sizes (default: 1000,10000,100000,1000000),
+    // 3) comma separated K values (default: 1,3,10,50),
+    // 4) number of queries per gallery (default: 200),
+    // 5) noise added to seed descriptors (default: 0.05).
+    if (argc < 2 || argc > 6) {
+        std::cout << "Usage: " << argv[0] << " <gallery> [sizes] [ks] [queries] [noise]\n"
+                " *gallery - path to gallery file with seed descriptors\n"
+                " *sizes - comma separated gallery sizes\n"
+                " *ks - comma separated numbers of nearest neighbors\n"
+                " *queries - number of queries per gallery\n"
+                " *noise - standard deviation of noise per descriptor value\n"
+                << std::endl;
+        return -1;
+    }
+    const char *galleryPath = argv[1];
+    const std::vector<int> sizes = parseList(argc > 2 ? argv[2] : "1000,10000,100000,1000000");
+    std::vector<int> ks = parseList(argc > 3 ? argv[3] : "1,3,10,50");
+    const int queriesCount = argc > 4 ? atoi(argv[4]) : 200;
+    const float noise = argc > 5 ? static_cast<float>(atof(argv[5])) : 0.05f;
+    if (sizes.empty() || ks.empty() || queriesCount < 1 || noise < 0.f) {
+        vlf::log::error("Invalid arguments.");
+        return -1;
+    }
+    std::sort(ks.begin(), ks.end());
+    const int maxK = ks.back();
+
+    EngineContext::Settings settings;
+    settings.useExtractor = false;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
+        return -1;
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    if (!descriptorFactory)
+        return -1;
+
+    DescriptorSynthesizer synthesizer;
+    if (!synthesizer.init(descriptorFactory, galleryPath))
+        return -1;
+    const DescriptorMatrix &seeds = synthesizer.getSeeds();
+
+    const int dimension = seeds.getDimension();
+    std::mt19937 random(42);
+    std::vector<float> values(seeds.getStride(), 0.f);
+
+    std::printf("seeds: %d, dimension: %d, queries: %d, noise: %.3f\n",
+            seeds.getCount(), dimension, queriesCount, noise);
+    std::printf("%10s %12s %6s %10s %10s %10s %10s %12s\n",
+            "gallery", "build ms", "K", "recall", "p50 ms", "p90 ms", "p99 ms", "exact p50");
+
+    for (int gallerySize : sizes) {
+        // Gallery: noisy copies of the seeds.
+        fsdk::IDescriptorBatchPtr descriptorBatch =
+                fsdk::acquire(descriptorFactory->createDescriptorBatch(fsdk::DT_CNN, gallerySize));
+        if (!descriptorBatch) {
+            vlf::log::error("Failed to create face descriptor batch instance.");
+            return -1;
+        }
+        DescriptorMatrix matrix;
+        matrix.reserve(gallerySize);
+        for (int i = 0; i < gallerySize; ++i) {
+            perturb(seeds.getRow(i % seeds.getCount()), dimension, noise, random, &values[0]);
+            if (!synthesizer.create(&values[0]) ||
+                    descriptorBatch->add(synthesizer.getDescriptor()).isError() ||
+                    !matrix.add(synthesizer.getDescriptor())) {
+                vlf::log::error("Failed to build gallery.");
+                return -1;
+            }
+        }
+
+        Timer timer;
+        fsdk::ILSHTablePtr lsh =
+                fsdk::acquire(descriptorFactory->createLSHTable(fsdk::DT_CNN, descriptorBatch.get()));
+        if (!lsh) {
+            vlf::log::error("Failed to create LSH table instance.");
+            return -1;
+        }
+        const double buildMs = timer.elapsedMs();
+
+        // Queries: half the gallery noise around random gallery members.
+        std::uniform_int_distribution<int> pick(0, gallerySize - 1);
+        DescriptorMatrix queries;
+        queries.reserve(queriesCount);
+        for (int q = 0; q < queriesCount; ++q) {
+            perturb(matrix.getRow(pick(random)), dimension, noise * 0.5f, random, &values[0]);
+            if (!synthesizer.create(&values[0]) || !queries.add(synthesizer.getDescriptor()))
+                return -1;
+        }
+
+        // Exact ground truth.
+        BruteForceMatcher matcher(matrix);
+        std::vector<std::vector<int>> truth(queriesCount, std::vector<int>(maxK));
+        LatencyStats exactStats;
+        for (int q = 0; q < queriesCount; ++q) {
+            timer.reset();
+            const int found = matcher.search(queries.getRow(q), maxK, &truth[q][0]);
+            exactStats.add(timer.elapsedMs());
+            truth[q].resize(found);
+        }
+
+        std::vector<int> neighbours(maxK);
+        for (int k : ks) {
+            LatencyStats lshStats;
+            double recallSum = 0.0;
+            for (int q = 0; q < queriesCount; ++q) {
+                if (!synthesizer.create(queries.getRow(q)))
+                    return -1;
+                // Slots the table does not fill stay -1, so they never count as hits.
+                std::fill(neighbours.begin(), neighbours.end(), -1);
+                timer.reset();
+                lsh->getKNearestNeighbours(synthesizer.getDescriptor(), k, &neighbours[0]);
+                lshStats.add(timer.elapsedMs());
+
+                const int expected = std::min(k, static_cast<int>(truth[q].size()));
+                int hits = 0;
+                for (int i = 0; i < expected; ++i) {
+                    if (neighbours[i] < 0 || neighbours[i] >= gallerySize)
+                        continue;
+                    if (std::find(truth[q].begin(), truth[q].begin() + expected, neighbours[i]) !=
+                            truth[q].begin() + expected)
+                        ++hits;
+                }
+                recallSum += expected > 0 ? static_cast<double>(hits) / expected : 1.0;
+            }
+            std::printf("%10d %12.1f %6d %10.4f %10.3f %10.3f %10.3f %12.3f\n",
+                    gallerySize,
+                    buildMs,
+                    k,
+                    recallSum / queriesCount,
+                    lshStats.getPercentile(50),
+                    lshStats.getPercentile(90),
+                    lshStats.getPercentile(99),
+                    exactStats.getPercentile(50)
+            );
+        }
+    }
+
+    return 0;
+}
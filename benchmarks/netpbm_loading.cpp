@@ -0,0 +1,175 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "netpbm.h"
+#include "simd.h"
+#include "timer.h"
+
+namespace {
+
+// Nearest neighbour upscale of an R8G8B8 image.
+fsdk::Image upscale(const fsdk::Image &image, int width, int height) {
+    fsdk::Image result(width, height, fsdk::Format::R8G8B8);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *source = image.getScanLineAs<uint8_t>(y * image.getHeight() / height);
+        uint8_t *target = result.getScanLineAs<uint8_t>(y);
+        for (int x = 0; x < width; ++x) {
+            const uint8_t *pixel = source + 3 * (x * image.getWidth() / width);
+            target[3 * x] = pixel[0];
+            target[3 * x + 1] = pixel[1];
+            target[3 * x + 2] = pixel[2];
+        }
+    }
+    return result;
+}
+
+// Largest difference between two images of the same size and format.
+int maxDifference(const fsdk::Image &a, const fsdk::Image &b) {
+    if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight() || a.getFormat() != b.getFormat())
+        return 256;
+    const size_t rowSize = static_cast<size_t>(a.getWidth()) * a.getFormat().getBytePerPixel();
+    int difference = 0;
+    for (int y = 0; y < a.getHeight(); ++y) {
+        const uint8_t *rowA = a.getScanLineAs<uint8_t>(y);
+        const uint8_t *rowB = b.getScanLineAs<uint8_t>(y);
+        for (size_t i = 0; i < rowSize; ++i)
+            difference = std::max(difference, std::abs(rowA[i] - rowB[i]));
+    }
+    return difference;
+}
+
+}
+
+// Compares Image::loadFromPPM + Image::convert with the single pass
+// Netpbm loader on images upscaled to 4K.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) directory for the upscaled images,
+    // 2) number of iterations,
+    // 3) paths to ppm images, e.g. the images/ folder.
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <workDir> <iterations> <image> [image ...]\n"
+                " *workDir - directory the 3840x2160 copies are written to\n"
+                " *iterations - number of loads of every image per method\n"
+                " *image - path to image (ppm)\n"
+                << std::endl;
+        return -1;
+    }
+    const std::string workDir = argv[1];
+    int iterations = atoi(argv[2]);
+    if (iterations < 1)
+        iterations = 1;
+
+    const int width = 3840;
+    const int height = 2160;
+
+    // Prepare 4K copies.
+    std::vector<std::string> paths;
+    for (int i = 3; i < argc; ++i) {
+        fsdk::Image image;
+        if (!image.loadFromPPM(argv[i])) {
+            vlf::log::error("Failed to load image: \"%s\".", argv[i]);
+            return -1;
+        }
+        const std::string path = workDir + "/netpbm_" + std::to_string(i - 3) + ".ppm";
+        if (!upscale(image, width, height).saveAsPPM(path.c_str())) {
+            vlf::log::error("Failed to save image: \"%s\".", path.c_str());
+            return -1;
+        }
+        paths.push_back(path);
+    }
+
+    vlf::log::info("%d image(s) %dx%d, row kernel: %s.",
+            static_cast<int>(paths.size()), width, height, simdLevelName(detectSimdLevel()));
+
+    // Both methods must give the same color image; luma may differ by rounding.
+    for (const std::string &path : paths) {
+        fsdk::Image image, expectedBGR, expectedR, imageBGR, imageR;
+        if (!image.loadFromPPM(path.c_str()) ||
+            !image.convert(expectedBGR, fsdk::Format::B8G8R8) ||
+            !image.convert(expectedR, fsdk::Format::R8) ||
+            !loadNetpbm(path.c_str(), &imageBGR, &imageR)) {
+            vlf::log::error("Failed to load \"%s\".", path.c_str());
+            return -1;
+        }
+        const int differenceBGR = maxDifference(expectedBGR, imageBGR);
+        if (differenceBGR != 0) {
+            vlf::log::error("BGR pixels of \"%s\" differ by up to %d.", path.c_str(), differenceBGR);
+            return -1;
+        }
+        vlf::log::info("\"%s\": BGR identical, R8 differs by up to %d.",
+                path.c_str(), maxDifference(expectedR, imageR));
+    }
+
+    std::printf("%-10s %16s %16s %10s\n", "target", "convert ms", "single pass ms", "speedup");
+
+    typedef std::function<bool(const char*)> Loader;
+    auto measure = [&](const Loader &loader) -> double {
+        Timer timer;
+        for (int i = 0; i < iterations; ++i) {
+            for (const std::string &path : paths) {
+                if (!loader(path.c_str())) {
+                    vlf::log::error("Failed to load \"%s\".", path.c_str());
+                    return -1.0;
+                }
+            }
+        }
+        return timer.elapsedMs() / (static_cast<double>(iterations) * paths.size());
+    };
+
+    auto compare = [&](const char *name, const Loader &convertLoader, const Loader &singlePassLoader) -> bool {
+        // Warm up the page cache and allocator for both methods.
+        if (measure(convertLoader) < 0.0 || measure(singlePassLoader) < 0.0)
+            return false;
+        const double convertMs = measure(convertLoader);
+        const double singlePassMs = measure(singlePassLoader);
+        if (convertMs < 0.0 || singlePassMs < 0.0)
+            return false;
+        std::printf("%-10s %16.2f %16.2f %9.2fx\n", name, convertMs, singlePassMs,
+                singlePassMs > 0.0 ? convertMs / singlePassMs : 0.0);
+        return true;
+    };
+
+    const bool succeeded =
+        compare("B8G8R8",
+            [](const char *path) {
+                fsdk::Image image, imageBGR;
+                return image.loadFromPPM(path) && image.convert(imageBGR, fsdk::Format::B8G8R8);
+            },
+            [](const char *path) {
+                fsdk::Image imageBGR;
+                return loadNetpbm(path, fsdk::Format::B8G8R8, imageBGR);
+            }) &&
+        compare("R8",
+            [](const char *path) {
+                fsdk::Image image, imageR;
+                return image.loadFromPPM(path) && image.convert(imageR, fsdk::Format::R8);
+            },
+            [](const char *path) {
+                fsdk::Image imageR;
+                return loadNetpbm(path, fsdk::Format::R8, imageR);
+            }) &&
+        compare("both",
+            [](const char *path) {
+                fsdk::Image image, imageBGR, imageR;
+                return image.loadFromPPM(path) &&
+                        image.convert(imageBGR, fsdk::Format::B8G8R8) &&
+                        image.convert(imageR, fsdk::Format::R8);
+            },
+            [](const char *path) {
+                fsdk::Image imageBGR, imageR;
+                return loadNetpbm(path, &imageBGR, &imageR);
+            });
+
+    return succeeded ? 0 : -1;
+}
@@ -0,0 +1,143 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <QImage>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "qimage_conversion.h"
+#include "timer.h"
+
+namespace {
+
+// The conversion example5 used before: one QImage::pixel() call per pixel.
+fsdk::Image convertPerPixel(const QImage &sourceImage) {
+    fsdk::Image colorImage(sourceImage.width(), sourceImage.height(), fsdk::Format::R8G8B8);
+    uchar *data = colorImage.getDataAs<uchar>();
+    for (int y = 0; y < colorImage.getHeight(); ++y) {
+        for (int x = 0; x < colorImage.getWidth(); ++x) {
+            const QRgb pixel = sourceImage.pixel(x, y);
+            uchar *ptr = data + (y * colorImage.getWidth() + x) * 3;
+            ptr[0] = static_cast<uchar>(pixel >> 16);
+            ptr[1] = static_cast<uchar>(pixel >> 8);
+            ptr[2] = static_cast<uchar>(pixel);
+        }
+    }
+    return colorImage;
+}
+
+// Copy of an image with alpha varying along every row, so premultiplied and
+// unpremultiplied colors differ.
+QImage makeTranslucent(const QImage &image) {
+    QImage translucent = image.convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < translucent.height(); ++y) {
+        QRgb *row = reinterpret_cast<QRgb*>(translucent.scanLine(y));
+        for (int x = 0; x < translucent.width(); ++x)
+            row[x] = (row[x] & 0x00ffffffu) | (static_cast<QRgb>(x & 0xff) << 24);
+    }
+    return translucent;
+}
+
+bool isEqual(const fsdk::Image &a, const fsdk::Image &b) {
+    if (!a || !b || a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight())
+        return false;
+    const size_t rowSize = static_cast<size_t>(a.getWidth()) * 3;
+    for (int y = 0; y < a.getHeight(); ++y) {
+        if (memcmp(a.getScanLineAs<uint8_t>(y), b.getScanLineAs<uint8_t>(y), rowSize) != 0)
+            return false;
+    }
+    return true;
+}
+
+}
+
+// Compares QImage::pixel() conversion with the scanline one at 1080p and 4K.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to an image Qt can load,
+    // 2) number of iterations (default: 10).
+    if (argc != 2 && argc != 3) {
+        std::cout << "Usage: " << argv[0] << " <image> [iterations]\n"
+                " *image - path to image\n"
+                " *iterations - number of conversions per method\n"
+                << std::endl;
+        return -1;
+    }
+    const char *imagePath = argv[1];
+    int iterations = argc > 2 ? atoi(argv[2]) : 10;
+    if (iterations < 1)
+        iterations = 1;
+
+    QImage loaded;
+    if (!loaded.load(imagePath)) {
+        vlf::log::error("Failed to load image: \"%s\".", imagePath);
+        return -1;
+    }
+
+    struct Size {
+        const char *name;
+        int width;
+        int height;
+    };
+    const Size sizes[] = {
+        { "1080p", 1920, 1080 },
+        { "4K", 3840, 2160 }
+    };
+
+    struct Variant {
+        const char *name;
+        QImage::Format format;
+        bool translucent;
+    };
+    // Indexed8 and RGBA8888 premultiplied take the convertToFormat fallback.
+    // Translucent variants check that premultiplied colors match pixel().
+    const Variant variants[] = {
+        { "RGB32", QImage::Format_RGB32, false },
+        { "ARGB32", QImage::Format_ARGB32, false },
+        { "RGB888", QImage::Format_RGB888, false },
+        { "Premultiplied", QImage::Format_ARGB32_Premultiplied, false },
+        { "Indexed8", QImage::Format_Indexed8, false },
+        { "ARGB32 alpha", QImage::Format_ARGB32, true },
+        { "Premult alpha", QImage::Format_ARGB32_Premultiplied, true },
+        { "RGBA8888P alpha", QImage::Format_RGBA8888_Premultiplied, true }
+    };
+
+    std::printf("%-6s %-16s %14s %14s %10s\n", "size", "format", "pixel() ms", "scanline ms", "speedup");
+    bool succeeded = true;
+    for (const Size &size : sizes) {
+        const QImage scaled = loaded.scaled(size.width, size.height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        const QImage translucent = makeTranslucent(scaled);
+        for (const Variant &variant : variants) {
+            const QImage image = (variant.translucent ? translucent : scaled).convertToFormat(variant.format);
+            if (image.isNull()) {
+                vlf::log::error("Failed to create %s image.", variant.name);
+                succeeded = false;
+                continue;
+            }
+            if (!isEqual(convertPerPixel(image), convertImage(image))) {
+                vlf::log::error("Scanline conversion of %s image differs from pixel() one.", variant.name);
+                succeeded = false;
+                continue;
+            }
+
+            Timer timer;
+            for (int i = 0; i < iterations; ++i)
+                convertPerPixel(image);
+            const double pixelMs = timer.elapsedMs() / iterations;
+
+            timer.reset();
+            for (int i = 0; i < iterations; ++i)
+                convertImage(image);
+            const double scanlineMs = timer.elapsedMs() / iterations;
+
+            std::printf("%-6s %-16s %14.2f %14.2f %9.1fx\n", size.name, variant.name, pixelMs, scanlineMs,
+                    scanlineMs > 0.0 ? pixelMs / scanlineMs : 0.0);
+        }
+    }
+
+    return succeeded ? 0 : -1;
+}
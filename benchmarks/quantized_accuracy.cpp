@@ -0,0 +1,230 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "descriptor_matrix.h"
+#include "descriptor_synthesizer.h"
+#include "engine_context.h"
+#include "quantized_matrix.h"
+#include "timer.h"
+
+namespace {
+
+// Score errors and ranking quality of one storage type.
+struct Report {
+    const char *name;
+    size_t bytesPerDescriptor;
+    std::vector<float> errors;
+    int flips = 0;
+    double recall = 0.0;
+    double searchMs = 0.0;
+};
+
+float percentile(std::vector<float> values, double p) {
+    if (values.empty())
+        return 0.f;
+    std::sort(values.begin(), values.end());
+    const size_t index = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::min(index > 0 ? index - 1 : 0, values.size() - 1)];
+}
+
+}
+
+// Compares similarities computed from fp16 and int8 descriptors with
+// IDescriptorMatcher::match on the same pairs. Float storage is reported as
+// well, which separates the quantization error from the calibration error of
+// the distance to similarity mapping.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to a gallery file with seed descriptors,
+    // 2) number of gallery descriptors (default: 10000),
+    // 3) number of queries (default: 100),
+    // 4) number of nearest neighbors (default: 10),
+    // 5) similarity threshold (default: 0.7).
+    if (argc < 2 || argc > 6) {
+        std::cout << "Usage: " << argv[0] << " <gallery> [gallerySize] [queries] [k] [threshold]\n"
+                " *gallery - path to gallery file with seed descriptors\n"
+                " *gallerySize - number of descriptors to search\n"
+                " *queries - number of evaluated queries\n"
+                " *k - number of nearest neighbors\n"
+                " *threshold - similarity threshold used to count changed decisions\n"
+                << std::endl;
+        return -1;
+    }
+    const char *galleryPath = argv[1];
+    const int gallerySize = argc > 2 ? atoi(argv[2]) : 10000;
+    const int queriesCount = argc > 3 ? atoi(argv[3]) : 100;
+    const int k = argc > 4 ? atoi(argv[4]) : 10;
+    const float threshold = argc > 5 ? static_cast<float>(atof(argv[5])) : 0.7f;
+    if (gallerySize < 1 || queriesCount < 1 || k < 1) {
+        vlf::log::error("Invalid arguments.");
+        return -1;
+    }
+    const float noise = 0.05f;
+
+    EngineContext::Settings settings;
+    settings.useExtractor = false;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
+        return -1;
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    fsdk::IDescriptorMatcherPtr descriptorMatcher = engineContext.getMatcher();
+    if (!descriptorFactory || !descriptorMatcher)
+        return -1;
+
+    DescriptorSynthesizer synthesizer;
+    if (!synthesizer.init(descriptorFactory, galleryPath))
+        return -1;
+    const DescriptorMatrix &seeds = synthesizer.getSeeds();
+    const int dimension = seeds.getDimension();
+    std::mt19937 random(42);
+    std::vector<float> values(seeds.getStride(), 0.f);
+
+    // The same gallery in the SDK batch and in every storage type.
+    fsdk::IDescriptorBatchPtr descriptorBatch =
+            fsdk::acquire(descriptorFactory->createDescriptorBatch(fsdk::DT_CNN, gallerySize));
+    if (!descriptorBatch) {
+        vlf::log::error("Failed to create face descriptor batch instance.");
+        return -1;
+    }
+    DescriptorMatrix matrix;
+    QuantizedMatrix halfMatrix(QuantizedMatrix::Float16);
+    QuantizedMatrix int8Matrix(QuantizedMatrix::Int8);
+    for (int i = 0; i < gallerySize; ++i) {
+        perturb(seeds.getRow(i % seeds.getCount()), dimension, noise, random, &values[0]);
+        if (!synthesizer.create(&values[0]) ||
+                descriptorBatch->add(synthesizer.getDescriptor()).isError() ||
+                !matrix.add(synthesizer.getDescriptor()) ||
+                !halfMatrix.add(&values[0], dimension) ||
+                !int8Matrix.add(&values[0], dimension)) {
+            vlf::log::error("Failed to build gallery.");
+            return -1;
+        }
+    }
+
+    // Queries around gallery members. The first half calibrates the similarity mapping.
+    std::uniform_int_distribution<int> pick(0, gallerySize - 1);
+    DescriptorMatrix queries;
+    for (int q = 0; q < queriesCount * 2; ++q) {
+        perturb(matrix.getRow(pick(random)), dimension, noise * 0.5f, random, &values[0]);
+        if (!synthesizer.create(&values[0]) || !queries.add(synthesizer.getDescriptor()))
+            return -1;
+    }
+
+    std::vector<fsdk::MatchingResult> results(gallerySize);
+    auto matchAll = [&](int q) {
+        if (!synthesizer.create(queries.getRow(q)))
+            return false;
+        fsdk::Result<fsdk::FSDKError> descriptorMatcherResult =
+                descriptorMatcher->match(synthesizer.getDescriptor(), descriptorBatch, &results[0]);
+        if (descriptorMatcherResult.isError()) {
+            vlf::log::error("Failed to match. Reason: %s.", descriptorMatcherResult.what());
+            return false;
+        }
+        return true;
+    };
+
+    BruteForceMatcher matcher(matrix);
+    std::vector<float> distances(gallerySize);
+    std::vector<float> calibrationDistances;
+    std::vector<float> calibrationSimilarities;
+    for (int q = 0; q < queriesCount; ++q) {
+        if (!matchAll(q))
+            return -1;
+        matcher.computeDistances(queries.getRow(q), &distances[0]);
+        calibrationDistances.insert(calibrationDistances.end(), distances.begin(), distances.end());
+        for (const fsdk::MatchingResult &result : results)
+            calibrationSimilarities.push_back(result.similarity);
+    }
+    SimilarityCalibration calibration;
+    if (!calibration.fit(calibrationDistances, calibrationSimilarities))
+        return -1;
+
+    Report reports[3];
+    reports[0].name = "float32";
+    reports[0].bytesPerDescriptor = matrix.getStride() * sizeof(float);
+    reports[1].name = QuantizedMatrix::getTypeName(halfMatrix.getType());
+    reports[1].bytesPerDescriptor = halfMatrix.getBytesPerDescriptor();
+    reports[2].name = QuantizedMatrix::getTypeName(int8Matrix.getType());
+    reports[2].bytesPerDescriptor = int8Matrix.getBytesPerDescriptor();
+
+    const int topK = std::min(k, gallerySize);
+    std::vector<int> order(gallerySize);
+    std::vector<int> indices(topK);
+    Timer timer;
+    for (int q = queriesCount; q < queriesCount * 2; ++q) {
+        if (!matchAll(q))
+            return -1;
+        const float *query = queries.getRow(q);
+
+        // SDK ranking by similarity is the reference top-K.
+        for (int i = 0; i < gallerySize; ++i)
+            order[i] = i;
+        std::partial_sort(order.begin(), order.begin() + topK, order.end(), [&](int left, int right) {
+            return results[left].similarity > results[right].similarity;
+        });
+
+        matcher.computeDistances(query, &distances[0]);
+        for (int type = 0; type < 3; ++type) {
+            Report &report = reports[type];
+            for (int i = 0; i < gallerySize; ++i) {
+                const float distance = type == 0 ? distances[i] :
+                        type == 1 ? halfMatrix.getDistance(query, i) : int8Matrix.getDistance(query, i);
+                const float similarity = calibration.getSimilarity(distance);
+                report.errors.push_back(std::fabs(similarity - results[i].similarity));
+                if ((similarity > threshold) != (results[i].similarity > threshold))
+                    ++report.flips;
+            }
+
+            timer.reset();
+            if (type == 0)
+                matcher.search(query, topK, &indices[0]);
+            else if (type == 1)
+                halfMatrix.search(query, topK, &indices[0], nullptr);
+            else
+                int8Matrix.search(query, topK, &indices[0], nullptr);
+            report.searchMs += timer.elapsedMs();
+
+            int hits = 0;
+            for (int index : indices) {
+                if (std::find(order.begin(), order.begin() + topK, index) != order.begin() + topK)
+                    ++hits;
+            }
+            report.recall += static_cast<double>(hits) / topK;
+        }
+    }
+
+    const size_t sdkBytes = descriptorBatch->getDescriptorSize();
+    std::printf("gallery: %d, queries: %d, k: %d, threshold: %.2f, SDK descriptor: %d bytes, kernels: %s\n",
+            gallerySize, queriesCount, topK, threshold, static_cast<int>(sdkBytes),
+            simdLevelName(halfMatrix.getSimdLevel()));
+    std::printf("%-8s %10s %8s %10s %10s %10s %8s %10s %10s\n",
+            "storage", "bytes", "ratio", "mean err", "p99 err", "max err", "flips", "recall@K", "ms/query");
+    for (Report &report : reports) {
+        double sum = 0.0;
+        for (float error : report.errors)
+            sum += error;
+        std::printf("%-8s %10d %8.2f %10.5f %10.5f %10.5f %8d %10.4f %10.3f\n",
+                report.name,
+                static_cast<int>(report.bytesPerDescriptor),
+                static_cast<double>(reports[0].bytesPerDescriptor) / report.bytesPerDescriptor,
+                report.errors.empty() ? 0.0 : sum / report.errors.size(),
+                percentile(report.errors, 99),
+                percentile(report.errors, 100),
+                report.flips,
+                report.recall / queriesCount,
+                report.searchMs / queriesCount
+        );
+    }
+
+    return 0;
+}
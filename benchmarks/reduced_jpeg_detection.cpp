@@ -0,0 +1,184 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <FreeImage.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "freeimage_conversion.h"
+#include "timer.h"
+
+namespace {
+
+enum { MaxDetections = 10 };
+
+struct Faces {
+    fsdk::Detection detections[MaxDetections];
+    fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
+    int count = 0;
+};
+
+float intersectionOverUnion(const fsdk::Rect &a, const fsdk::Rect &b) {
+    const int intersection = (a & b).getArea();
+    const int area = a.getArea() + b.getArea() - intersection;
+    return area > 0 ? static_cast<float>(intersection) / area : 0.f;
+}
+
+}
+
+// End-to-end latency of example4's pipeline (decode, convert, detect, warp)
+// with full resolution detection and with detection on a reduced JPEG decode.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) larger side of the reduced image,
+    // 2) number of iterations,
+    // 3) paths to JPEG images.
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <detectSize> <iterations> <image.jpg> [image.jpg ...]\n"
+                " *detectSize - larger side of the reduced decode in pixels, e.g. 1024\n"
+                " *iterations - number of runs per image and mode\n"
+                " *image - path to JPEG image\n"
+                << std::endl;
+        return -1;
+    }
+    const int detectSize = atoi(argv[1]);
+    int iterations = atoi(argv[2]);
+    if (detectSize < 1) {
+        vlf::log::error("Invalid detect size: %d.", detectSize);
+        return -1;
+    }
+    if (iterations < 1)
+        iterations = 1;
+    const std::vector<std::string> paths(argv + 3, argv + argc);
+
+    // Bring the models up and warm them up before anything is timed.
+    EngineContext::Settings engineSettings;
+    engineSettings.preload = true;
+    engineSettings.useExtractor = false;
+    engineSettings.useMatcher = false;
+    EngineContext engineContext;
+    if (!engineContext.init(engineSettings))
+        return -1;
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    if (!detector || !featureFactory || !warper)
+        return -1;
+
+#ifdef FREEIMAGE_STATIC_LIB
+    FreeImage_Initialise();
+#endif
+
+    auto load = [](FIBITMAP *bitmap) -> fsdk::Image {
+        if (!bitmap)
+            return fsdk::Image();
+        fsdk::Image image = convertImage(bitmap);
+        FreeImage_Unload(bitmap);
+        return image;
+    };
+
+    auto detect = [&](const fsdk::Image &image, Faces &faces) -> bool {
+        fsdk::ResultValue<fsdk::FSDKError, int> result =
+                detector.as<fsdk::IMTCNNDetector>()->detect(
+                        image,
+                        image.getRect(),
+                        &faces.detections[0],
+                        &faces.landmarks[0],
+                        MaxDetections
+                );
+        if (result.isError()) {
+            vlf::log::error("Failed to detect faces. Reason: %s.", result.what());
+            return false;
+        }
+        faces.count = result.getValue();
+        return true;
+    };
+
+    auto warpAll = [&](const fsdk::Image &image, const Faces &faces) -> bool {
+        for (int i = 0; i < faces.count; ++i) {
+            fsdk::IFeatureSetPtr featureSet =
+                    fsdk::acquire(featureFactory->createFeatureSet(faces.landmarks[i], faces.detections[i].score));
+            fsdk::Image warp;
+            if (!featureSet || warper->warp(image, faces.detections[i], featureSet, warp).isError())
+                return false;
+        }
+        return true;
+    };
+
+    auto runFull = [&](const char *path, Faces &faces) -> bool {
+        const fsdk::Image image = load(FreeImage_Load(FIF_JPEG, path, 0));
+        return image && detect(image, faces) && warpAll(image, faces);
+    };
+
+    auto runReduced = [&](const char *path, Faces &faces) -> bool {
+        const fsdk::Image reduced = load(loadReducedJPEG(path, detectSize));
+        if (!reduced || !detect(reduced, faces))
+            return false;
+        if (faces.count == 0)
+            return true;
+        const fsdk::Image image = load(FreeImage_Load(FIF_JPEG, path, 0));
+        if (!image)
+            return false;
+        const float scaleX = static_cast<float>(image.getWidth()) / reduced.getWidth();
+        const float scaleY = static_cast<float>(image.getHeight()) / reduced.getHeight();
+        for (int i = 0; i < faces.count; ++i)
+            scaleDetection(faces.detections[i], &faces.landmarks[i], scaleX, scaleY, image.getRect());
+        return warpAll(image, faces);
+    };
+
+    std::printf("%-32s %10s %10s %8s %8s %8s %8s\n",
+            "image", "full ms", "reduced ms", "speedup", "faces", "reduced", "mean IoU");
+    double fullTotal = 0.0;
+    double reducedTotal = 0.0;
+    for (const std::string &path : paths) {
+        Faces fullFaces;
+        Faces reducedFaces;
+        // The first runs warm up caches and are checked for failures.
+        if (!runFull(path.c_str(), fullFaces) || !runReduced(path.c_str(), reducedFaces)) {
+            vlf::log::error("Failed to process \"%s\".", path.c_str());
+            return -1;
+        }
+
+        Timer timer;
+        for (int i = 0; i < iterations; ++i)
+            runFull(path.c_str(), fullFaces);
+        const double fullMs = timer.elapsedMs() / iterations;
+
+        timer.reset();
+        for (int i = 0; i < iterations; ++i)
+            runReduced(path.c_str(), reducedFaces);
+        const double reducedMs = timer.elapsedMs() / iterations;
+
+        // Every full resolution face is paired with its best overlapping reduced one.
+        float iouSum = 0.f;
+        for (int i = 0; i < fullFaces.count; ++i) {
+            float best = 0.f;
+            for (int j = 0; j < reducedFaces.count; ++j)
+                best = std::max(best, intersectionOverUnion(fullFaces.detections[i].rect, reducedFaces.detections[j].rect));
+            iouSum += best;
+        }
+
+        std::printf("%-32s %10.1f %10.1f %7.2fx %8d %8d %8.3f\n",
+                path.c_str(), fullMs, reducedMs, reducedMs > 0.0 ? fullMs / reducedMs : 0.0,
+                fullFaces.count, reducedFaces.count, fullFaces.count > 0 ? iouSum / fullFaces.count : 0.f);
+        fullTotal += fullMs;
+        reducedTotal += reducedMs;
+    }
+    std::printf("mean: full %.1f ms, reduced %.1f ms, %.2fx\n",
+            fullTotal / paths.size(), reducedTotal / paths.size(),
+            reducedTotal > 0.0 ? fullTotal / reducedTotal : 0.0);
+
+#ifdef FREEIMAGE_STATIC_LIB
+    FreeImage_DeInitialise();
+#endif
+
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "descriptor_matrix.h"
+#include "descriptor_synthesizer.h"
+#include "engine_context.h"
+#include "latency_stats.h"
+#include "sharded_gallery.h"
+#include "timer.h"
+
+namespace {
+
+// Fraction of the exact top-k found in a result list.
+double recall(const std::vector<int> &truth, const std::vector<int> &found) {
+    if (truth.empty())
+        return 1.0;
+    int hits = 0;
+    for (int index : found) {
+        if (std::find(truth.begin(), truth.end(), index) != truth.end())
+            ++hits;
+    }
+    return static_cast<double>(hits) / truth.size();
+}
+
+}
+
+// Compares one batch with one LSH table against ShardedGallery:
+// table build time, cost of an enrollment, query latency and recall@K.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to a gallery file with seed descriptors,
+    // 2) number of gallery descriptors (default: 200000),
+    // 3) maximal number of descriptors per shard (default: 10000),
+    // 4) number of timed enrollments (default: 20),
+    // 5) number of queries (default: 100),
+    // 6) number of nearest neighbors (default: 10),
+    // 7) number of threads (default: number of cores).
+    if (argc < 2 || argc > 8) {
+        std::cout << "Usage: " << argv[0] << " <gallery> [gallerySize] [shardCapacity] [appends] [queries] [k] [threads]\n"
+                " *gallery - path to gallery file with seed descriptors\n"
+                " *gallerySize - number of descriptors to search\n"
+                " *shardCapacity - maximal number of descriptors per shard\n"
+                " *appends - number of timed enrollments\n"
+                " *queries - number of queries\n"
+                " *k - number of nearest neighbors\n"
+                " *threads - number of threads\n"
+                << std::endl;
+        return -1;
+    }
+    const char *galleryPath = argv[1];
+    const int gallerySize = argc > 2 ? atoi(argv[2]) : 200000;
+    const int shardCapacity = argc > 3 ? atoi(argv[3]) : 10000;
+    const int appendsCount = argc > 4 ? atoi(argv[4]) : 20;
+    const int queriesCount = argc > 5 ? atoi(argv[5]) : 100;
+    const int k = argc > 6 ? atoi(argv[6]) : 10;
+    const int threadsCount = argc > 7 ? atoi(argv[7]) : 0;
+    if (gallerySize < 1 || shardCapacity < 1 || appendsCount < 0 || queriesCount < 1 || k < 1) {
+        vlf::log::error("Invalid arguments.");
+        return -1;
+    }
+    const float noise = 0.05f;
+
+    EngineContext::Settings settings;
+    settings.useExtractor = false;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
+        return -1;
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    fsdk::IDescriptorMatcherPtr descriptorMatcher = engineContext.getMatcher();
+    if (!descriptorFactory || !descriptorMatcher)
+        return -1;
+
+    DescriptorSynthesizer synthesizer;
+    if (!synthesizer.init(descriptorFactory, galleryPath))
+        return -1;
+    const DescriptorMatrix &seeds = synthesizer.getSeeds();
+    const int dimension = seeds.getDimension();
+    std::mt19937 random(42);
+    std::vector<float> values(seeds.getStride(), 0.f);
+
+    // The same gallery goes into one batch, the sharded gallery and the exact matrix.
+    const int totalCount = gallerySize + appendsCount;
+    fsdk::IDescriptorBatchPtr descriptorBatch =
+            fsdk::acquire(descriptorFactory->createDescriptorBatch(fsdk::DT_CNN, totalCount));
+    if (!descriptorBatch) {
+        vlf::log::error("Failed to create face descriptor batch instance.");
+        return -1;
+    }
+    ShardedGallery::Settings shardedSettings;
+    shardedSettings.shardCapacity = shardCapacity;
+    shardedSettings.threadsCount = threadsCount;
+    ShardedGallery shardedGallery;
+    if (!shardedGallery.init(engineContext.getFaceEngine(), shardedSettings))
+        return -1;
+    DescriptorMatrix matrix;
+    matrix.reserve(totalCount);
+
+    auto enroll = [&](int index, bool sharded) {
+        perturb(seeds.getRow(index % seeds.getCount()), dimension, noise, random, &values[0]);
+        if (!synthesizer.create(&values[0]) ||
+                descriptorBatch->add(synthesizer.getDescriptor()).isError() ||
+                !matrix.add(synthesizer.getDescriptor())) {
+            vlf::log::error("Failed to build gallery.");
+            return false;
+        }
+        return !sharded || shardedGallery.append(synthesizer.getDescriptor());
+    };
+    for (int i = 0; i < gallerySize; ++i) {
+        if (!enroll(i, true))
+            return -1;
+    }
+
+    Timer timer;
+    fsdk::ILSHTablePtr lsh =
+            fsdk::acquire(descriptorFactory->createLSHTable(fsdk::DT_CNN, descriptorBatch.get()));
+    if (!lsh) {
+        vlf::log::error("Failed to create LSH table instance.");
+        return -1;
+    }
+    const double singleBuildMs = timer.elapsedMs();
+
+    timer.reset();
+    if (!shardedGallery.build())
+        return -1;
+    const double shardedBuildMs = timer.elapsedMs();
+
+    // Enrollment: the single table is rebuilt over the whole batch, the sharded gallery rebuilds its tail.
+    LatencyStats singleAppendStats;
+    LatencyStats shardedAppendStats;
+    for (int i = 0; i < appendsCount; ++i) {
+        if (!enroll(gallerySize + i, false))
+            return -1;
+        timer.reset();
+        lsh = fsdk::acquire(descriptorFactory->createLSHTable(fsdk::DT_CNN, descriptorBatch.get()));
+        if (!lsh) {
+            vlf::log::error("Failed to create LSH table instance.");
+            return -1;
+        }
+        singleAppendStats.add(timer.elapsedMs());
+
+        timer.reset();
+        if (!shardedGallery.add(synthesizer.getDescriptor()))
+            return -1;
+        shardedAppendStats.add(timer.elapsedMs());
+    }
+
+    // Queries around random gallery members.
+    std::uniform_int_distribution<int> pick(0, totalCount - 1);
+    DescriptorMatrix queries;
+    for (int q = 0; q < queriesCount; ++q) {
+        perturb(matrix.getRow(pick(random)), dimension, noise * 0.5f, random, &values[0]);
+        if (!synthesizer.create(&values[0]) || !queries.add(synthesizer.getDescriptor()))
+            return -1;
+    }
+
+    BruteForceMatcher matcher(matrix);
+    LatencyStats singleStats;
+    LatencyStats shardedStats;
+    double singleRecall = 0.0;
+    double shardedRecall = 0.0;
+    std::vector<int> truth;
+    std::vector<int> indices;
+    std::vector<fsdk::MatchingResult> results(k);
+    std::vector<ShardedGallery::Neighbour> neighbours(k);
+    for (int q = 0; q < queriesCount; ++q) {
+        truth.assign(k, 0);
+        truth.resize(matcher.search(queries.getRow(q), k, &truth[0]));
+        if (!synthesizer.create(queries.getRow(q)))
+            return -1;
+        const fsdk::IDescriptorPtr &descriptor = synthesizer.getDescriptor();
+
+        // Single table: candidates and their scores, like example6.
+        const int count = std::min(k, totalCount);
+        indices.assign(count, 0);
+        timer.reset();
+        lsh->getKNearestNeighbours(descriptor, count, &indices[0]);
+        fsdk::Result<fsdk::FSDKError> descriptorMatcherResult =
+                descriptorMatcher->match(descriptor, descriptorBatch, &indices[0], count, &results[0]);
+        singleStats.add(timer.elapsedMs());
+        if (descriptorMatcherResult.isError()) {
+            vlf::log::error("Failed to match. Reason: %s.", descriptorMatcherResult.what());
+            return -1;
+        }
+        singleRecall += recall(truth, indices);
+
+        timer.reset();
+        const int found = shardedGallery.search(descriptor, k, &neighbours[0]);
+        shardedStats.add(timer.elapsedMs());
+        if (found < 0)
+            return -1;
+        indices.clear();
+        for (int i = 0; i < found; ++i)
+            indices.push_back(neighbours[i].index);
+        shardedRecall += recall(truth, indices);
+    }
+
+    std::printf("gallery: %d, shards: %d x %d, appends: %d, queries: %d, k: %d\n",
+            totalCount, shardedGallery.getShardsCount(), shardCapacity, appendsCount, queriesCount, k);
+    std::printf("%-10s %12s %14s %10s %10s %10s\n",
+            "layout", "build ms", "append p50 ms", "query p50", "query p99", "recall");
+    std::printf("%-10s %12.1f %14.2f %10.3f %10.3f %10.4f\n",
+            "single", singleBuildMs, singleAppendStats.getPercentile(50),
+            singleStats.getPercentile(50), singleStats.getPercentile(99), singleRecall / queriesCount);
+    std::printf("%-10s %12.1f %14.2f %10.3f %10.3f %10.4f\n",
+            "sharded", shardedBuildMs, shardedAppendStats.getPercentile(50),
+            shardedStats.getPercentile(50), shardedStats.getPercentile(99), shardedRecall / queriesCount);
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "timer.h"
+
+namespace {
+
+enum { MaxDetections = 10 };
+
+// Detection confidence threshold of the examples.
+const float ConfidenceThreshold = 0.25f;
+
+// Per face times in milliseconds, summed over all faces and iterations.
+struct Timings {
+    double warp = 0.0;
+    double quality = 0.0;
+    double attributes = 0.0;
+    double warpConversion = 0.0;
+    double extraction = 0.0;
+    double warpedExtraction = 0.0;
+};
+
+}
+
+// Per face cost of the examples' face pipeline. The quality and complex
+// estimators take a warp of the loaded R8G8B8 image, as in the examples. The
+// extractor takes B8G8R8, either as that warp converted for
+// extractFromWarpedImage or as the full image converted for extract(), which
+// aligns the face again. Reports stage times per face including both
+// conversions, the time saved by the shared warp and the similarity of the
+// descriptors from both extraction paths.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to a PPM image,
+    // 2) optional number of iterations.
+    if (argc < 2 || argc > 3) {
+        std::cout << "Usage: " << argv[0] << " <image.ppm> [iterations]\n"
+                " *image - path to PPM image with faces\n"
+                " *iterations - number of runs per face (default: 20)\n"
+                << std::endl;
+        return -1;
+    }
+    const int iterations = std::max(1, argc > 2 ? atoi(argv[2]) : 20);
+
+    fsdk::Image image;
+    if (!image.loadFromPPM(argv[1])) {
+        vlf::log::error("Failed to load image: \"%s\".", argv[1]);
+        return -1;
+    }
+
+    // The full image conversion is needed once per image by extract() only.
+    fsdk::Image imageBGR;
+    image.convert(imageBGR, fsdk::Format::B8G8R8);
+    Timer timer;
+    for (int iteration = 0; iteration < iterations; ++iteration)
+        image.convert(imageBGR, fsdk::Format::B8G8R8);
+    const double imageConversion = timer.elapsedMs() / iterations;
+    if (!imageBGR) {
+        vlf::log::error("Conversion to BGR has failed.");
+        return -1;
+    }
+
+    // Bring the models up and warm them up before anything is timed.
+    EngineContext::Settings engineSettings;
+    engineSettings.preload = true;
+    engineSettings.useEstimators = true;
+    EngineContext engineContext;
+    if (!engineContext.init(engineSettings))
+        return -1;
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    fsdk::IDescriptorExtractorPtr extractor = engineContext.getExtractor();
+    fsdk::IDescriptorMatcherPtr matcher = engineContext.getMatcher();
+    fsdk::IQualityEstimatorPtr qualityEstimator = engineContext.getQualityEstimator();
+    fsdk::IComplexEstimatorPtr complexEstimator = engineContext.getComplexEstimator();
+    if (!detector || !featureFactory || !descriptorFactory || !warper || !extractor || !matcher ||
+        !qualityEstimator || !complexEstimator)
+        return -1;
+
+    fsdk::Detection detections[MaxDetections];
+    fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
+    const int detectionsCount = detectFaces(detector, image, 0, &detections[0], &landmarks[0], MaxDetections);
+    if (detectionsCount < 0)
+        return -1;
+
+    fsdk::IDescriptorPtr descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+    fsdk::IDescriptorPtr warpedDescriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+    if (!descriptor || !warpedDescriptor) {
+        vlf::log::error("Failed to create face descrtiptor instance.");
+        return -1;
+    }
+
+    Timings timings;
+    int facesCount = 0;
+    double similaritySum = 0.0;
+    float minSimilarity = 1.f;
+    for (int i = 0; i < detectionsCount; ++i) {
+        if (detections[i].score < ConfidenceThreshold)
+            continue;
+        fsdk::IFeatureSetPtr featureSet =
+                fsdk::acquire(featureFactory->createFeatureSet(landmarks[i], detections[i].score));
+        if (!featureSet) {
+            vlf::log::error("Failed to create face feature set instance.");
+            return -1;
+        }
+
+        // The first run of every stage warms up its model and is not timed.
+        for (int iteration = 0; iteration <= iterations; ++iteration) {
+            Timings run;
+            timer.reset();
+            fsdk::Image warp;
+            if (warper->warp(image, detections[i], featureSet, warp).isError()) {
+                vlf::log::error("Failed to create warped face.");
+                return -1;
+            }
+            run.warp = timer.elapsedMs();
+
+            timer.reset();
+            float quality;
+            if (qualityEstimator->estimate(warp, &quality).isError()) {
+                vlf::log::error("Failed to get quality estimate.");
+                return -1;
+            }
+            run.quality = timer.elapsedMs();
+
+            timer.reset();
+            fsdk::ComplexEstimation complexEstimation;
+            if (complexEstimator->estimate(warp, complexEstimation).isError()) {
+                vlf::log::error("Failed to get complex estimate.");
+                return -1;
+            }
+            run.attributes = timer.elapsedMs();
+
+            timer.reset();
+            fsdk::Image warpBGR;
+            warp.convert(warpBGR, fsdk::Format::B8G8R8);
+            if (!warpBGR) {
+                vlf::log::error("Conversion of warp to BGR has failed.");
+                return -1;
+            }
+            run.warpConversion = timer.elapsedMs();
+
+            timer.reset();
+            if (extractor->extractFromWarpedImage(warpBGR, warpedDescriptor).isError()) {
+                vlf::log::error("Failed to extract face descriptor from warp.");
+                return -1;
+            }
+            run.warpedExtraction = timer.elapsedMs();
+
+            timer.reset();
+            if (extractor->extract(imageBGR, detections[i], featureSet, descriptor).isError()) {
+                vlf::log::error("Failed to extract face descriptor.");
+                return -1;
+            }
+            run.extraction = timer.elapsedMs();
+
+            if (iteration == 0)
+                continue;
+            timings.warp += run.warp;
+            timings.quality += run.quality;
+            timings.attributes += run.attributes;
+            timings.warpConversion += run.warpConversion;
+            timings.extraction += run.extraction;
+            timings.warpedExtraction += run.warpedExtraction;
+        }
+
+        fsdk::ResultValue<fsdk::FSDKError, fsdk::MatchingResult> matcherResult =
+                matcher->match(descriptor, warpedDescriptor);
+        if (matcherResult.isError()) {
+            vlf::log::error("Failed to match. Reason: %s.", matcherResult.what());
+            return -1;
+        }
+        const float similarity = matcherResult.getValue().similarity;
+        similaritySum += similarity;
+        minSimilarity = std::min(minSimilarity, similarity);
+        ++facesCount;
+    }
+    if (facesCount == 0) {
+        vlf::log::error("No confident faces found in \"%s\".", argv[1]);
+        return -1;
+    }
+
+    const double runs = static_cast<double>(facesCount) * iterations;
+    const double warp = timings.warp / runs;
+    const double estimators = (timings.quality + timings.attributes) / runs;
+    const double imageConversionPerFace = imageConversion / facesCount;
+    const double warpConversion = timings.warpConversion / runs;
+    const double extraction = timings.extraction / runs;
+    const double warpedExtraction = timings.warpedExtraction / runs;
+    const double separate = warp + estimators + imageConversionPerFace + extraction;
+    const double shared = warp + estimators + warpConversion + warpedExtraction;
+    std::printf("%d face(s), %d iteration(s)\n", facesCount, iterations);
+    std::printf("%-36s %10s\n", "stage", "ms/face");
+    std::printf("%-36s %10.3f\n", "warp of RGB image", warp);
+    std::printf("%-36s %10.3f\n", "quality estimation", timings.quality / runs);
+    std::printf("%-36s %10.3f\n", "complex estimation", timings.attributes / runs);
+    std::printf("%-36s %10.3f\n", "image to BGR, shared by faces", imageConversionPerFace);
+    std::printf("%-36s %10.3f\n", "extract from full BGR image", extraction);
+    std::printf("%-36s %10.3f\n", "warp to BGR", warpConversion);
+    std::printf("%-36s %10.3f\n", "extract from BGR warp", warpedExtraction);
+    std::printf("%-36s %10.3f\n", "pipeline, extraction warps again", separate);
+    std::printf("%-36s %10.3f\n", "pipeline, one shared warp", shared);
+    std::printf("saved %.3f ms per face (%.1f%%); descriptor similarity mean %.4f, min %.4f\n",
+            separate - shared, separate > 0.0 ? 100.0 * (separate - shared) / separate : 0.0,
+            similaritySum / facesCount, minSimilarity);
+
+    return 0;
+}
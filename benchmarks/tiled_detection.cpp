@@ -0,0 +1,181 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "engine_context.h"
+#include "image_canvas.h"
+#include "tiled_detector.h"
+#include "timer.h"
+
+namespace {
+
+enum { MaxDetections = 1024 };
+
+// A tiled face matches a single call face at this overlap.
+const float MatchIoU = 0.5f;
+
+float intersectionOverUnion(const fsdk::Rect &a, const fsdk::Rect &b) {
+    const int intersection = (a & b).getArea();
+    const int area = a.getArea() + b.getArea() - intersection;
+    return area > 0 ? static_cast<float>(intersection) / area : 0.f;
+}
+
+// Faces of the reference found again, and faces only the tested path found.
+void compare(
+        const std::vector<fsdk::Detection> &reference, int referenceCount,
+        const std::vector<fsdk::Detection> &faces, int count,
+        int &matched, int &extra
+) {
+    std::vector<bool> used(count, false);
+    matched = 0;
+    for (int i = 0; i < referenceCount; ++i) {
+        int best = -1;
+        float bestIoU = MatchIoU;
+        for (int j = 0; j < count; ++j) {
+            const float iou = intersectionOverUnion(reference[i].rect, faces[j].rect);
+            if (!used[j] && iou >= bestIoU) {
+                best = j;
+                bestIoU = iou;
+            }
+        }
+        if (best >= 0) {
+            used[best] = true;
+            ++matched;
+        }
+    }
+    extra = count - matched;
+}
+
+}
+
+// One MTCNN detect() call over the whole image against TiledDetector with
+// 1 to N threads on an 8K canvas tiled from the input image.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to a PPM image,
+    // 2) optional number of iterations,
+    // 3) optional tile size,
+    // 4) optional tile overlap,
+    // 5) optional maximal number of threads.
+    if (argc < 2 || argc > 6) {
+        std::cout << "Usage: " << argv[0] << " <image.ppm> [iterations] [tileSize] [overlap] [maxThreads]\n"
+                " *image - path to PPM image, repeated to fill a 7680x4320 canvas\n"
+                " *iterations - number of runs per mode (default: 5)\n"
+                " *tileSize - side of a tile in pixels (default: 1024)\n"
+                " *overlap - overlap of neighbouring tiles in pixels (default: 192)\n"
+                " *maxThreads - largest number of detector threads (default: number of cores)\n"
+                << std::endl;
+        return -1;
+    }
+    const int iterations = std::max(1, argc > 2 ? atoi(argv[2]) : 5);
+    TiledDetector::Settings settings;
+    if (argc > 3)
+        settings.tileSize = atoi(argv[3]);
+    if (argc > 4)
+        settings.overlap = atoi(argv[4]);
+    const int maxThreads = std::max(1, argc > 5 ?
+            atoi(argv[5]) :
+            static_cast<int>(std::thread::hardware_concurrency()));
+
+    fsdk::Image source;
+    if (!source.loadFromPPM(argv[1])) {
+        vlf::log::error("Failed to load image: \"%s\".", argv[1]);
+        return -1;
+    }
+    const fsdk::Image image = makeCanvas(source, 7680, 4320);
+    if (!image) {
+        vlf::log::error("Failed to create canvas.");
+        return -1;
+    }
+
+    // Bring the models up and warm them up before anything is timed.
+    EngineContext::Settings engineSettings;
+    engineSettings.preload = true;
+    engineSettings.useWarper = false;
+    engineSettings.useExtractor = false;
+    engineSettings.useMatcher = false;
+    EngineContext engineContext;
+    if (!engineContext.init(engineSettings))
+        return -1;
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    if (!detector)
+        return -1;
+
+    std::vector<fsdk::Detection> reference(MaxDetections);
+    std::vector<fsdk::IMTCNNDetector::Landmarks> referenceLandmarks(MaxDetections);
+    auto detectSingle = [&]() -> int {
+        fsdk::ResultValue<fsdk::FSDKError, int> result =
+                detector.as<fsdk::IMTCNNDetector>()->detect(
+                        image,
+                        image.getRect(),
+                        &reference[0],
+                        &referenceLandmarks[0],
+                        MaxDetections
+                );
+        if (result.isError()) {
+            vlf::log::error("Failed to detect faces. Reason: %s.", result.what());
+            return -1;
+        }
+        return result.getValue();
+    };
+
+    // The first call warms the detector up.
+    int referenceCount = detectSingle();
+    if (referenceCount < 0)
+        return -1;
+    Timer timer;
+    for (int i = 0; i < iterations; ++i)
+        referenceCount = detectSingle();
+    const double singleMs = timer.elapsedMs() / iterations;
+
+    std::printf("%dx%d canvas, tile %d, overlap %d, %d iteration(s)\n",
+            image.getWidth(), image.getHeight(), settings.tileSize, settings.overlap, iterations);
+    std::printf("%-12s %8s %10s %8s %8s %8s %8s\n",
+            "mode", "tiles", "ms", "speedup", "faces", "matched", "extra");
+    std::printf("%-12s %8d %10.1f %7.2fx %8d %8d %8d\n",
+            "single call", 1, singleMs, 1.0, referenceCount, referenceCount, 0);
+
+    std::vector<fsdk::Detection> detections(MaxDetections);
+    std::vector<fsdk::IMTCNNDetector::Landmarks> landmarks(MaxDetections);
+
+    // Powers of two and the maximum.
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (int threads : threadCounts) {
+        settings.threadsCount = threads;
+        TiledDetector tiledDetector;
+        if (!tiledDetector.init(engineContext.getFaceEngine(), settings))
+            return -1;
+
+        int count = tiledDetector.detect(image, &detections[0], &landmarks[0], MaxDetections);
+        if (count < 0)
+            return -1;
+        timer.reset();
+        for (int i = 0; i < iterations; ++i)
+            count = tiledDetector.detect(image, &detections[0], &landmarks[0], MaxDetections);
+        const double ms = timer.elapsedMs() / iterations;
+
+        int matched = 0;
+        int extra = 0;
+        compare(reference, referenceCount, detections, count, matched, extra);
+
+        char mode[32];
+        std::snprintf(mode, sizeof(mode), "tiled x%d", threads);
+        std::printf("%-12s %8d %10.1f %7.2fx %8d %8d %8d\n",
+                mode, tiledDetector.getTilesCount(), ms, ms > 0.0 ? singleMs / ms : 0.0,
+                count, matched, extra);
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "engine_context.h"
+#include "face_cascade.h"
+#include "face_extraction.h"
+#include "timer.h"
+
+namespace {
+
+// Facial feature detection confidence threshold of example1.
+const float ConfidenceThreshold = 0.25f;
+
+// Objects of one verification pipeline of example1.
+struct Pipeline {
+    const char *name;
+    bool mtcnn;
+    EngineContext engineContext;
+    fsdk::IDetectorPtr detector;
+    fsdk::IFeatureFactoryPtr featureFactory;
+    fsdk::IFeatureDetectorPtr featureDetector;
+    fsdk::IDescriptorFactoryPtr descriptorFactory;
+    fsdk::IDescriptorExtractorPtr extractor;
+    fsdk::IDescriptorMatcherPtr matcher;
+
+    bool init() {
+        EngineContext::Settings settings;
+        settings.detectorType = mtcnn ? fsdk::ODT_MTCNN : fsdk::ODT_DPM;
+        settings.preload = true;
+        settings.useFeatureDetector = !mtcnn;
+        settings.useWarper = false;
+        if (!engineContext.init(settings))
+            return false;
+        detector = engineContext.getDetector();
+        featureFactory = engineContext.getFeatureFactory();
+        descriptorFactory = engineContext.getDescriptorFactory();
+        extractor = engineContext.getExtractor();
+        matcher = engineContext.getMatcher();
+        if (!mtcnn)
+            featureDetector = engineContext.getFeatureDetector();
+        return detector && featureFactory && descriptorFactory && extractor && matcher &&
+                (mtcnn || featureDetector);
+    }
+
+    // Extract the descriptor of the best face with extractBestFace, as example1 does.
+    // Returns nullptr on failure or if there is no confident face.
+    fsdk::IDescriptorPtr extract(FaceCascade &cascade, const fsdk::Image &image) {
+        FaceExtractionSettings settings;
+        settings.confidenceThreshold = ConfidenceThreshold;
+        return extractBestFace(
+                detector,
+                featureFactory,
+                featureDetector,
+                descriptorFactory,
+                extractor,
+                &cascade,
+                image,
+                settings
+        );
+    }
+};
+
+// File name without directory and extension.
+std::string getName(const std::string &path) {
+    const std::string name = path.substr(path.find_last_of("/\\") + 1);
+    return name.substr(0, name.find('.'));
+}
+
+// Person of an image: file name without a trailing _<number>, so
+// Cameron_Diaz.ppm and Cameron_Diaz_2.ppm match.
+std::string getIdentity(const std::string &path) {
+    std::string name = getName(path);
+    const size_t underscore = name.find_last_of('_');
+    if (underscore != std::string::npos && underscore + 1 < name.size() &&
+        name.find_first_not_of("0123456789", underscore + 1) == std::string::npos)
+        name.resize(underscore);
+    return name;
+}
+
+}
+
+// Example1 verification with DPM detection and VGG feature detection on a
+// grayscale image against MTCNN detection with its own landmarks and no
+// grayscale image, both through extractBestFace as in example1: stage
+// latency per image and similarity of every image pair side by side.
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) number of iterations,
+    // 2) similarity threshold,
+    // 3) paths to PPM images.
+    if (argc < 5) {
+        std::cout << "Usage: " << argv[0] << " <iterations> <threshold> <image.ppm> <image.ppm> [image.ppm ...]\n"
+                " *iterations - number of extractions per image and pipeline\n"
+                " *threshold - similarity threshold in range (0..1]\n"
+                " *image - path to PPM image; images named <person>[_<number>].ppm are pairs of one person\n"
+                << std::endl;
+        return -1;
+    }
+    const int iterations = std::max(1, atoi(argv[1]));
+    const float threshold = (float)atof(argv[2]);
+
+    std::vector<std::string> paths(argv + 3, argv + argc);
+    std::vector<fsdk::Image> images(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!images[i].loadFromPPM(paths[i].c_str())) {
+            vlf::log::error("Failed to load image: \"%s\".", paths[i].c_str());
+            return -1;
+        }
+    }
+
+    Pipeline pipelines[2];
+    pipelines[0].name = "DPM+VGG";
+    pipelines[0].mtcnn = false;
+    pipelines[1].name = "MTCNN";
+    pipelines[1].mtcnn = true;
+
+    std::vector<fsdk::IDescriptorPtr> descriptors[2];
+    std::printf("%-8s %14s %12s %12s %12s\n",
+            "pipeline", "detect+conv ms", "landmark ms", "extract ms", "total ms");
+    for (int p = 0; p < 2; ++p) {
+        Pipeline &pipeline = pipelines[p];
+        if (!pipeline.init())
+            return -1;
+
+        // The cascade has example1's defaults and only times the stages.
+        const fsdk::IWarperPtr warper(nullptr);
+        const fsdk::IQualityEstimatorPtr qualityEstimator(nullptr);
+        FaceCascade cascade(warper, qualityEstimator, FaceCascade::Settings());
+
+        // The first extraction warms up the models and is not timed.
+        for (const fsdk::Image &image : images)
+            descriptors[p].push_back(pipeline.extract(cascade, image));
+        cascade.resetStats();
+        Timer timer;
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            for (const fsdk::Image &image : images)
+                pipeline.extract(cascade, image);
+        }
+        const double runs = static_cast<double>(iterations) * images.size();
+        const double total = timer.elapsedMs() / runs;
+        const double landmarks = cascade.getStats(FaceCascade::StageLandmarks).ms / runs;
+        const double extraction = cascade.getStats(FaceCascade::StageExtraction).ms / runs;
+        std::printf("%-8s %14.2f %12.2f %12.2f %12.2f\n", pipeline.name,
+                total - landmarks - extraction, landmarks, extraction, total);
+    }
+
+    // Similarity of every pair with each pipeline.
+    std::printf("\n%-48s %6s %10s %10s\n", "pair", "same", "DPM+VGG", "MTCNN");
+    int correct[2] = { 0, 0 };
+    int pairsCount = 0;
+    for (size_t i = 0; i < images.size(); ++i) {
+        for (size_t j = i + 1; j < images.size(); ++j) {
+            const bool genuine = getIdentity(paths[i]) == getIdentity(paths[j]);
+            float similarity[2] = { -1.f, -1.f };
+            for (int p = 0; p < 2; ++p) {
+                if (!descriptors[p][i] || !descriptors[p][j])
+                    continue;
+                fsdk::ResultValue<fsdk::FSDKError, fsdk::MatchingResult> matcherResult =
+                        pipelines[p].matcher->match(descriptors[p][i], descriptors[p][j]);
+                if (matcherResult.isError()) {
+                    vlf::log::error("Failed to match. Reason: %s.", matcherResult.what());
+                    return -1;
+                }
+                similarity[p] = matcherResult.getValue().similarity;
+                if ((similarity[p] > threshold) == genuine)
+                    ++correct[p];
+            }
+            ++pairsCount;
+
+            const std::string pair = getName(paths[i]) + " / " + getName(paths[j]);
+            std::printf("%-48s %6s %10.4f %10.4f\n",
+                    pair.c_str(), genuine ? "yes" : "no", similarity[0], similarity[1]);
+        }
+    }
+    std::printf("\nCorrect decisions at %.3f: DPM+VGG %d/%d, MTCNN %d/%d (no face scores -1)\n",
+            threshold, correct[0], pairsCount, correct[1], pairsCount);
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef FACEENGINE_BOUNDED_QUEUE_H
+#define FACEENGINE_BOUNDED_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// Blocking FIFO with a fixed capacity.
+// Producers block in push() while the queue is full, consumers block in pop()
+// while it is empty, or until a deadline with popUntil(). After close() pushes
+// fail and pops drain what is left.
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity):
+        m_capacity(capacity ? capacity : 1)
+    {}
+
+    // Returns false if the queue was closed.
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed)
+            return false;
+        m_items.push_back(std::move(item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Returns false if the queue is closed and empty.
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty())
+            return false;
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    // Like pop(), but also returns false if nothing arrives before the deadline.
+    bool popUntil(T &item, const std::chrono::steady_clock::time_point &deadline) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_notEmpty.wait_until(lock, deadline, [this] { return m_closed || !m_items.empty(); }))
+            return false;
+        if (m_items.empty())
+            return false;
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+private:
+    const size_t m_capacity;
+    bool m_closed = false;
+    std::deque<T> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+};
+
+#endif //FACEENGINE_BOUNDED_QUEUE_H
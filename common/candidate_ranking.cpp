@@ -0,0 +1,81 @@
+#include "candidate_ranking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+const char *PolicyNames[] = {
+    "none",
+    "score",
+    "area",
+    "center"
+};
+
+const int PoliciesCount = sizeof(PolicyNames) / sizeof(PolicyNames[0]);
+
+// Score weight of a face at a corner of the image, relative to one in the center.
+const float CornerWeight = 0.25f;
+
+float getCenterWeight(const fsdk::Detection &detection, const fsdk::Rect &bounds) {
+    const float halfWidth = bounds.width * 0.5f;
+    const float halfHeight = bounds.height * 0.5f;
+    if (halfWidth <= 0.f || halfHeight <= 0.f)
+        return 1.f;
+    const float dx = (detection.rect.x + detection.rect.width * 0.5f - bounds.x - halfWidth) / halfWidth;
+    const float dy = (detection.rect.y + detection.rect.height * 0.5f - bounds.y - halfHeight) / halfHeight;
+
+    // Squared distance is 2 at the corners.
+    const float distance = std::min(1.f, (dx * dx + dy * dy) * 0.5f);
+    return 1.f - (1.f - CornerWeight) * distance;
+}
+
+}
+
+bool parseRankingPolicy(const char *name, RankingPolicy &policy) {
+    for (int i = 0; i < PoliciesCount; ++i) {
+        if (!strcmp(name, PolicyNames[i])) {
+            policy = static_cast<RankingPolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *getRankingPolicyName(RankingPolicy policy) {
+    return policy >= 0 && policy < PoliciesCount ? PolicyNames[policy] : "unknown";
+}
+
+std::vector<int> rankDetections(
+        const fsdk::Detection *detections,
+        int count,
+        RankingPolicy policy,
+        const fsdk::Rect &bounds
+) {
+    std::vector<int> order(std::max(count, 0));
+    std::iota(order.begin(), order.end(), 0);
+    if (policy == RankingNone)
+        return order;
+
+    std::vector<float> weights(order.size());
+    for (int i = 0; i < count; ++i) {
+        const fsdk::Detection &detection = detections[i];
+        switch (policy) {
+        case RankingArea:
+            weights[i] = static_cast<float>(detection.rect.getArea());
+            break;
+        case RankingCenter:
+            weights[i] = detection.score * getCenterWeight(detection, bounds);
+            break;
+        default:
+            weights[i] = detection.score;
+            break;
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return weights[a] > weights[b];
+    });
+    return order;
+}
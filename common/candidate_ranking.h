@@ -0,0 +1,41 @@
+#ifndef FACEENGINE_CANDIDATE_RANKING_H
+#define FACEENGINE_CANDIDATE_RANKING_H
+
+#include <FaceEngine.h>
+
+#include <vector>
+
+// Cheap ordering of detections before facial feature detection.
+// When only one face of an image is needed, feature detection on every
+// detection just to keep the most confident one is wasted work. Detections
+// are ranked from their rects and scores instead, and feature detection runs
+// on the best candidates first, stopping at the first one good enough.
+enum RankingPolicy {
+    // Detector order; every detection is a candidate.
+    RankingNone,
+
+    // Higher detection score first.
+    RankingScore,
+
+    // Larger rect first.
+    RankingArea,
+
+    // Detection score weighted by closeness of the rect center to the image center.
+    RankingCenter
+};
+
+// Parse a policy name: none, score, area or center. Returns false for an unknown name.
+bool parseRankingPolicy(const char *name, RankingPolicy &policy);
+
+const char *getRankingPolicyName(RankingPolicy policy);
+
+// Indices of the detections, best candidate first. bounds is the image rect,
+// used by the center prior.
+std::vector<int> rankDetections(
+        const fsdk::Detection *detections,
+        int count,
+        RankingPolicy policy,
+        const fsdk::Rect &bounds
+);
+
+#endif //FACEENGINE_CANDIDATE_RANKING_H
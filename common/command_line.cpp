@@ -0,0 +1,80 @@
+#include "command_line.h"
+
+#include <cstdlib>
+#include <cstring>
+
+void CommandLine::addOption(const char *name, int &value) {
+    add(name, true, [&value](const char *argument) {
+        value = atoi(argument);
+        return true;
+    });
+}
+
+void CommandLine::addOption(const char *name, float &value) {
+    add(name, true, [&value](const char *argument) {
+        value = (float)atof(argument);
+        return true;
+    });
+}
+
+void CommandLine::addOption(const char *name, const char *&value) {
+    add(name, true, [&value](const char *argument) {
+        value = argument;
+        return true;
+    });
+}
+
+void CommandLine::addOption(const char *name, const Handler &handler) {
+    add(name, true, handler);
+}
+
+void CommandLine::addFlag(const char *name, bool &flag) {
+    add(name, false, [&flag](const char *) {
+        flag = true;
+        return true;
+    });
+}
+
+void CommandLine::addDetectionMaxSide(int &detectionMaxSide) {
+    add("--detect-max-side", true, [&detectionMaxSide](const char *argument) {
+        detectionMaxSide = atoi(argument);
+        return detectionMaxSide >= 0;
+    });
+}
+
+const char *CommandLine::getDetectionMaxSideUsage() {
+    return " *detect-max-side - larger side of the image used for detection (default: full resolution)\n";
+}
+
+bool CommandLine::parse(int argc, char *argv[]) {
+    m_arguments.clear();
+    bool valid = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--", 2)) {
+            m_arguments.push_back(argv[i]);
+            continue;
+        }
+        const Option *option = nullptr;
+        for (const Option &candidate : m_options) {
+            if (candidate.name == argv[i]) {
+                option = &candidate;
+                break;
+            }
+        }
+        if (!option || (option->hasValue && i + 1 >= argc)) {
+            valid = false;
+            continue;
+        }
+        const char *value = option->hasValue ? argv[++i] : nullptr;
+        valid = option->handler(value) && valid;
+    }
+    return valid;
+}
+
+void CommandLine::add(const char *name, bool hasValue, const Handler &handler) {
+    Option option;
+    option.name = name;
+    option.hasValue = hasValue;
+    option.handler = handler;
+    m_options.push_back(option);
+}
@@ -0,0 +1,53 @@
+#ifndef FACEENGINE_COMMAND_LINE_H
+#define FACEENGINE_COMMAND_LINE_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Command line scanner shared by the examples.
+// Options start with "--" and are registered with the variable they set;
+// everything else is a positional argument, collected in order. An unknown
+// option, an option missing its value or a value its handler rejects makes
+// parse() fail, so the example prints its usage.
+class CommandLine
+{
+public:
+    // Takes the value of an option; returns false if the value is invalid.
+    typedef std::function<bool(const char *value)> Handler;
+
+    // Options followed by a value.
+    void addOption(const char *name, int &value);
+    void addOption(const char *name, float &value);
+    void addOption(const char *name, const char *&value);
+    void addOption(const char *name, const Handler &handler);
+
+    // Option without a value; sets the flag to true.
+    void addFlag(const char *name, bool &flag);
+
+    // --detect-max-side <pixels>: larger side of the downscaled copy used for
+    // detection. Negative sizes are rejected.
+    void addDetectionMaxSide(int &detectionMaxSide);
+
+    // Usage line of addDetectionMaxSide().
+    static const char *getDetectionMaxSideUsage();
+
+    // Scan the arguments after the program name. Returns false on an invalid option.
+    bool parse(int argc, char *argv[]);
+
+    const std::vector<char*> &getArguments() const { return m_arguments; }
+
+private:
+    struct Option {
+        std::string name;
+        bool hasValue;
+        Handler handler;
+    };
+
+    void add(const char *name, bool hasValue, const Handler &handler);
+
+    std::vector<Option> m_options;
+    std::vector<char*> m_arguments;
+};
+
+#endif //FACEENGINE_COMMAND_LINE_H
@@ -0,0 +1,91 @@
+#include "crowd_detector.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "detection_scaling.h"
+
+CrowdDetector::CrowdDetector(const fsdk::IDetectorPtr &detector, const Settings &settings):
+    m_detector(detector),
+    m_settings(settings),
+    m_capacity(std::max(1, std::min(settings.initialCapacity, settings.maxCapacity)))
+{}
+
+int CrowdDetector::detect(
+        const fsdk::Image &image,
+        std::vector<fsdk::Detection> &detections,
+        std::vector<fsdk::IMTCNNDetector::Landmarks> &landmarks
+) {
+    m_stats = Stats();
+
+    // Detect again with doubled buffers while the result fills them.
+    int count = 0;
+    for (;;) {
+        detections.resize(m_capacity);
+        landmarks.resize(m_capacity);
+        count = detectFaces(
+                m_detector,
+                image,
+                m_settings.detectionMaxSide,
+                &detections[0],
+                &landmarks[0],
+                m_capacity
+        );
+        if (count < 0)
+            return -1;
+        if (count < m_capacity)
+            break;
+        if (m_capacity >= m_settings.maxCapacity) {
+            m_stats.truncated = true;
+            break;
+        }
+        m_capacity = std::min(m_capacity * 2, m_settings.maxCapacity);
+        ++m_stats.retries;
+    }
+    m_stats.detected = count;
+
+    // Drop small and weak faces in place.
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        const fsdk::Detection &detection = detections[i];
+        if (std::min(detection.rect.width, detection.rect.height) < m_settings.minFaceSize) {
+            ++m_stats.tooSmall;
+            continue;
+        }
+        if (detection.score < m_settings.minScore) {
+            ++m_stats.lowScore;
+            continue;
+        }
+        if (kept != i) {
+            detections[kept] = detections[i];
+            landmarks[kept] = landmarks[i];
+        }
+        ++kept;
+    }
+
+    // Rank by score x area to pick the top faces, then order them by score.
+    std::vector<int> order(kept);
+    std::iota(order.begin(), order.end(), 0);
+    if (m_settings.topCount > 0 && kept > m_settings.topCount) {
+        auto weight = [&](int index) {
+            return detections[index].score * static_cast<float>(detections[index].rect.getArea());
+        };
+        std::partial_sort(order.begin(), order.begin() + m_settings.topCount, order.end(),
+                [&](int a, int b) { return weight(a) > weight(b); });
+        m_stats.overTop = kept - m_settings.topCount;
+        order.resize(m_settings.topCount);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return detections[a].score > detections[b].score;
+    });
+
+    std::vector<fsdk::Detection> sortedDetections(order.size());
+    std::vector<fsdk::IMTCNNDetector::Landmarks> sortedLandmarks(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        sortedDetections[i] = detections[order[i]];
+        sortedLandmarks[i] = landmarks[order[i]];
+    }
+    detections.swap(sortedDetections);
+    landmarks.swap(sortedLandmarks);
+    return static_cast<int>(detections.size());
+}
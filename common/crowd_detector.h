@@ -0,0 +1,71 @@
+#ifndef FACEENGINE_CROWD_DETECTOR_H
+#define FACEENGINE_CROWD_DETECTOR_H
+
+#include <FaceEngine.h>
+
+#include <vector>
+
+// MTCNN detection of crowd images.
+// A fixed detection array silently drops faces past its size. Here the
+// buffers grow: when a call fills them, capacity is doubled and the image is
+// detected again, and the capacity reached is kept for the next image. Faces
+// too small or too weak to be useful are dropped before any feature set or
+// warp is made for them, and the result can be limited to the N faces with
+// the largest score x area.
+class CrowdDetector
+{
+public:
+    struct Settings {
+        // Capacity of the first call.
+        int initialCapacity = 64;
+
+        // Capacity is not grown past this.
+        int maxCapacity = 4096;
+
+        // Faces with a smaller rect side are dropped; 0 keeps all.
+        int minFaceSize = 0;
+
+        // Faces with a lower detection score are dropped.
+        float minScore = 0.f;
+
+        // Number of faces kept by score x area; 0 keeps all.
+        int topCount = 0;
+
+        // Larger side of the downscaled copy used for detection; 0 means full resolution.
+        int detectionMaxSide = 0;
+    };
+
+    // Counters of the last call.
+    struct Stats {
+        int detected = 0;
+        int tooSmall = 0;
+        int lowScore = 0;
+        int overTop = 0;
+        int retries = 0;
+        // Capacity was at the maximum and still filled up.
+        bool truncated = false;
+    };
+
+    CrowdDetector(const fsdk::IDetectorPtr &detector, const Settings &settings);
+
+    // Detect, prune and rank faces. Landmarks are relative to their rect as
+    // with IMTCNNDetector. The vectors are resized to the number of faces kept,
+    // sorted by score. Returns that number, or -1 on failure.
+    int detect(
+            const fsdk::Image &image,
+            std::vector<fsdk::Detection> &detections,
+            std::vector<fsdk::IMTCNNDetector::Landmarks> &landmarks
+    );
+
+    int getCapacity() const { return m_capacity; }
+
+    const Stats &getStats() const { return m_stats; }
+
+private:
+    fsdk::IDetectorPtr m_detector;
+    Settings m_settings;
+    int m_capacity;
+    Stats m_stats;
+};
+
+#endif //FACEENGINE_CROWD_DETECTOR_H
@@ -0,0 +1,306 @@
+#include "descriptor_cache.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "io_util.h"
+#include "mapped_archive.h"
+#include "timer.h"
+
+namespace {
+
+const char EntryMagic[4] = { 'F', 'S', 'D', 'C' };
+const uint32_t EntryVersion = 3;
+
+// Header of a cache entry file, followed by the serialized descriptor.
+struct EntryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t modelVersion;
+    uint32_t detectorType;
+    uint32_t detectionMaxSide;
+    uint32_t reserved;
+    uint64_t imageHash;
+    uint64_t faceSelection;
+    double extractionMs;
+    uint64_t descriptorSize;
+};
+
+const uint64_t Prime1 = 11400714785074694791ULL;
+const uint64_t Prime2 = 14029467366897019727ULL;
+const uint64_t Prime3 = 1609587929392839161ULL;
+const uint64_t Prime4 = 9650029242287828579ULL;
+const uint64_t Prime5 = 2870177450012600261ULL;
+
+inline uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const uint8_t *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t hashRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * Prime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * Prime1;
+}
+
+inline uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= hashRound(0, value);
+    return accumulator * Prime1 + Prime4;
+}
+
+bool makeDirectory(const std::string &path) {
+#ifdef _WIN32
+    const int result = _mkdir(path.c_str());
+#else
+    const int result = mkdir(path.c_str(), 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+// Hash of the face selection settings; 0 when all of them are at their defaults.
+uint64_t hashFaceSelection(const DescriptorCache::FaceSelection &faceSelection) {
+    uint32_t minQualityBits;
+    memcpy(&minQualityBits, &faceSelection.minQuality, sizeof(minQualityBits));
+    const uint32_t values[] = {
+        static_cast<uint32_t>(faceSelection.rankingPolicy),
+        static_cast<uint32_t>(faceSelection.maxCandidates),
+        static_cast<uint32_t>(faceSelection.minFaceSize),
+        minQualityBits
+    };
+    for (uint32_t value : values) {
+        if (value != 0)
+            return DescriptorCache::hash(values, sizeof(values));
+    }
+    return 0;
+}
+
+}
+
+bool DescriptorCache::open(
+        const std::string &directory,
+        int modelVersion,
+        fsdk::ObjectDetectorClassType detectorType,
+        int detectionMaxSide,
+        const FaceSelection &faceSelection
+) {
+    if (directory.empty() || !makeDirectory(directory)) {
+        vlf::log::error("Failed to create cache directory: %s.", directory.c_str());
+        return false;
+    }
+    m_directory = directory;
+    m_modelVersion = static_cast<uint32_t>(modelVersion);
+    m_detectorType = static_cast<uint32_t>(detectorType);
+    m_detectionMaxSide = static_cast<uint32_t>(std::max(detectionMaxSide, 0));
+    m_faceSelection = hashFaceSelection(faceSelection);
+    m_stats = Stats();
+    return true;
+}
+
+bool DescriptorCache::makeKey(const std::string &imagePath, Key &key) {
+    Timer timer;
+    MappedFile file;
+    if (!file.open(imagePath, MappedFile::AccessSequential))
+        return false;
+    key.imageHash = hash(file.data(), file.size());
+    key.modelVersion = m_modelVersion;
+    key.detectorType = m_detectorType;
+    key.detectionMaxSide = m_detectionMaxSide;
+    key.faceSelection = m_faceSelection;
+    m_stats.lookupMs += timer.elapsedMs();
+    return true;
+}
+
+fsdk::IDescriptorPtr DescriptorCache::find(const Key &key, const fsdk::IDescriptorFactoryPtr &descriptorFactory) {
+    Timer timer;
+    fsdk::IDescriptorPtr descriptor;
+    EntryHeader header;
+
+    // A missing or unreadable entry is just a miss.
+    std::ifstream file(getEntryPath(key), std::ios::binary);
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+            !memcmp(header.magic, EntryMagic, sizeof(EntryMagic)) &&
+            header.version == EntryVersion &&
+            header.modelVersion == key.modelVersion &&
+            header.detectorType == key.detectorType &&
+            header.detectionMaxSide == key.detectionMaxSide &&
+            header.imageHash == key.imageHash &&
+            header.faceSelection == key.faceSelection) {
+        std::vector<uint8_t> data(static_cast<size_t>(header.descriptorSize));
+        if (!data.empty() && file.read(reinterpret_cast<char*>(&data[0]), data.size())) {
+            descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+            MappedArchive archive(data.data(), data.size());
+            if (descriptor && !descriptor->load(&archive))
+                descriptor = nullptr;
+            // Guard against a config that changed the model under the same key.
+            if (descriptor && key.modelVersion > 0 && descriptor->getModelVersion() != key.modelVersion)
+                descriptor = nullptr;
+        }
+    }
+
+    m_stats.lookupMs += timer.elapsedMs();
+    if (descriptor) {
+        ++m_stats.hits;
+        m_stats.skippedMs += header.extractionMs;
+    } else {
+        ++m_stats.misses;
+    }
+    return descriptor;
+}
+
+bool DescriptorCache::store(const Key &key, const fsdk::IDescriptor *descriptor, double extractionMs) {
+    std::vector<uint8_t> data;
+    VectorArchive vectorArchive(data);
+    if (!descriptor->save(&vectorArchive)) {
+        vlf::log::error("Failed to save descriptor.");
+        return false;
+    }
+
+    EntryHeader header;
+    memcpy(header.magic, EntryMagic, sizeof(EntryMagic));
+    header.version = EntryVersion;
+    header.modelVersion = key.modelVersion;
+    header.detectorType = key.detectorType;
+    header.detectionMaxSide = key.detectionMaxSide;
+    header.reserved = 0;
+    header.imageHash = key.imageHash;
+    header.faceSelection = key.faceSelection;
+    header.extractionMs = extractionMs;
+    header.descriptorSize = data.size();
+
+    const std::string path = getEntryPath(key);
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+                !file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            vlf::log::error("Failed to write file: %s.", tmpPath.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename() does not replace existing files on Windows.
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        vlf::log::error("Failed to rename file: %s.", tmpPath.c_str());
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+fsdk::IDescriptorPtr DescriptorCache::getOrExtract(
+        const std::string &imagePath,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const Extractor &extractor
+) {
+    Key key;
+    const bool cached = isOpen() && makeKey(imagePath, key);
+    if (cached) {
+        fsdk::IDescriptorPtr descriptor = find(key, descriptorFactory);
+        if (descriptor)
+            return descriptor;
+    }
+
+    Timer timer;
+    fsdk::IDescriptorPtr descriptor = extractor();
+    if (descriptor && cached)
+        store(key, descriptor, timer.elapsedMs());
+    return descriptor;
+}
+
+void DescriptorCache::logStats() const {
+    vlf::log::info("Descriptor cache: %d hit(s), %d miss(es), %.1f ms saved "
+            "(%.1f ms of extraction skipped, %.1f ms spent on lookups).",
+            m_stats.hits,
+            m_stats.misses,
+            m_stats.skippedMs - m_stats.lookupMs,
+            m_stats.skippedMs,
+            m_stats.lookupMs
+    );
+}
+
+uint64_t DescriptorCache::hash(const void *data, size_t size, uint64_t seed) {
+    const uint8_t *p = static_cast<const uint8_t*>(data);
+    const uint8_t *end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + Prime1 + Prime2;
+        uint64_t v2 = seed + Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - Prime1;
+        const uint8_t *limit = end - 32;
+        do {
+            v1 = hashRound(v1, read64(p));
+            v2 = hashRound(v2, read64(p + 8));
+            v3 = hashRound(v3, read64(p + 16));
+            v4 = hashRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + Prime5;
+    }
+    h += size;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= hashRound(0, read64(p));
+        h = rotateLeft(h, 27) * Prime1 + Prime4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * Prime1;
+        h = rotateLeft(h, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= *p * Prime5;
+        h = rotateLeft(h, 11) * Prime1;
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string DescriptorCache::getEntryPath(const Key &key) const {
+    char name[96];
+    snprintf(name, sizeof(name), "%016llx_m%u_d%u_s%u_f%016llx.fdc",
+            static_cast<unsigned long long>(key.imageHash),
+            key.modelVersion,
+            key.detectorType,
+            key.detectionMaxSide,
+            static_cast<unsigned long long>(key.faceSelection));
+    return m_directory + "/" + name;
+}
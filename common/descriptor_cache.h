@@ -0,0 +1,108 @@
+#ifndef FACEENGINE_DESCRIPTOR_CACHE_H
+#define FACEENGINE_DESCRIPTOR_CACHE_H
+
+#include <FaceEngine.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// On-disk cache of extracted descriptors.
+// Entries are addressed by content: a 64-bit hash (XXH64) of the image file
+// bytes, the descriptor model version, the detector type, the detection
+// resolution cap (0 for full resolution) and a hash of the settings that
+// choose which face of the image is extracted (0 for the defaults). Every
+// entry is a small file in the cache directory holding the serialized
+// descriptor and the time its extraction took, so hits can report the time
+// they saved. Entries are written to a temporary file and renamed, so an
+// interrupted run never leaves a broken entry behind.
+//
+// Not thread safe; use one cache per thread or look up from one thread only.
+class DescriptorCache
+{
+public:
+    struct Key {
+        uint64_t imageHash;
+        uint32_t modelVersion;
+        uint32_t detectorType;
+        uint32_t detectionMaxSide;
+        uint64_t faceSelection;
+    };
+
+    // Settings that change which face of an image is extracted, if any.
+    // Entries written under other settings are never returned.
+    struct FaceSelection {
+        // RankingPolicy of the candidate faces.
+        int rankingPolicy = 0;
+
+        // Number of candidate faces tried; 0 tries all.
+        int maxCandidates = 0;
+
+        // Smallest face side extracted; 0 accepts any.
+        int minFaceSize = 0;
+
+        // Lowest warp quality extracted; 0 skips the quality check.
+        float minQuality = 0.f;
+    };
+
+    struct Stats {
+        int hits = 0;
+        int misses = 0;
+        // Time spent on lookups: hashing, reading and loading.
+        double lookupMs = 0.0;
+        // Extraction time recorded in the hit entries.
+        double skippedMs = 0.0;
+    };
+
+    // Produces a descriptor on a cache miss; returns nullptr on failure.
+    typedef std::function<fsdk::IDescriptorPtr()> Extractor;
+
+    // Create the directory if needed. Model version, detector type, detection
+    // max side and face selection become part of every key.
+    bool open(
+            const std::string &directory,
+            int modelVersion,
+            fsdk::ObjectDetectorClassType detectorType,
+            int detectionMaxSide,
+            const FaceSelection &faceSelection
+    );
+
+    bool isOpen() const { return !m_directory.empty(); }
+
+    // Key of an image file; false if the file can not be read.
+    bool makeKey(const std::string &imagePath, Key &key);
+
+    // Load a cached descriptor. Returns nullptr and counts a miss if there is none.
+    fsdk::IDescriptorPtr find(const Key &key, const fsdk::IDescriptorFactoryPtr &descriptorFactory);
+
+    // Save a descriptor with the time its extraction took.
+    bool store(const Key &key, const fsdk::IDescriptor *descriptor, double extractionMs);
+
+    // Look an image file up; on a miss run the extractor and store its result.
+    // Without an open cache the extractor always runs.
+    fsdk::IDescriptorPtr getOrExtract(
+            const std::string &imagePath,
+            const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+            const Extractor &extractor
+    );
+
+    const Stats &getStats() const { return m_stats; }
+
+    // Print hit and miss counters and the time saved to the log.
+    void logStats() const;
+
+    // XXH64 of a memory block.
+    static uint64_t hash(const void *data, size_t size, uint64_t seed = 0);
+
+private:
+    std::string getEntryPath(const Key &key) const;
+
+    std::string m_directory;
+    uint32_t m_modelVersion = 0;
+    uint32_t m_detectorType = 0;
+    uint32_t m_detectionMaxSide = 0;
+    uint64_t m_faceSelection = 0;
+    Stats m_stats;
+};
+
+#endif //FACEENGINE_DESCRIPTOR_CACHE_H
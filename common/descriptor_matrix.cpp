@@ -0,0 +1,161 @@
+#include "descriptor_matrix.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <utility>
+
+namespace {
+
+// Row alignment and padding in floats (64 bytes).
+const size_t RowAlignment = 16;
+
+size_t alignedOffset(const std::vector<float> &storage) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+    const uintptr_t bytes = RowAlignment * sizeof(float);
+    return ((bytes - address % bytes) % bytes) / sizeof(float);
+}
+
+}
+
+bool DescriptorMatrix::exportDescriptor(const fsdk::IDescriptor *descriptor, std::vector<float> &row) {
+    // CNN descriptor data is an array of floats.
+    const uint32_t length = descriptor->getDescriptorLength();
+    if (length == 0 || length % sizeof(float) != 0) {
+        vlf::log::error("Unexpected descriptor length: %d.", static_cast<int>(length));
+        return false;
+    }
+    const size_t dimension = length / sizeof(float);
+    const size_t stride = (dimension + RowAlignment - 1) / RowAlignment * RowAlignment;
+
+    row.assign(stride, 0.f);
+    if (!descriptor->getDescriptor(reinterpret_cast<uint8_t*>(row.data()))) {
+        vlf::log::error("Failed to get descriptor data.");
+        return false;
+    }
+    return true;
+}
+
+bool DescriptorMatrix::add(const fsdk::IDescriptor *descriptor) {
+    std::vector<float> row;
+    if (!exportDescriptor(descriptor, row))
+        return false;
+
+    const int dimension = static_cast<int>(descriptor->getDescriptorLength() / sizeof(float));
+    if (m_count == 0) {
+        m_dimension = dimension;
+        m_stride = row.size();
+    } else if (dimension != m_dimension) {
+        vlf::log::error("Descriptor dimension %d does not match matrix dimension %d.",
+                dimension, m_dimension);
+        return false;
+    }
+
+    if (m_storage.size() < (m_count + 1) * m_stride + RowAlignment)
+        reserve(std::max(16, m_count * 2));
+
+    memcpy(data() + m_stride * m_count, row.data(), m_stride * sizeof(float));
+    ++m_count;
+    return true;
+}
+
+void DescriptorMatrix::reserve(int count) {
+    if (m_stride == 0 || m_storage.size() >= count * m_stride + RowAlignment)
+        return;
+
+    // Reallocation may change alignment, so rows are copied explicitly.
+    std::vector<float> storage(count * m_stride + RowAlignment, 0.f);
+    if (m_count > 0)
+        memcpy(storage.data() + alignedOffset(storage), data(), m_count * m_stride * sizeof(float));
+    m_storage.swap(storage);
+}
+
+void DescriptorMatrix::clear() {
+    m_count = 0;
+    m_dimension = 0;
+    m_stride = 0;
+    m_storage.clear();
+}
+
+const float *DescriptorMatrix::data() const {
+    return m_storage.data() + alignedOffset(m_storage);
+}
+
+float *DescriptorMatrix::data() {
+    return m_storage.data() + alignedOffset(m_storage);
+}
+
+BruteForceMatcher::BruteForceMatcher(const DescriptorMatrix &matrix, SimdLevel level):
+    m_matrix(matrix),
+    m_level(level),
+    m_l2Sqr(getL2SqrFunc(level))
+{}
+
+void BruteForceMatcher::computeDistances(const float *query, float *distances) const {
+    const size_t stride = m_matrix.getStride();
+    const int count = m_matrix.getCount();
+    for (int i = 0; i < count; ++i)
+        distances[i] = m_l2Sqr(query, m_matrix.getRow(i), stride);
+}
+
+int BruteForceMatcher::search(const float *query, int k, int *indices) const {
+    const size_t stride = m_matrix.getStride();
+    const int count = m_matrix.getCount();
+    k = std::min(k, count);
+    if (k <= 0)
+        return 0;
+
+    // Max-heap of the k closest rows seen so far.
+    typedef std::pair<float, int> Candidate;
+    std::priority_queue<Candidate> heap;
+    for (int i = 0; i < count; ++i) {
+        const float distance = m_l2Sqr(query, m_matrix.getRow(i), stride);
+        if (static_cast<int>(heap.size()) < k) {
+            heap.push(Candidate(distance, i));
+        } else if (distance < heap.top().first) {
+            heap.pop();
+            heap.push(Candidate(distance, i));
+        }
+    }
+
+    for (int i = k - 1; i >= 0; --i) {
+        indices[i] = heap.top().second;
+        heap.pop();
+    }
+    return k;
+}
+
+int BruteForceMatcher::match(
+        const fsdk::IDescriptor *descriptor,
+        const fsdk::IDescriptorBatch *descriptorBatch,
+        fsdk::IDescriptorMatcher *descriptorMatcher,
+        int k,
+        int *indices,
+        fsdk::MatchingResult *results
+) const {
+    // Query must be 64 byte aligned like the matrix rows.
+    std::vector<float> row;
+    if (!DescriptorMatrix::exportDescriptor(descriptor, row))
+        return -1;
+    if (row.size() != m_matrix.getStride()) {
+        vlf::log::error("Query descriptor does not match the gallery.");
+        return -1;
+    }
+    std::vector<float> storage(row.size() + RowAlignment);
+    float *query = storage.data() + alignedOffset(storage);
+    std::copy(row.begin(), row.end(), query);
+
+    const int found = search(query, k, indices);
+    if (found <= 0)
+        return found;
+
+    fsdk::Result<fsdk::FSDKError> descriptorMatcherResult =
+            descriptorMatcher->match(descriptor, descriptorBatch, indices, found, results);
+    if (descriptorMatcherResult.isError()) {
+        vlf::log::error("Failed to match. Reason: %s.", descriptorMatcherResult.what());
+        return -1;
+    }
+    return found;
+}
@@ -0,0 +1,79 @@
+#ifndef FACEENGINE_DESCRIPTOR_MATRIX_H
+#define FACEENGINE_DESCRIPTOR_MATRIX_H
+
+#include <FaceEngine.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "simd.h"
+
+// Descriptors copied into one contiguous float matrix.
+// Rows are 64 byte aligned and zero padded to a multiple of 16 values,
+// so vector kernels need neither unaligned loads nor tail loops.
+class DescriptorMatrix
+{
+public:
+    // Append raw data of a descriptor. All descriptors must have the same length.
+    bool add(const fsdk::IDescriptor *descriptor);
+
+    // Convert raw descriptor data into a padded float row.
+    static bool exportDescriptor(const fsdk::IDescriptor *descriptor, std::vector<float> &row);
+
+    void reserve(int count);
+    void clear();
+
+    int getCount() const { return m_count; }
+    int getDimension() const { return m_dimension; }
+    size_t getStride() const { return m_stride; }
+
+    const float *getRow(int index) const { return data() + m_stride * index; }
+
+private:
+    const float *data() const;
+    float *data();
+
+    int m_count = 0;
+    int m_dimension = 0;
+    size_t m_stride = 0;
+    // Storage with room to align the first row.
+    std::vector<float> m_storage;
+};
+
+// Exact 1:N search over a DescriptorMatrix.
+// Rows are ranked by squared L2 distance with the best kernel for this CPU.
+// The k nearest rows are then scored by the SDK matcher against the batch the
+// matrix mirrors, so reported similarities are exactly those of
+// IDescriptorMatcher::match. The similarity mapping is monotonic in distance,
+// so the ranking is the same.
+class BruteForceMatcher
+{
+public:
+    explicit BruteForceMatcher(const DescriptorMatrix &matrix, SimdLevel level = detectSimdLevel());
+
+    // Squared L2 distances from a padded query row to every matrix row.
+    void computeDistances(const float *query, float *distances) const;
+
+    // Indices of the k nearest rows, closest first. Returns number found.
+    int search(const float *query, int k, int *indices) const;
+
+    // Search and score the k nearest descriptors of the batch with the SDK matcher.
+    // Returns number of results or -1 on failure.
+    int match(
+            const fsdk::IDescriptor *descriptor,
+            const fsdk::IDescriptorBatch *descriptorBatch,
+            fsdk::IDescriptorMatcher *descriptorMatcher,
+            int k,
+            int *indices,
+            fsdk::MatchingResult *results
+    ) const;
+
+    SimdLevel getSimdLevel() const { return m_level; }
+
+private:
+    const DescriptorMatrix &m_matrix;
+    SimdLevel m_level;
+    L2SqrFunc m_l2Sqr;
+};
+
+#endif //FACEENGINE_DESCRIPTOR_MATRIX_H
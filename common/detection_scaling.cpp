@@ -0,0 +1,139 @@
+#include "detection_scaling.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+void scaleDetection(
+        fsdk::Detection &detection,
+        fsdk::IMTCNNDetector::Landmarks *landmarks,
+        float scaleX,
+        float scaleY,
+        const fsdk::Rect &bounds
+) {
+    const fsdk::Rect source = detection.rect;
+    const int left = static_cast<int>(std::floor(source.x * scaleX));
+    const int top = static_cast<int>(std::floor(source.y * scaleY));
+    const int right = static_cast<int>(std::ceil((source.x + source.width) * scaleX));
+    const int bottom = static_cast<int>(std::ceil((source.y + source.height) * scaleY));
+    detection.rect = fsdk::Rect(left, top, right - left, bottom - top) & bounds;
+
+    if (!landmarks)
+        return;
+    for (int i = 0; i < fsdk::IMTCNNDetector::Landmarks::LandmarksCount; ++i) {
+        fsdk::Point2f &point = landmarks->landmarks[i];
+        point.x = (point.x + source.x) * scaleX - detection.rect.x;
+        point.y = (point.y + source.y) * scaleY - detection.rect.y;
+    }
+}
+
+bool downscaleImage(const fsdk::Image &image, int maxSide, fsdk::Image &result) {
+    if (!image) {
+        vlf::log::error("Source image is invalid.");
+        return false;
+    }
+
+    const int width = image.getWidth();
+    const int height = image.getHeight();
+    const int side = std::max(width, height);
+    if (maxSide <= 0 || side <= maxSide) {
+        result = image;
+        return true;
+    }
+
+    const fsdk::Format format = image.getFormat();
+    if (format == fsdk::Format::Unknown || format == fsdk::Format::R16) {
+        vlf::log::error("Downscaling supports 8-bit images only.");
+        return false;
+    }
+    const int pixelSize = format.getBytePerPixel();
+
+    const int targetWidth = std::max(1, static_cast<int>((static_cast<int64_t>(width) * maxSide + side / 2) / side));
+    const int targetHeight = std::max(1, static_cast<int>((static_cast<int64_t>(height) * maxSide + side / 2) / side));
+    fsdk::Image target(targetWidth, targetHeight, format);
+    if (!target) {
+        vlf::log::error("Failed to create image %dx%d.", targetWidth, targetHeight);
+        return false;
+    }
+
+    // Source column span of every target column.
+    std::vector<int> columns(targetWidth + 1);
+    for (int x = 0; x <= targetWidth; ++x)
+        columns[x] = static_cast<int>(static_cast<int64_t>(x) * width / targetWidth);
+
+    // Column sums of the source rows covered by one target row.
+    std::vector<uint32_t> sums(static_cast<size_t>(targetWidth) * pixelSize);
+    for (int targetY = 0; targetY < targetHeight; ++targetY) {
+        const int top = static_cast<int>(static_cast<int64_t>(targetY) * height / targetHeight);
+        const int bottom = static_cast<int>(static_cast<int64_t>(targetY + 1) * height / targetHeight);
+
+        std::fill(sums.begin(), sums.end(), 0u);
+        for (int y = top; y < bottom; ++y) {
+            const uint8_t *row = image.getScanLineAs<uint8_t>(y);
+            uint32_t *sum = sums.data();
+            for (int x = 0; x < targetWidth; ++x, sum += pixelSize) {
+                for (const uint8_t *pixel = row + columns[x] * pixelSize;
+                     pixel != row + columns[x + 1] * pixelSize;
+                     pixel += pixelSize) {
+                    for (int c = 0; c < pixelSize; ++c)
+                        sum[c] += pixel[c];
+                }
+            }
+        }
+
+        uint8_t *output = target.getScanLineAs<uint8_t>(targetY);
+        const uint32_t *sum = sums.data();
+        for (int x = 0; x < targetWidth; ++x, sum += pixelSize, output += pixelSize) {
+            const uint32_t count = static_cast<uint32_t>((bottom - top) * (columns[x + 1] - columns[x]));
+            for (int c = 0; c < pixelSize; ++c)
+                output[c] = static_cast<uint8_t>((sum[c] + count / 2) / count);
+        }
+    }
+
+    result = target;
+    return true;
+}
+
+int detectFaces(
+        const fsdk::IDetectorPtr &detector,
+        const fsdk::Image &image,
+        int maxSide,
+        fsdk::Detection *detections,
+        fsdk::IMTCNNDetector::Landmarks *landmarks,
+        int maxCount
+) {
+    fsdk::Image detectionImage;
+    if (!downscaleImage(image, maxSide, detectionImage))
+        return -1;
+
+    fsdk::ResultValue<fsdk::FSDKError, int> detectorResult = landmarks ?
+            detector.as<fsdk::IMTCNNDetector>()->detect(
+                    detectionImage,
+                    detectionImage.getRect(),
+                    detections,
+                    landmarks,
+                    maxCount
+            ) :
+            detector->detect(
+                    detectionImage,
+                    detectionImage.getRect(),
+                    detections,
+                    maxCount
+            );
+    if (detectorResult.isError()) {
+        vlf::log::error("Failed to detect faces. Reason: %s.", detectorResult.what());
+        return -1;
+    }
+    const int detectionsCount = detectorResult.getValue();
+
+    if (detectionImage.getWidth() != image.getWidth() || detectionImage.getHeight() != image.getHeight()) {
+        const float scaleX = static_cast<float>(image.getWidth()) / detectionImage.getWidth();
+        const float scaleY = static_cast<float>(image.getHeight()) / detectionImage.getHeight();
+        for (int i = 0; i < detectionsCount; ++i)
+            scaleDetection(detections[i], landmarks ? &landmarks[i] : nullptr, scaleX, scaleY, image.getRect());
+    }
+    return detectionsCount;
+}
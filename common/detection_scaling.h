@@ -0,0 +1,39 @@
+#ifndef FACEENGINE_DETECTION_SCALING_H
+#define FACEENGINE_DETECTION_SCALING_H
+
+#include <FaceEngine.h>
+
+// Map a detection found on a resized image back to the original image.
+// Scale factors are original size over resized size; the rect is clipped to
+// the original image bounds. MTCNN landmarks are relative to the detection
+// rect, so they are moved to the new rect origin as well. Pass nullptr
+// landmarks for detectors that do not produce them.
+void scaleDetection(
+        fsdk::Detection &detection,
+        fsdk::IMTCNNDetector::Landmarks *landmarks,
+        float scaleX,
+        float scaleY,
+        const fsdk::Rect &bounds
+);
+
+// Area-average downscale so that the larger side is at most maxSide pixels.
+// Every target pixel is the rounded mean of the source pixels it covers, which
+// keeps small faces smoother than nearest neighbour sampling. Only 8-bit
+// formats are supported. If maxSide is not positive or the image is small
+// enough already, the result shares the source image data.
+bool downscaleImage(const fsdk::Image &image, int maxSide, fsdk::Image &result);
+
+// Detect faces on a copy of the image downscaled to maxSide and map the
+// detections back to the image. Landmarks are filled by the MTCNN detector;
+// pass nullptr to use the plain IDetector interface (DPM on grayscale images).
+// Returns the number of faces, or -1 on failure.
+int detectFaces(
+        const fsdk::IDetectorPtr &detector,
+        const fsdk::Image &image,
+        int maxSide,
+        fsdk::Detection *detections,
+        fsdk::IMTCNNDetector::Landmarks *landmarks,
+        int maxCount
+);
+
+#endif //FACEENGINE_DETECTION_SCALING_H
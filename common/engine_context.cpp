@@ -0,0 +1,305 @@
+#include "engine_context.h"
+#include "timer.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+
+namespace {
+
+// Side of the warped face images the CNN extractor takes.
+const int WarpSize = 250;
+
+}
+
+bool EngineContext::init(const Settings &settings) {
+    m_settings = settings;
+    m_timings.clear();
+
+    Timer timer;
+
+    // Create config FaceEngine root SDK object.
+    m_config = fsdk::acquire(fsdk::createSettingsProvider(m_settings.configPath.c_str()));
+    if (!m_config) {
+        vlf::log::error("Failed to load face engine config instance.");
+        return false;
+    }
+    if (m_settings.descriptorModel > 0)
+        m_config->setValue("DescriptorFactory::Settings", "model", m_settings.descriptorModel);
+    addTiming("config", timer.elapsedMs());
+
+    // Create FaceEngine root SDK object.
+    timer.reset();
+    m_faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
+    if (!m_faceEngine) {
+        vlf::log::error("Failed to create face engine instance.");
+        return false;
+    }
+    m_faceEngine->setSettingsProvider(m_config);
+    m_faceEngine->setDataDirectory(m_settings.dataPath.c_str());
+    addTiming("faceEngine", timer.elapsedMs());
+
+    if (m_settings.preload)
+        return preload();
+
+    return true;
+}
+
+fsdk::IDetectorFactoryPtr EngineContext::getDetectorFactory() {
+    if (!m_detectorFactory) {
+        Timer timer;
+        m_detectorFactory = fsdk::acquire(m_faceEngine->createDetectorFactory());
+        if (!m_detectorFactory) {
+            vlf::log::error("Failed to create face detector factory instance.");
+            return nullptr;
+        }
+        addTiming("detectorFactory", timer.elapsedMs());
+    }
+    return m_detectorFactory;
+}
+
+fsdk::IFeatureFactoryPtr EngineContext::getFeatureFactory() {
+    if (!m_featureFactory) {
+        Timer timer;
+        m_featureFactory = fsdk::acquire(m_faceEngine->createFeatureFactory());
+        if (!m_featureFactory) {
+            vlf::log::error("Failed to create face feature factory instance.");
+            return nullptr;
+        }
+        addTiming("featureFactory", timer.elapsedMs());
+    }
+    return m_featureFactory;
+}
+
+fsdk::IDescriptorFactoryPtr EngineContext::getDescriptorFactory() {
+    if (!m_descriptorFactory) {
+        Timer timer;
+        m_descriptorFactory = fsdk::acquire(m_faceEngine->createDescriptorFactory());
+        if (!m_descriptorFactory) {
+            vlf::log::error("Failed to create face descriptor factory instance.");
+            return nullptr;
+        }
+        addTiming("descriptorFactory", timer.elapsedMs());
+    }
+    return m_descriptorFactory;
+}
+
+fsdk::IEstimatorFactoryPtr EngineContext::getEstimatorFactory() {
+    if (!m_estimatorFactory) {
+        Timer timer;
+        m_estimatorFactory = fsdk::acquire(m_faceEngine->createEstimatorFactory());
+        if (!m_estimatorFactory) {
+            vlf::log::error("Failed to create face estimator factory instance.");
+            return nullptr;
+        }
+        addTiming("estimatorFactory", timer.elapsedMs());
+    }
+    return m_estimatorFactory;
+}
+
+fsdk::IDetectorPtr EngineContext::getDetector() {
+    if (!m_detector) {
+        fsdk::IDetectorFactoryPtr detectorFactory = getDetectorFactory();
+        if (!detectorFactory)
+            return nullptr;
+        Timer timer;
+        m_detector = fsdk::acquire(detectorFactory->createDetector(m_settings.detectorType));
+        if (!m_detector) {
+            vlf::log::error("Failed to create face detector instance.");
+            return nullptr;
+        }
+        addTiming("detector", timer.elapsedMs());
+    }
+    return m_detector;
+}
+
+fsdk::IFeatureDetectorPtr EngineContext::getFeatureDetector() {
+    if (!m_featureDetector) {
+        fsdk::IFeatureFactoryPtr featureFactory = getFeatureFactory();
+        if (!featureFactory)
+            return nullptr;
+        Timer timer;
+        m_featureDetector = fsdk::acquire(featureFactory->createDetector(fsdk::FET_VGG));
+        if (!m_featureDetector) {
+            vlf::log::error("Failed to create face feature detector instance.");
+            return nullptr;
+        }
+        addTiming("featureDetector", timer.elapsedMs());
+    }
+    return m_featureDetector;
+}
+
+fsdk::IWarperPtr EngineContext::getWarper() {
+    if (!m_warper) {
+        fsdk::IDescriptorFactoryPtr descriptorFactory = getDescriptorFactory();
+        if (!descriptorFactory)
+            return nullptr;
+        Timer timer;
+        m_warper = fsdk::acquire(descriptorFactory->createWarper(fsdk::DT_CNN));
+        if (!m_warper) {
+            vlf::log::error("Failed to create face warper instance.");
+            return nullptr;
+        }
+        addTiming("warper", timer.elapsedMs());
+    }
+    return m_warper;
+}
+
+fsdk::IDescriptorExtractorPtr EngineContext::getExtractor() {
+    if (!m_extractor) {
+        fsdk::IDescriptorFactoryPtr descriptorFactory = getDescriptorFactory();
+        if (!descriptorFactory)
+            return nullptr;
+        Timer timer;
+        m_extractor = fsdk::acquire(descriptorFactory->createExtractor(fsdk::DT_CNN));
+        if (!m_extractor) {
+            vlf::log::error("Failed to create face descriptor extractor instance.");
+            return nullptr;
+        }
+        addTiming("extractor", timer.elapsedMs());
+    }
+    return m_extractor;
+}
+
+fsdk::IDescriptorMatcherPtr EngineContext::getMatcher() {
+    if (!m_matcher) {
+        fsdk::IDescriptorFactoryPtr descriptorFactory = getDescriptorFactory();
+        if (!descriptorFactory)
+            return nullptr;
+        Timer timer;
+        m_matcher = fsdk::acquire(descriptorFactory->createMatcher(fsdk::DT_CNN));
+        if (!m_matcher) {
+            vlf::log::error("Failed to create face descriptor matcher instance.");
+            return nullptr;
+        }
+        addTiming("matcher", timer.elapsedMs());
+    }
+    return m_matcher;
+}
+
+fsdk::IQualityEstimatorPtr EngineContext::getQualityEstimator() {
+    if (!m_qualityEstimator) {
+        fsdk::IEstimatorFactoryPtr estimatorFactory = getEstimatorFactory();
+        if (!estimatorFactory)
+            return nullptr;
+        Timer timer;
+        m_qualityEstimator =
+                fsdk::acquire(static_cast<fsdk::IQualityEstimator*>(
+                        estimatorFactory->createEstimator(fsdk::ET_QUALITY)
+                ));
+        if (!m_qualityEstimator) {
+            vlf::log::error("Failed to create face quality estimator instance.");
+            return nullptr;
+        }
+        addTiming("qualityEstimator", timer.elapsedMs());
+    }
+    return m_qualityEstimator;
+}
+
+fsdk::IComplexEstimatorPtr EngineContext::getComplexEstimator() {
+    if (!m_complexEstimator) {
+        fsdk::IEstimatorFactoryPtr estimatorFactory = getEstimatorFactory();
+        if (!estimatorFactory)
+            return nullptr;
+        Timer timer;
+        m_complexEstimator =
+                fsdk::acquire(static_cast<fsdk::IComplexEstimator*>(
+                        estimatorFactory->createEstimator(fsdk::ET_COMPLEX)
+                ));
+        if (!m_complexEstimator) {
+            vlf::log::error("Failed to create face complex estimator instance.");
+            return nullptr;
+        }
+        addTiming("complexEstimator", timer.elapsedMs());
+    }
+    return m_complexEstimator;
+}
+
+int EngineContext::getDescriptorModel() const {
+    if (m_settings.descriptorModel > 0)
+        return m_settings.descriptorModel;
+    if (!m_config)
+        return 0;
+    return m_config->getValue("DescriptorFactory::Settings", "model").asInt(0);
+}
+
+double EngineContext::getTotalLoadMs() const {
+    double total = 0.0;
+    for (const LoadTiming &timing : m_timings)
+        total += timing.ms;
+    return total;
+}
+
+void EngineContext::logTimings() const {
+    for (const LoadTiming &timing : m_timings)
+        vlf::log::info("Load time %s: %.2f ms.", timing.name.c_str(), timing.ms);
+    vlf::log::info("Load time total: %.2f ms.", getTotalLoadMs());
+}
+
+bool EngineContext::preload() {
+    if (!getDetector())
+        return false;
+    if (m_settings.useFeatureDetector && !getFeatureDetector())
+        return false;
+    if (m_settings.useWarper && !getWarper())
+        return false;
+    if (m_settings.useExtractor && !getExtractor())
+        return false;
+    if (m_settings.useMatcher && !getMatcher())
+        return false;
+    if (m_settings.useEstimators && (!getQualityEstimator() || !getComplexEstimator()))
+        return false;
+
+    warmUp();
+
+    return true;
+}
+
+void EngineContext::warmUp() {
+    // Models may finish their initialization on the first call.
+    // Run the detector and the extractor once on blank images so that the
+    // first real request does not pay for it.
+    Timer timer;
+
+    fsdk::Image image(640, 480, fsdk::Format::R8G8B8);
+    std::fill(image.getDataAs<uint8_t>(), image.getDataAs<uint8_t>() + image.getDataSize(), uint8_t(0));
+
+    enum { MaxDetections = 1 };
+    fsdk::Detection detections[MaxDetections];
+    fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
+
+    if (m_settings.detectorType == fsdk::ODT_MTCNN) {
+        m_detector.as<fsdk::IMTCNNDetector>()->detect(
+                image,
+                image.getRect(),
+                &detections[0],
+                &landmarks[0],
+                MaxDetections
+        );
+    } else {
+        fsdk::Image imageR;
+        image.convert(imageR, fsdk::Format::R8);
+        m_detector->detect(imageR, imageR.getRect(), &detections[0], MaxDetections);
+    }
+    addTiming("warmUpDetector", timer.elapsedMs());
+
+    if (!m_extractor)
+        return;
+
+    // Extraction from a blank warp runs the whole descriptor network.
+    timer.reset();
+    fsdk::IDescriptorPtr descriptor = fsdk::acquire(m_descriptorFactory->createDescriptor(fsdk::DT_CNN));
+    if (!descriptor)
+        return;
+    fsdk::Image warp(WarpSize, WarpSize, fsdk::Format::B8G8R8);
+    std::fill(warp.getDataAs<uint8_t>(), warp.getDataAs<uint8_t>() + warp.getDataSize(), uint8_t(0));
+    m_extractor->extractFromWarpedImage(warp, descriptor);
+    addTiming("warmUpExtractor", timer.elapsedMs());
+}
+
+void EngineContext::addTiming(const char *name, double ms) {
+    LoadTiming timing;
+    timing.name = name;
+    timing.ms = ms;
+    m_timings.push_back(timing);
+}
@@ -0,0 +1,104 @@
+#ifndef FACEENGINE_ENGINE_CONTEXT_H
+#define FACEENGINE_ENGINE_CONTEXT_H
+
+#include <FaceEngine.h>
+
+#include <string>
+#include <vector>
+
+// Owns the config, the SDK root object, the factories and the processing
+// objects the examples need. Every object is created at most once; by default
+// objects are created on first request, in preload mode everything is
+// brought up (and the detector and the extractor warmed up) inside init().
+// Each creation is timed so that startup cost can be inspected.
+class EngineContext
+{
+public:
+    struct Settings {
+        // Path to the SDK data directory.
+        std::string dataPath = "./data/";
+
+        // Path to the SDK config file.
+        std::string configPath = "./data/faceengine.conf";
+
+        // Descriptor model version; 0 keeps the value from the config.
+        int descriptorModel = 0;
+
+        // Face detector type.
+        fsdk::ObjectDetectorClassType detectorType = fsdk::ODT_MTCNN;
+
+        // Create every object during init() and run a warm-up detection and extraction.
+        bool preload = false;
+
+        // Components brought up in preload mode.
+        bool useFeatureDetector = false;
+        bool useWarper = true;
+        bool useExtractor = true;
+        bool useMatcher = true;
+        bool useEstimators = false;
+    };
+
+    // Time spent creating one SDK object.
+    struct LoadTiming {
+        std::string name;
+        double ms;
+    };
+
+    // Create config and root SDK object. Returns false on failure.
+    bool init(const Settings &settings);
+
+    // Factories.
+    const fsdk::IFaceEnginePtr &getFaceEngine() const { return m_faceEngine; }
+    fsdk::IDetectorFactoryPtr getDetectorFactory();
+    fsdk::IFeatureFactoryPtr getFeatureFactory();
+    fsdk::IDescriptorFactoryPtr getDescriptorFactory();
+    fsdk::IEstimatorFactoryPtr getEstimatorFactory();
+
+    // Processing objects. All return nullptr on failure.
+    fsdk::IDetectorPtr getDetector();
+    fsdk::IFeatureDetectorPtr getFeatureDetector();
+    fsdk::IWarperPtr getWarper();
+    fsdk::IDescriptorExtractorPtr getExtractor();
+    fsdk::IDescriptorMatcherPtr getMatcher();
+    fsdk::IQualityEstimatorPtr getQualityEstimator();
+    fsdk::IComplexEstimatorPtr getComplexEstimator();
+
+    const Settings &getSettings() const { return m_settings; }
+
+    // Descriptor model version in use: from the settings or, if not set there, from the config.
+    int getDescriptorModel() const;
+
+    // Creation timings in creation order.
+    const std::vector<LoadTiming> &getTimings() const { return m_timings; }
+
+    // Sum of all creation timings.
+    double getTotalLoadMs() const;
+
+    // Print timings to the log.
+    void logTimings() const;
+
+private:
+    bool preload();
+    void warmUp();
+    void addTiming(const char *name, double ms);
+
+    Settings m_settings;
+    std::vector<LoadTiming> m_timings;
+
+    fsdk::ISettingsProviderPtr m_config;
+    fsdk::IFaceEnginePtr m_faceEngine;
+    fsdk::IDetectorFactoryPtr m_detectorFactory;
+    fsdk::IFeatureFactoryPtr m_featureFactory;
+    fsdk::IDescriptorFactoryPtr m_descriptorFactory;
+    fsdk::IEstimatorFactoryPtr m_estimatorFactory;
+
+    fsdk::IDetectorPtr m_detector;
+    fsdk::IFeatureDetectorPtr m_featureDetector;
+    fsdk::IWarperPtr m_warper;
+    fsdk::IDescriptorExtractorPtr m_extractor;
+    fsdk::IDescriptorMatcherPtr m_matcher;
+    fsdk::IQualityEstimatorPtr m_qualityEstimator;
+    fsdk::IComplexEstimatorPtr m_complexEstimator;
+};
+
+#endif //FACEENGINE_ENGINE_CONTEXT_H
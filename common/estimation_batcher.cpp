@@ -0,0 +1,137 @@
+#include "estimation_batcher.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "timer.h"
+
+EstimationBatcher::~EstimationBatcher() {
+    stop();
+}
+
+bool EstimationBatcher::start(
+        const fsdk::IQualityEstimatorPtr &qualityEstimator,
+        const fsdk::IComplexEstimatorPtr &complexEstimator,
+        const Settings &settings
+) {
+    stop();
+
+    if (!qualityEstimator || !complexEstimator) {
+        vlf::log::error("Failed to start estimation batcher: estimators are not created.");
+        return false;
+    }
+    m_qualityEstimator = qualityEstimator;
+    m_complexEstimator = complexEstimator;
+    m_settings = settings;
+    m_settings.batchSize = std::max(1, m_settings.batchSize);
+    m_settings.maxWaitMs = std::max(0, m_settings.maxWaitMs);
+    size_t queueCapacity = m_settings.queueCapacity;
+    if (queueCapacity == 0)
+        queueCapacity = static_cast<size_t>(m_settings.batchSize) * 2;
+    m_stats = Stats();
+
+    m_queue.reset(new BoundedQueue<Task>(queueCapacity));
+    m_thread = std::thread(&EstimationBatcher::run, this);
+    return true;
+}
+
+void EstimationBatcher::stop() {
+    if (m_queue)
+        m_queue->close();
+    if (m_thread.joinable())
+        m_thread.join();
+    m_queue.reset();
+}
+
+std::future<EstimationBatcher::Estimation> EstimationBatcher::submit(const fsdk::Image &warp) {
+    Task task;
+    task.warp = warp;
+    std::future<Estimation> future = task.promise.get_future();
+    if (!m_queue || !m_queue->push(std::move(task))) {
+        // The task was not queued; resolve it right away.
+        std::promise<Estimation> rejected;
+        future = rejected.get_future();
+        Estimation estimation;
+        estimation.failed = true;
+        rejected.set_value(estimation);
+    }
+    return future;
+}
+
+EstimationBatcher::Stats EstimationBatcher::getStats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+void EstimationBatcher::logStats() const {
+    const Stats stats = getStats();
+    vlf::log::info("Estimated %d warp(s) in %d batch(es), %d full.", stats.warps, stats.batches, stats.fullBatches);
+    if (stats.warps > 0)
+        vlf::log::info("Quality: %.3f ms per warp, attributes: %.3f ms per warp.",
+                stats.qualityMs / stats.warps, stats.attributesMs / stats.warps);
+}
+
+void EstimationBatcher::run() {
+    std::vector<Task> batch;
+    batch.reserve(m_settings.batchSize);
+    Task task;
+    while (m_queue->pop(task)) {
+        // The first warp starts the wait for the rest of the batch.
+        const std::chrono::steady_clock::time_point deadline =
+                std::chrono::steady_clock::now() + std::chrono::milliseconds(m_settings.maxWaitMs);
+        batch.push_back(std::move(task));
+        while (static_cast<int>(batch.size()) < m_settings.batchSize && m_queue->popUntil(task, deadline))
+            batch.push_back(std::move(task));
+
+        estimate(batch);
+        batch.clear();
+    }
+}
+
+void EstimationBatcher::estimate(std::vector<Task> &batch) {
+    std::vector<Estimation> estimations(batch.size());
+
+    // Quality sweep.
+    Timer timer;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        fsdk::Result<fsdk::FSDKError> qualityEstimatorResult =
+                m_qualityEstimator->estimate(batch[i].warp, &estimations[i].quality);
+        if (qualityEstimatorResult.isError()) {
+            vlf::log::error("Failed to get quality estimate. Reason: %s.", qualityEstimatorResult.what());
+            estimations[i].failed = true;
+        }
+    }
+    const double qualityMs = timer.elapsedMs();
+
+    // Attribute sweep over the warps good enough for it.
+    timer.reset();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Estimation &estimation = estimations[i];
+        if (estimation.failed || estimation.quality < m_settings.minQuality)
+            continue;
+        fsdk::Result<fsdk::FSDKError> complexEstimatorResult =
+                m_complexEstimator->estimate(batch[i].warp, estimation.attributes);
+        if (complexEstimatorResult.isError()) {
+            vlf::log::error("Failed to get complex estimate. Reason: %s.", complexEstimatorResult.what());
+            estimation.failed = true;
+            continue;
+        }
+        estimation.hasAttributes = true;
+    }
+    const double attributesMs = timer.elapsedMs();
+
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.warps += static_cast<int>(batch.size());
+        ++m_stats.batches;
+        if (static_cast<int>(batch.size()) == m_settings.batchSize)
+            ++m_stats.fullBatches;
+        m_stats.qualityMs += qualityMs;
+        m_stats.attributesMs += attributesMs;
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i)
+        batch[i].promise.set_value(estimations[i]);
+}
@@ -0,0 +1,101 @@
+#ifndef FACEENGINE_ESTIMATION_BATCHER_H
+#define FACEENGINE_ESTIMATION_BATCHER_H
+
+#include <FaceEngine.h>
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+
+// Quality and attribute estimation of warps in batches.
+// Warps submitted from any number of faces and images are collected into
+// batches of a fixed size on one thread. A batch is estimated in two sweeps,
+// the quality estimator over every warp and then the complex estimator over
+// the warps that passed the quality threshold, so each model runs many times
+// in a row while its weights are in cache. A partial batch is flushed once
+// its first warp has waited the maximal wait time.
+class EstimationBatcher
+{
+public:
+    struct Estimation {
+        // Estimation failed; the error is logged.
+        bool failed = false;
+
+        float quality = 0.f;
+
+        // Set when the quality passed the threshold and attributes were estimated.
+        bool hasAttributes = false;
+        fsdk::ComplexEstimation attributes;
+    };
+
+    struct Settings {
+        // Warps estimated in one sweep.
+        int batchSize = 32;
+
+        // Longest time in milliseconds the first warp of a partial batch waits for more.
+        int maxWaitMs = 20;
+
+        // Warps with a lower quality get no attribute estimation.
+        float minQuality = 0.f;
+
+        // Number of warps waiting for a batch; 0 means two batches.
+        // submit() blocks while the queue is full.
+        size_t queueCapacity = 0;
+    };
+
+    struct Stats {
+        int warps = 0;
+        int batches = 0;
+        int fullBatches = 0;
+        double qualityMs = 0.0;
+        double attributesMs = 0.0;
+    };
+
+    EstimationBatcher() = default;
+    EstimationBatcher(const EstimationBatcher&) = delete;
+    EstimationBatcher &operator=(const EstimationBatcher&) = delete;
+    ~EstimationBatcher();
+
+    // Start the batching thread. The estimators must not be used elsewhere
+    // until stop(). Returns false on failure.
+    bool start(
+            const fsdk::IQualityEstimatorPtr &qualityEstimator,
+            const fsdk::IComplexEstimatorPtr &complexEstimator,
+            const Settings &settings
+    );
+
+    // Estimate the queued warps and join the thread.
+    void stop();
+
+    // Queue a warp for estimation.
+    std::future<Estimation> submit(const fsdk::Image &warp);
+
+    Stats getStats() const;
+
+    // Print batch counts and estimation time per warp to the log.
+    void logStats() const;
+
+private:
+    struct Task {
+        fsdk::Image warp;
+        std::promise<Estimation> promise;
+    };
+
+    void run();
+
+    void estimate(std::vector<Task> &batch);
+
+    fsdk::IQualityEstimatorPtr m_qualityEstimator;
+    fsdk::IComplexEstimatorPtr m_complexEstimator;
+    Settings m_settings;
+    std::thread m_thread;
+    std::unique_ptr<BoundedQueue<Task>> m_queue;
+    mutable std::mutex m_statsMutex;
+    Stats m_stats;
+};
+
+#endif //FACEENGINE_ESTIMATION_BATCHER_H
@@ -0,0 +1,116 @@
+#include "extraction_worker_pool.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+
+#include "face_extraction.h"
+
+ExtractionWorkerPool::~ExtractionWorkerPool() {
+    stop();
+}
+
+bool ExtractionWorkerPool::start(const fsdk::IFaceEnginePtr &faceEngine, const Settings &settings) {
+    stop();
+
+    m_settings = settings;
+    int threadsCount = m_settings.threadsCount;
+    if (threadsCount <= 0)
+        threadsCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    size_t queueCapacity = m_settings.queueCapacity;
+    if (queueCapacity == 0)
+        queueCapacity = static_cast<size_t>(threadsCount) * 2;
+
+    // Objects are created sequentially on the calling thread.
+    m_workers.resize(threadsCount);
+    for (Worker &worker : m_workers) {
+        if (!createWorker(faceEngine, worker)) {
+            m_workers.clear();
+            return false;
+        }
+    }
+
+    m_queue.reset(new BoundedQueue<Task>(queueCapacity));
+    for (Worker &worker : m_workers)
+        m_threads.push_back(std::thread(&ExtractionWorkerPool::run, this, std::ref(worker)));
+
+    return true;
+}
+
+void ExtractionWorkerPool::stop() {
+    if (m_queue)
+        m_queue->close();
+    for (std::thread &thread : m_threads)
+        thread.join();
+    m_threads.clear();
+    m_workers.clear();
+    m_queue.reset();
+}
+
+std::future<fsdk::IDescriptorPtr> ExtractionWorkerPool::submit(const fsdk::Image &image) {
+    Task task;
+    task.image = image;
+    std::future<fsdk::IDescriptorPtr> future = task.promise.get_future();
+    if (!m_queue || !m_queue->push(std::move(task))) {
+        // The task was not queued; resolve it right away.
+        std::promise<fsdk::IDescriptorPtr> rejected;
+        future = rejected.get_future();
+        rejected.set_value(nullptr);
+    }
+    return future;
+}
+
+bool ExtractionWorkerPool::createWorker(const fsdk::IFaceEnginePtr &faceEngine, Worker &worker) {
+    fsdk::IDetectorFactoryPtr detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
+    if (!detectorFactory) {
+        vlf::log::error("Failed to create face detector factory instance.");
+        return false;
+    }
+
+    worker.detector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_MTCNN));
+    if (!worker.detector) {
+        vlf::log::error("Failed to create face detector instance.");
+        return false;
+    }
+
+    worker.featureFactory = fsdk::acquire(faceEngine->createFeatureFactory());
+    if (!worker.featureFactory) {
+        vlf::log::error("Failed to create face feature factory instance.");
+        return false;
+    }
+
+    worker.descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
+    if (!worker.descriptorFactory) {
+        vlf::log::error("Failed to create face descriptor factory instance.");
+        return false;
+    }
+
+    worker.extractor = fsdk::acquire(worker.descriptorFactory->createExtractor(fsdk::DT_CNN));
+    if (!worker.extractor) {
+        vlf::log::error("Failed to create face descriptor extractor instance.");
+        return false;
+    }
+
+    return true;
+}
+
+void ExtractionWorkerPool::run(Worker &worker) {
+    FaceExtractionSettings extractionSettings;
+    extractionSettings.confidenceThreshold = m_settings.confidenceThreshold;
+    extractionSettings.detectionMaxSide = m_settings.detectionMaxSide;
+
+    Task task;
+    while (m_queue->pop(task)) {
+        task.promise.set_value(extractBestFace(
+                worker.detector,
+                worker.featureFactory,
+                fsdk::IFeatureDetectorPtr(),
+                worker.descriptorFactory,
+                worker.extractor,
+                nullptr,
+                task.image,
+                extractionSettings
+        ));
+        task.image = fsdk::Image();
+    }
+}
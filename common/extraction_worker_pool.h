@@ -0,0 +1,78 @@
+#ifndef FACEENGINE_EXTRACTION_WORKER_POOL_H
+#define FACEENGINE_EXTRACTION_WORKER_POOL_H
+
+#include <FaceEngine.h>
+
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+
+// Pool of threads extracting CNN descriptors.
+// SDK processing objects are not thread safe, so every thread owns a full set
+// of the ones extraction needs (detector, factories, extractor), all created
+// from one shared face engine. Each submitted image yields a descriptor of the
+// face with the best detection score (see extractBestFace) or nullptr if no
+// good face was found.
+class ExtractionWorkerPool
+{
+public:
+    // SDK objects owned by one thread.
+    struct Worker {
+        fsdk::IDetectorPtr detector;
+        fsdk::IFeatureFactoryPtr featureFactory;
+        fsdk::IDescriptorFactoryPtr descriptorFactory;
+        fsdk::IDescriptorExtractorPtr extractor;
+    };
+
+    struct Settings {
+        // Number of worker threads; 0 means number of cores.
+        int threadsCount = 0;
+
+        // Number of images waiting for a worker; 0 means two per thread.
+        // submit() blocks while the queue is full.
+        size_t queueCapacity = 0;
+
+        // Minimal MTCNN detection score.
+        float confidenceThreshold = 0.25f;
+
+        // Larger side of the downscaled copy used for detection; 0 means full resolution.
+        int detectionMaxSide = 0;
+    };
+
+    ExtractionWorkerPool() = default;
+    ExtractionWorkerPool(const ExtractionWorkerPool&) = delete;
+    ExtractionWorkerPool &operator=(const ExtractionWorkerPool&) = delete;
+    ~ExtractionWorkerPool();
+
+    // Create per-thread objects and start the threads. Returns false on failure.
+    bool start(const fsdk::IFaceEnginePtr &faceEngine, const Settings &settings);
+
+    // Finish queued images and join the threads.
+    void stop();
+
+    // Queue an image (R8G8B8, as loaded from PPM) for extraction.
+    std::future<fsdk::IDescriptorPtr> submit(const fsdk::Image &image);
+
+    int getThreadsCount() const { return static_cast<int>(m_threads.size()); }
+
+    // Create an independent set of processing objects from the face engine.
+    static bool createWorker(const fsdk::IFaceEnginePtr &faceEngine, Worker &worker);
+
+private:
+    struct Task {
+        fsdk::Image image;
+        std::promise<fsdk::IDescriptorPtr> promise;
+    };
+
+    void run(Worker &worker);
+
+    Settings m_settings;
+    std::vector<Worker> m_workers;
+    std::vector<std::thread> m_threads;
+    std::unique_ptr<BoundedQueue<Task>> m_queue;
+};
+
+#endif //FACEENGINE_EXTRACTION_WORKER_POOL_H
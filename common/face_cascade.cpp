@@ -0,0 +1,147 @@
+#include "face_cascade.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "timer.h"
+
+namespace {
+
+typedef fsdk::IMTCNNDetector::Landmarks Landmarks;
+
+// Depth of the nose tip in front of the eyes relative to the eye distance,
+// for an average face. A yaw of a turns the nose offset along the eye line
+// into depth * tan(a) eye distances.
+const float NoseDepth = 0.6f;
+
+const float RadiansToDegrees = 57.29578f;
+
+const char *StageNames[FaceCascade::StagesCount] = {
+    "score",
+    "size",
+    "landmarks",
+    "quality",
+    "attributes",
+    "extraction"
+};
+
+}
+
+FaceCascade::FaceCascade(
+        const fsdk::IWarperPtr &warper,
+        const fsdk::IQualityEstimatorPtr &qualityEstimator,
+        const Settings &settings
+):
+    m_warper(warper),
+    m_qualityEstimator(qualityEstimator),
+    m_settings(settings)
+{}
+
+bool FaceCascade::checkDetection(const fsdk::Detection &detection) {
+    // Both checks cost less than reading the clock, so they are not timed.
+    const bool scorePassed = detection.score >= m_settings.minScore;
+    record(StageScore, scorePassed, 0.0);
+    if (!scorePassed)
+        return false;
+
+    const bool sizePassed =
+            std::min(detection.rect.width, detection.rect.height) >= m_settings.minFaceSize;
+    record(StageSize, sizePassed, 0.0);
+    return sizePassed;
+}
+
+bool FaceCascade::checkLandmarks(const Landmarks &landmarks) {
+    Timer timer;
+    bool passed = true;
+    if (m_settings.minEyeDistance > 0.f && getEyeDistance(landmarks) < m_settings.minEyeDistance)
+        passed = false;
+    else if (m_settings.maxYaw > 0.f && std::fabs(getRoughYaw(landmarks)) > m_settings.maxYaw)
+        passed = false;
+    record(StageLandmarks, passed, timer.elapsedMs());
+    return passed;
+}
+
+bool FaceCascade::checkQuality(
+        const fsdk::Image &image,
+        const fsdk::Detection &detection,
+        const fsdk::IFeatureSetPtr &featureSet,
+        fsdk::Image &warp,
+        float &quality,
+        bool &passed
+) {
+    Timer timer;
+    passed = false;
+    fsdk::Result<fsdk::FSDKError> warperResult = m_warper->warp(image, detection, featureSet, warp);
+    if (warperResult.isError()) {
+        vlf::log::error("Failed to create warped face. Reason: %s.", warperResult.what());
+        return false;
+    }
+
+    fsdk::Result<fsdk::FSDKError> qualityEstimatorResult = m_qualityEstimator->estimate(warp, &quality);
+    if (qualityEstimatorResult.isError()) {
+        vlf::log::error("Failed to get quality estimate. Reason: %s.", qualityEstimatorResult.what());
+        return false;
+    }
+    passed = quality >= m_settings.minQuality;
+    record(StageQuality, passed, timer.elapsedMs());
+    return true;
+}
+
+bool FaceCascade::runStage(Stage stage, const std::function<bool(bool &passed)> &run) {
+    Timer timer;
+    bool passed = false;
+    if (!run(passed))
+        return false;
+    record(stage, passed, timer.elapsedMs());
+    return true;
+}
+
+void FaceCascade::resetStats() {
+    for (StageStats &stats : m_stats)
+        stats = StageStats();
+}
+
+void FaceCascade::logStats() const {
+    for (int stage = 0; stage < StagesCount; ++stage) {
+        const StageStats &stats = m_stats[stage];
+        const int entered = stats.passed + stats.rejected;
+        if (entered == 0)
+            continue;
+        vlf::log::info("Stage %s: %d face(s), %d rejected, %.2f ms (%.3f ms per face).",
+                StageNames[stage], entered, stats.rejected, stats.ms, stats.ms / entered);
+    }
+}
+
+float FaceCascade::getEyeDistance(const Landmarks &landmarks) {
+    const fsdk::Point2f &left = landmarks.landmarks[Landmarks::LandmarkLeftEye];
+    const fsdk::Point2f &right = landmarks.landmarks[Landmarks::LandmarkRightEye];
+    return std::sqrt((right.x - left.x) * (right.x - left.x) + (right.y - left.y) * (right.y - left.y));
+}
+
+float FaceCascade::getRoughYaw(const Landmarks &landmarks) {
+    const fsdk::Point2f &left = landmarks.landmarks[Landmarks::LandmarkLeftEye];
+    const fsdk::Point2f &right = landmarks.landmarks[Landmarks::LandmarkRightEye];
+    const fsdk::Point2f &nose = landmarks.landmarks[Landmarks::LandmarkNose];
+    const float eyeDistance = getEyeDistance(landmarks);
+    if (eyeDistance <= 0.f)
+        return 0.f;
+
+    // Nose offset from the eye midpoint projected on the eye line, in eye distances.
+    const float eyeX = (right.x - left.x) / eyeDistance;
+    const float eyeY = (right.y - left.y) / eyeDistance;
+    const float offsetX = nose.x - (left.x + right.x) * 0.5f;
+    const float offsetY = nose.y - (left.y + right.y) * 0.5f;
+    const float offset = (offsetX * eyeX + offsetY * eyeY) / eyeDistance;
+    return std::atan(offset / NoseDepth) * RadiansToDegrees;
+}
+
+void FaceCascade::record(Stage stage, bool passed, double ms) {
+    StageStats &stats = m_stats[stage];
+    if (passed)
+        ++stats.passed;
+    else
+        ++stats.rejected;
+    stats.ms += ms;
+}
@@ -0,0 +1,107 @@
+#ifndef FACEENGINE_FACE_CASCADE_H
+#define FACEENGINE_FACE_CASCADE_H
+
+#include <FaceEngine.h>
+
+#include <functional>
+
+// Staged rejection of detected faces.
+// Stages run from the cheapest to the most expensive: detection score, face
+// size, landmark geometry, warp quality and finally attribute estimation or
+// extraction. A face rejected by a stage never reaches the next one, so
+// warping and the estimators only see faces that can still pass. Every stage
+// counts the faces it passed and rejected and the time it took.
+class FaceCascade
+{
+public:
+    enum Stage {
+        StageScore,
+        StageSize,
+        StageLandmarks,
+        StageQuality,
+        StageAttributes,
+        StageExtraction,
+        StagesCount
+    };
+
+    struct Settings {
+        // Faces with a lower detection score are rejected.
+        float minScore = 0.f;
+
+        // Faces with a smaller rect side are rejected; 0 accepts any.
+        int minFaceSize = 0;
+
+        // Faces with a smaller distance between the MTCNN eye points are rejected; 0 accepts any.
+        float minEyeDistance = 0.f;
+
+        // Faces with a larger rough yaw in degrees, estimated from the MTCNN
+        // points, are rejected; 0 accepts any.
+        float maxYaw = 0.f;
+
+        // Warps with a lower quality estimate are rejected; 0 skips the stage.
+        float minQuality = 0.f;
+    };
+
+    struct StageStats {
+        int passed = 0;
+        int rejected = 0;
+        double ms = 0.0;
+    };
+
+    // Warper and quality estimator are only used by checkQuality().
+    FaceCascade(
+            const fsdk::IWarperPtr &warper,
+            const fsdk::IQualityEstimatorPtr &qualityEstimator,
+            const Settings &settings
+    );
+
+    const Settings &getSettings() const { return m_settings; }
+
+    // Score and size stages.
+    bool checkDetection(const fsdk::Detection &detection);
+
+    // Landmark geometry stage on the MTCNN points of the detection.
+    bool checkLandmarks(const fsdk::IMTCNNDetector::Landmarks &landmarks);
+
+    // Quality stage: warp the face and estimate the warp quality. The warp is
+    // returned for the later stages. Returns false on failure; passed is set
+    // if the face may go on.
+    bool checkQuality(
+            const fsdk::Image &image,
+            const fsdk::Detection &detection,
+            const fsdk::IFeatureSetPtr &featureSet,
+            fsdk::Image &warp,
+            float &quality,
+            bool &passed
+    );
+
+    // Run a stage implemented by the caller, e.g. VGG feature detection as
+    // the landmarks stage, complex estimation as the attributes stage or the
+    // extraction itself, counting and timing it.
+    // run returns false on failure and sets passed if the face may go on.
+    bool runStage(Stage stage, const std::function<bool(bool &passed)> &run);
+
+    const StageStats &getStats(Stage stage) const { return m_stats[stage]; }
+
+    void resetStats();
+
+    // Print per-stage counts and times to the log.
+    void logStats() const;
+
+    // Distance between the eye points.
+    static float getEyeDistance(const fsdk::IMTCNNDetector::Landmarks &landmarks);
+
+    // Rough yaw in degrees from the nose offset along the eye line; positive
+    // when the nose is shifted towards the right eye point.
+    static float getRoughYaw(const fsdk::IMTCNNDetector::Landmarks &landmarks);
+
+private:
+    void record(Stage stage, bool passed, double ms);
+
+    fsdk::IWarperPtr m_warper;
+    fsdk::IQualityEstimatorPtr m_qualityEstimator;
+    Settings m_settings;
+    StageStats m_stats[StagesCount];
+};
+
+#endif //FACEENGINE_FACE_CASCADE_H
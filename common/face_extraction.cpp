@@ -0,0 +1,199 @@
+#include "face_extraction.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "detection_scaling.h"
+#include "face_cascade.h"
+#include "image_planes.h"
+
+namespace {
+
+// Run a stage counted by the cascade, or just run it without one.
+bool runStage(FaceCascade *cascade, FaceCascade::Stage stage, const std::function<bool(bool &passed)> &run) {
+    if (cascade)
+        return cascade->runStage(stage, run);
+    bool passed = false;
+    return run(passed);
+}
+
+}
+
+fsdk::IDescriptorPtr extractBestFace(
+        const fsdk::IDetectorPtr &detector,
+        const fsdk::IFeatureFactoryPtr &featureFactory,
+        const fsdk::IFeatureDetectorPtr &featureDetector,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const fsdk::IDescriptorExtractorPtr &descriptorExtractor,
+        FaceCascade *cascade,
+        const fsdk::Image &image,
+        const FaceExtractionSettings &settings
+) {
+    if (!image) {
+        vlf::log::error("Request image is invalid.");
+        return nullptr;
+    }
+
+    // MTCNN detects the landmarks together with the faces.
+    const bool mtcnn = !featureDetector;
+
+    // DPM and VGG work on a grayscale image, MTCNN on the loaded one.
+    // The color image is only needed for extraction, so it is made once a face
+    // passes the confidence threshold; images without faces never pay for it.
+    ImagePlanes planes(image);
+    const fsdk::Image &detectionImage = mtcnn ? planes.getSource() : planes.getR();
+    if (!detectionImage)
+        return nullptr;
+
+    if (settings.verbose)
+        vlf::log::info("Detecting faces.");
+
+    // Detect no more than 10 faces in the image.
+    enum { MaxDetections = 10 };
+    fsdk::Detection detections[MaxDetections];
+    fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
+
+    // Detect faces in the image.
+    // With a max side set, detection runs on a downscaled copy and the rects
+    // are mapped back, so feature detection and extraction see full resolution.
+    const int detectionsCount = detectFaces(
+            detector,
+            detectionImage,
+            settings.detectionMaxSide,
+            &detections[0],
+            mtcnn ? &landmarks[0] : nullptr,
+            MaxDetections
+    );
+    if (detectionsCount < 0)
+        return nullptr;
+    if (settings.verbose)
+        vlf::log::info("Found %d face(s).", detectionsCount);
+
+    // Rank the faces by their detections.
+    const std::vector<int> candidates =
+            rankDetections(&detections[0], detectionsCount, settings.rankingPolicy, detectionImage.getRect());
+    const int candidatesCount = settings.maxCandidates > 0 ?
+            std::min(settings.maxCandidates, detectionsCount) : detectionsCount;
+
+    fsdk::IFeatureSetPtr bestFeatureSet(nullptr);
+    int bestDetectionIndex = -1;
+
+    // Loop through the candidates and find one with the best confidence.
+    for (int candidateIndex = 0; candidateIndex < candidatesCount; ++candidateIndex) {
+        const int detectionIndex = candidates[candidateIndex];
+        fsdk::Detection &detection = detections[detectionIndex];
+
+        // Skip faces the cascade rejects before their feature set is made.
+        if (cascade && !cascade->checkDetection(detection))
+            continue;
+        if (settings.verbose)
+            vlf::log::info("Detecting facial features (%d/%d).", (candidateIndex + 1), candidatesCount);
+
+        // Detect feature set, or make it from the MTCNN landmarks.
+        // Every candidate gets its own feature set, so the best one is kept.
+        fsdk::IFeatureSetPtr featureSet(nullptr);
+        bool featureSetPassed = false;
+        const bool featureSetMade = runStage(cascade, FaceCascade::StageLandmarks, [&](bool &passed) {
+            featureSet = mtcnn ?
+                    fsdk::acquire(featureFactory->createFeatureSet(landmarks[detectionIndex], detection.score)) :
+                    fsdk::acquire(featureFactory->createFeatureSet());
+            if (!featureSet) {
+                vlf::log::error("Failed to create face feature set instance.");
+                return false;
+            }
+            if (!mtcnn) {
+                fsdk::Result<fsdk::FSDKError> featureSetResult =
+                        featureDetector->detect(detectionImage, detection, featureSet);
+                if (featureSetResult.isError()) {
+                    vlf::log::error("Failed to detect feature set. Reason: %s.", featureSetResult.what());
+                    return false;
+                }
+            }
+            passed = featureSetPassed = featureSet->getConfidence() >= settings.confidenceThreshold;
+            return true;
+        });
+        if (!featureSetMade)
+            return nullptr;
+        if (!featureSetPassed)
+            continue;
+
+        // Choose the best feature set; a ranked search stops at the first one.
+        if (!bestFeatureSet || featureSet->getConfidence() > bestFeatureSet->getConfidence()) {
+            bestFeatureSet = featureSet;
+            bestDetectionIndex = detectionIndex;
+            if (settings.rankingPolicy != RankingNone)
+                break;
+        }
+    }
+
+    if (bestDetectionIndex < 0) {
+        if (settings.verbose)
+            vlf::log::info("Face detection succeeded, but no faces with good confidence found.");
+        return nullptr;
+    }
+    const fsdk::Detection &bestDetection = detections[bestDetectionIndex];
+    if (settings.verbose)
+        vlf::log::info("Best face confidence is %0.3f.", bestFeatureSet->getConfidence());
+
+    // Check the warp quality of the best face. The quality estimator takes a
+    // warp of the loaded R8G8B8 image; extraction then reuses the warp
+    // converted to B8G8R8, which costs far less than a second warp.
+    fsdk::Image warpBGR;
+    if (cascade && cascade->getSettings().minQuality > 0.f) {
+        fsdk::Image warp;
+        float quality;
+        bool qualityPassed;
+        if (!cascade->checkQuality(planes.getSource(), bestDetection, bestFeatureSet, warp, quality, qualityPassed))
+            return nullptr;
+        if (settings.verbose)
+            vlf::log::info("Best face quality is %0.3f.", quality);
+        if (!qualityPassed) {
+            if (settings.verbose)
+                vlf::log::info("Face quality is too low for extraction.");
+            return nullptr;
+        }
+        warp.convert(warpBGR, fsdk::Format::B8G8R8);
+        if (!warpBGR) {
+            vlf::log::error("Conversion to BGR has failed.");
+            return nullptr;
+        }
+    }
+
+    // Create color image. It is only needed to extract from the full image.
+    fsdk::Image imageBGR;
+    if (!warpBGR) {
+        imageBGR = planes.getBGR();
+        if (!imageBGR)
+            return nullptr;
+    }
+
+    fsdk::IDescriptorPtr descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+    if (!descriptor) {
+        vlf::log::error("Failed to create face descrtiptor instance.");
+        return nullptr;
+    }
+
+    if (settings.verbose)
+        vlf::log::info("Extracting descriptor.");
+
+    // Extract face descriptor.
+    // This is typically the most time consuming task.
+    const bool extracted = runStage(cascade, FaceCascade::StageExtraction, [&](bool &passed) {
+        fsdk::Result<fsdk::FSDKError> descriptorExtractorResult = warpBGR ?
+                descriptorExtractor->extractFromWarpedImage(warpBGR, descriptor) :
+                descriptorExtractor->extract(imageBGR, bestDetection, bestFeatureSet, descriptor);
+        if (descriptorExtractorResult.isError()) {
+            vlf::log::error("Failed to extract face descriptor. Reason: %s.", descriptorExtractorResult.what());
+            return false;
+        }
+        passed = true;
+        return true;
+    });
+    if (!extracted)
+        return nullptr;
+
+    return descriptor;
+}
@@ -0,0 +1,54 @@
+#ifndef FACEENGINE_FACE_EXTRACTION_H
+#define FACEENGINE_FACE_EXTRACTION_H
+
+#include <FaceEngine.h>
+
+#include "candidate_ranking.h"
+
+class FaceCascade;
+
+// Settings of extractBestFace().
+struct FaceExtractionSettings {
+    // Minimal feature set confidence; with MTCNN this is the detection score.
+    float confidenceThreshold = 0.25f;
+
+    // Larger side of the downscaled copy used for detection; 0 means full resolution.
+    int detectionMaxSide = 0;
+
+    // Order of the candidate faces. Without a ranking every candidate is
+    // tried and the most confident one is taken; with one the first
+    // confident candidate is taken.
+    RankingPolicy rankingPolicy = RankingNone;
+
+    // Number of candidate faces tried; 0 tries all.
+    int maxCandidates = 0;
+
+    // Log the progress of every image.
+    bool verbose = false;
+};
+
+// Extract a CNN descriptor of the best face of an image (R8G8B8, as loaded
+// from PPM). Without a feature detector faces are detected with MTCNN on the
+// image and feature sets are made from its landmarks; with one faces are
+// detected (DPM) and their feature sets detected (VGG) on the grayscale
+// image. Extraction runs on the B8G8R8 image, converted only once a face
+// passed the threshold.
+// With a cascade, faces go through its detection stage before their feature
+// set is made, feature sets and extraction are counted as its stages, and
+// with a quality threshold the best face is warped from the R8G8B8 image and
+// checked; the descriptor is then extracted from that warp. The cascade may
+// be nullptr.
+// Returns nullptr on failure or if no face is confident enough. The SDK
+// objects and the cascade are not thread safe; every thread needs its own.
+fsdk::IDescriptorPtr extractBestFace(
+        const fsdk::IDetectorPtr &detector,
+        const fsdk::IFeatureFactoryPtr &featureFactory,
+        const fsdk::IFeatureDetectorPtr &featureDetector,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const fsdk::IDescriptorExtractorPtr &descriptorExtractor,
+        FaceCascade *cascade,
+        const fsdk::Image &image,
+        const FaceExtractionSettings &settings
+);
+
+#endif //FACEENGINE_FACE_EXTRACTION_H
@@ -0,0 +1,186 @@
+#include "face_tracker.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "detection_scaling.h"
+#include "timer.h"
+
+namespace {
+
+// Faces found in one ROI; more than one only if faces are close together.
+enum { MaxRoiDetections = 4 };
+
+// Re-detected faces overlapping this much are one face.
+const float DuplicateIoU = 0.5f;
+
+float intersectionOverUnion(const fsdk::Rect &a, const fsdk::Rect &b) {
+    const int intersection = (a & b).getArea();
+    const int area = a.getArea() + b.getArea() - intersection;
+    return area > 0 ? static_cast<float>(intersection) / area : 0.f;
+}
+
+fsdk::Rect expandRect(const fsdk::Rect &rect, float scale, const fsdk::Rect &bounds) {
+    const float width = rect.width * scale;
+    const float height = rect.height * scale;
+    const float left = rect.x + rect.width * 0.5f - width * 0.5f;
+    const float top = rect.y + rect.height * 0.5f - height * 0.5f;
+    return fsdk::Rect(
+            static_cast<int>(std::floor(left)),
+            static_cast<int>(std::floor(top)),
+            static_cast<int>(std::ceil(width)),
+            static_cast<int>(std::ceil(height))
+    ) & bounds;
+}
+
+}
+
+FaceTracker::FaceTracker(const fsdk::IDetectorPtr &detector, const Settings &settings):
+    m_detector(detector),
+    m_settings(settings)
+{}
+
+int FaceTracker::track(
+        const fsdk::Image &frame,
+        fsdk::Detection *detections,
+        fsdk::IMTCNNDetector::Landmarks *landmarks,
+        int maxCount
+) {
+    if (!frame) {
+        vlf::log::error("Request image is invalid.");
+        return -1;
+    }
+
+    Timer timer;
+    bool full = !m_hasTracks || m_framesSinceFull + 1 >= m_settings.detectionInterval;
+    if (!full) {
+        bool lost = false;
+        if (!detectTracks(frame, lost))
+            return -1;
+        ++m_stats.roiDetections;
+        if (lost) {
+            ++m_stats.lostTracks;
+            full = true;
+        }
+    }
+    if (full) {
+        if (!detectFull(frame))
+            return -1;
+        ++m_stats.fullDetections;
+        m_framesSinceFull = 0;
+    } else {
+        ++m_framesSinceFull;
+    }
+    m_hasTracks = true;
+    ++m_stats.frames;
+    m_stats.detectionMs += timer.elapsedMs();
+
+    const int count = std::min(static_cast<int>(m_faces.size()), maxCount);
+    for (int i = 0; i < count; ++i) {
+        detections[i] = m_faces[i].detection;
+        if (landmarks)
+            landmarks[i] = m_faces[i].landmarks;
+    }
+    return count;
+}
+
+void FaceTracker::reset() {
+    m_faces.clear();
+    m_framesSinceFull = 0;
+    m_hasTracks = false;
+}
+
+void FaceTracker::logStats() const {
+    vlf::log::info("Frames: %d, full detections: %d, ROI passes: %d, lost tracks: %d.",
+            m_stats.frames, m_stats.fullDetections, m_stats.roiDetections, m_stats.lostTracks);
+    vlf::log::info("Detection time: %.2f ms per frame.",
+            m_stats.frames > 0 ? m_stats.detectionMs / m_stats.frames : 0.0);
+}
+
+bool FaceTracker::detectFull(const fsdk::Image &frame) {
+    std::vector<fsdk::Detection> detections(m_settings.maxFaces);
+    std::vector<fsdk::IMTCNNDetector::Landmarks> landmarks(m_settings.maxFaces);
+    const int detectionsCount = detectFaces(
+            m_detector,
+            frame,
+            m_settings.detectionMaxSide,
+            &detections[0],
+            &landmarks[0],
+            m_settings.maxFaces
+    );
+    if (detectionsCount < 0)
+        return false;
+
+    m_faces.resize(detectionsCount);
+    for (int i = 0; i < detectionsCount; ++i) {
+        m_faces[i].detection = detections[i];
+        m_faces[i].landmarks = landmarks[i];
+    }
+    return true;
+}
+
+bool FaceTracker::detectTracks(const fsdk::Image &frame, bool &lost) {
+    fsdk::Detection detections[MaxRoiDetections];
+    fsdk::IMTCNNDetector::Landmarks landmarks[MaxRoiDetections];
+
+    std::vector<Face> faces;
+    for (const Face &face : m_faces) {
+        const fsdk::Rect roi = expandRect(face.detection.rect, m_settings.roiScale, frame.getRect());
+        if (roi.width <= 0 || roi.height <= 0) {
+            lost = true;
+            continue;
+        }
+        fsdk::ResultValue<fsdk::FSDKError, int> detectorResult =
+                m_detector.as<fsdk::IMTCNNDetector>()->detect(
+                        frame,
+                        roi,
+                        &detections[0],
+                        &landmarks[0],
+                        MaxRoiDetections
+                );
+        if (detectorResult.isError()) {
+            vlf::log::error("Failed to detect faces. Reason: %s.", detectorResult.what());
+            return false;
+        }
+
+        // The face is the ROI detection closest to its previous rect.
+        int best = -1;
+        float bestIoU = 0.f;
+        for (int i = 0; i < detectorResult.getValue(); ++i) {
+            const float iou = intersectionOverUnion(face.detection.rect, detections[i].rect);
+            if (iou > bestIoU) {
+                best = i;
+                bestIoU = iou;
+            }
+        }
+        if (best < 0) {
+            lost = true;
+            continue;
+        }
+
+        Face found;
+        found.detection = detections[best];
+        found.landmarks = landmarks[best];
+        faces.push_back(found);
+    }
+
+    // Two tracks may have converged on one face; keep the better one.
+    std::stable_sort(faces.begin(), faces.end(), [](const Face &a, const Face &b) {
+        return a.detection.score > b.detection.score;
+    });
+    m_faces.clear();
+    for (const Face &face : faces) {
+        bool duplicate = false;
+        for (const Face &other : m_faces) {
+            if (intersectionOverUnion(face.detection.rect, other.detection.rect) > DuplicateIoU) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate)
+            m_faces.push_back(face);
+    }
+    return true;
+}
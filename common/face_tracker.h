@@ -0,0 +1,79 @@
+#ifndef FACEENGINE_FACE_TRACKER_H
+#define FACEENGINE_FACE_TRACKER_H
+
+#include <FaceEngine.h>
+
+#include <vector>
+
+// MTCNN detection over a frame sequence.
+// A full frame detection runs every detectionInterval frames. In between,
+// every face of the previous frame is searched for only inside an expanded
+// ROI around its rect, passed as the detect() rect, which is far cheaper
+// while faces are few and move little. When a face is not found in its ROI
+// the track is lost and the frame is detected in full right away, so new
+// and fast moving faces wait at most one interval.
+class FaceTracker
+{
+public:
+    struct Settings {
+        // Frames between full detections; 1 detects every frame in full.
+        int detectionInterval = 10;
+
+        // Side of a search ROI relative to the face rect, centered on the face.
+        float roiScale = 2.f;
+
+        // Larger side of the downscaled copy used for full detection; 0 means full resolution.
+        int detectionMaxSide = 0;
+
+        // Faces tracked at most.
+        int maxFaces = 32;
+    };
+
+    struct Stats {
+        int frames = 0;
+        int fullDetections = 0;
+        int roiDetections = 0;
+        int lostTracks = 0;
+        double detectionMs = 0.0;
+    };
+
+    FaceTracker(const fsdk::IDetectorPtr &detector, const Settings &settings);
+
+    // Detect faces of the next frame. Landmarks are relative to their rect as
+    // with IMTCNNDetector. Returns the number of faces, or -1 on failure.
+    int track(
+            const fsdk::Image &frame,
+            fsdk::Detection *detections,
+            fsdk::IMTCNNDetector::Landmarks *landmarks,
+            int maxCount
+    );
+
+    // Drop all tracks; the next frame is detected in full.
+    void reset();
+
+    const Stats &getStats() const { return m_stats; }
+
+    // Print detection counts and mean detection time per frame to the log.
+    void logStats() const;
+
+private:
+    struct Face {
+        fsdk::Detection detection;
+        fsdk::IMTCNNDetector::Landmarks landmarks;
+    };
+
+    bool detectFull(const fsdk::Image &frame);
+
+    // Re-detect every face in its ROI. Returns false on failure; lost is set
+    // if some face was not found.
+    bool detectTracks(const fsdk::Image &frame, bool &lost);
+
+    fsdk::IDetectorPtr m_detector;
+    Settings m_settings;
+    std::vector<Face> m_faces;
+    int m_framesSinceFull = 0;
+    bool m_hasTracks = false;
+    Stats m_stats;
+};
+
+#endif //FACEENGINE_FACE_TRACKER_H
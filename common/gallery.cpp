@@ -0,0 +1,347 @@
+#include "gallery.h"
+#include "io_util.h"
+#include "mapped_archive.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+const char GalleryMagic[4] = { 'F', 'S', 'G', 'L' };
+const uint32_t GalleryVersion = 1;
+
+bool fileExists(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return !!file;
+}
+
+// Replace a file with another one in a single step, so a crash leaves either
+// the old or the new file in place.
+bool replaceFile(const std::string &from, const std::string &to) {
+#ifdef _WIN32
+    // rename() does not replace existing files on Windows.
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+}
+
+bool GalleryFile::create(const std::string &path, uint32_t capacity) {
+    close();
+
+    m_file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        vlf::log::error("Failed to create gallery: %s.", path.c_str());
+        return false;
+    }
+    m_path = path;
+
+    // Descriptor size is unknown until the first append.
+    layout(0, capacity ? capacity : 1);
+    m_header.count = 0;
+    m_header.namesSize = 0;
+
+    return writeHeader();
+}
+
+bool GalleryFile::open(const std::string &path) {
+    close();
+
+    m_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file) {
+        vlf::log::error("Failed to open gallery: %s.", path.c_str());
+        return false;
+    }
+    m_path = path;
+
+    m_file.seekg(0, std::ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(m_file.tellg());
+    m_file.seekg(0, std::ios::beg);
+    if (!m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) ||
+        !isValidHeader(m_header, fileSize)) {
+        vlf::log::error("Invalid gallery file: %s.", path.c_str());
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool GalleryFile::openOrCreate(const std::string &path, uint32_t capacity) {
+    if (fileExists(path))
+        return open(path);
+    return create(path, capacity);
+}
+
+bool GalleryFile::append(const fsdk::IDescriptor *descriptor, uint64_t id, const std::string &name) {
+    if (!m_file.is_open())
+        return false;
+
+    std::vector<uint8_t> data;
+    VectorArchive vectorArchive(data);
+    if (!descriptor->save(&vectorArchive)) {
+        vlf::log::error("Failed to save face descriptor to vector.");
+        return false;
+    }
+
+    if (m_header.stride == 0) {
+        // First descriptor fixes the slot size; the gallery is still empty,
+        // so sections just move.
+        layout(static_cast<uint32_t>(data.size()), m_header.capacity);
+    } else if (data.size() != m_header.stride) {
+        vlf::log::error("Descriptor size %d does not match gallery stride %d.",
+                static_cast<int>(data.size()), static_cast<int>(m_header.stride));
+        return false;
+    }
+
+    if (m_header.count == m_header.capacity && !grow())
+        return false;
+
+    const uint32_t index = m_header.count;
+
+    GalleryIndexEntry entry;
+    entry.id = id;
+    entry.nameOffset = m_header.namesSize;
+    entry.nameLength = static_cast<uint32_t>(name.size());
+    entry.reserved = 0;
+
+    m_file.seekp(static_cast<std::streamoff>(m_header.descriptorsOffset + uint64_t(index) * m_header.stride));
+    m_file.write(reinterpret_cast<const char*>(&data[0]), data.size());
+    m_file.seekp(static_cast<std::streamoff>(m_header.indexOffset + uint64_t(index) * sizeof(GalleryIndexEntry)));
+    m_file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    m_file.seekp(static_cast<std::streamoff>(m_header.namesOffset + m_header.namesSize));
+    m_file.write(name.data(), name.size());
+    if (!m_file) {
+        vlf::log::error("Failed to write gallery: %s.", m_path.c_str());
+        return false;
+    }
+
+    // Commit.
+    m_header.count += 1;
+    m_header.namesSize += name.size();
+    return writeHeader();
+}
+
+void GalleryFile::close() {
+    if (m_file.is_open())
+        m_file.close();
+    m_file.clear();
+    m_path.clear();
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+bool GalleryFile::read(
+        const std::string &path,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const Visitor &visitor
+) {
+    MappedFile file;
+    GalleryHeader header;
+    if (!map(path, file, header))
+        return false;
+    return visit(path, file, header, descriptorFactory, visitor);
+}
+
+int GalleryFile::count(const std::string &path) {
+    MappedFile file;
+    GalleryHeader header;
+    if (!map(path, file, header))
+        return -1;
+    return static_cast<int>(header.count);
+}
+
+bool GalleryFile::load(
+        const std::string &path,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        fsdk::IDescriptorBatchPtr &descriptorBatch,
+        std::vector<Entry> &entries
+) {
+    // The header sizes the batch, then the same mapping fills it.
+    MappedFile file;
+    GalleryHeader header;
+    if (!map(path, file, header))
+        return false;
+
+    descriptorBatch = fsdk::acquire(descriptorFactory->createDescriptorBatch(
+            fsdk::DT_CNN,
+            std::max(1, static_cast<int>(header.count))
+    ));
+    if (!descriptorBatch) {
+        vlf::log::error("Failed to create face descriptor batch instance.");
+        return false;
+    }
+
+    // The batch copies descriptor data, so one descriptor object is reused.
+    entries.clear();
+    entries.reserve(header.count);
+    const Visitor addToBatch = [&](const fsdk::IDescriptorPtr &descriptor, const Entry &entry) {
+        fsdk::Result<fsdk::DescriptorBatchError> descriptorBatchAddResult = descriptorBatch->add(descriptor);
+        if (descriptorBatchAddResult.isError()) {
+            vlf::log::error("Failed to add descriptor to descriptor batch.");
+            return false;
+        }
+        entries.push_back(entry);
+        return true;
+    };
+    return visit(path, file, header, descriptorFactory, addToBatch);
+}
+
+bool GalleryFile::map(const std::string &path, MappedFile &file, GalleryHeader &header) {
+    if (!file.open(path, MappedFile::AccessSequential))
+        return false;
+    if (file.size() < sizeof(header)) {
+        vlf::log::error("Invalid gallery file: %s.", path.c_str());
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (!isValidHeader(header, file.size())) {
+        vlf::log::error("Invalid gallery file: %s.", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool GalleryFile::visit(
+        const std::string &path,
+        const MappedFile &file,
+        const GalleryHeader &header,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const Visitor &visitor
+) {
+    fsdk::IDescriptorPtr descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+    if (!descriptor) {
+        vlf::log::error("Failed to create face descriptor instance.");
+        return false;
+    }
+
+    const uint8_t *descriptors = file.data() + header.descriptorsOffset;
+    const uint8_t *index = file.data() + header.indexOffset;
+    const char *names = reinterpret_cast<const char*>(file.data() + header.namesOffset);
+
+    Entry entry;
+    for (uint32_t i = 0; i < header.count; ++i) {
+        MappedArchive archive(descriptors + uint64_t(i) * header.stride, header.stride);
+        if (!descriptor->load(&archive)) {
+            vlf::log::error("Failed to load face descriptor %d from gallery.", static_cast<int>(i));
+            return false;
+        }
+
+        GalleryIndexEntry indexEntry;
+        memcpy(&indexEntry, index + uint64_t(i) * sizeof(GalleryIndexEntry), sizeof(indexEntry));
+        if (indexEntry.nameOffset + indexEntry.nameLength > header.namesSize) {
+            vlf::log::error("Invalid gallery name table: %s.", path.c_str());
+            return false;
+        }
+        entry.id = indexEntry.id;
+        entry.name.assign(names + indexEntry.nameOffset, indexEntry.nameLength);
+
+        if (!visitor(descriptor, entry))
+            return false;
+    }
+
+    return true;
+}
+
+bool GalleryFile::isValidHeader(const GalleryHeader &header, uint64_t fileSize) {
+    return memcmp(header.magic, GalleryMagic, sizeof(GalleryMagic)) == 0 &&
+            header.version == GalleryVersion &&
+            header.count <= header.capacity &&
+            (header.count == 0 || header.stride != 0) &&
+            header.descriptorsOffset + uint64_t(header.count) * header.stride <= fileSize &&
+            // Sections are only written up to their live part, so an empty
+            // gallery is just the header.
+            (header.count == 0 ||
+                    header.indexOffset + uint64_t(header.count) * sizeof(GalleryIndexEntry) <= fileSize) &&
+            (header.namesSize == 0 || header.namesOffset + header.namesSize <= fileSize);
+}
+
+void GalleryFile::layout(uint32_t stride, uint32_t capacity) {
+    memcpy(m_header.magic, GalleryMagic, sizeof(GalleryMagic));
+    m_header.version = GalleryVersion;
+    m_header.stride = stride;
+    m_header.capacity = capacity;
+    m_header.reserved = 0;
+    m_header.descriptorsOffset = sizeof(GalleryHeader);
+    m_header.indexOffset = m_header.descriptorsOffset + uint64_t(capacity) * stride;
+    m_header.namesOffset = m_header.indexOffset + uint64_t(capacity) * sizeof(GalleryIndexEntry);
+}
+
+bool GalleryFile::writeHeader() {
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    m_file.flush();
+    if (!m_file) {
+        vlf::log::error("Failed to write gallery: %s.", m_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool GalleryFile::grow() {
+    const GalleryHeader oldHeader = m_header;
+
+    // Read the live part of every section.
+    std::vector<char> descriptors(size_t(oldHeader.count) * oldHeader.stride);
+    std::vector<char> index(size_t(oldHeader.count) * sizeof(GalleryIndexEntry));
+    std::vector<char> names(static_cast<size_t>(oldHeader.namesSize));
+    m_file.seekg(static_cast<std::streamoff>(oldHeader.descriptorsOffset));
+    m_file.read(descriptors.data(), descriptors.size());
+    m_file.seekg(static_cast<std::streamoff>(oldHeader.indexOffset));
+    m_file.read(index.data(), index.size());
+    m_file.seekg(static_cast<std::streamoff>(oldHeader.namesOffset));
+    m_file.read(names.data(), names.size());
+    if (!m_file) {
+        vlf::log::error("Failed to read gallery: %s.", m_path.c_str());
+        return false;
+    }
+
+    // Write a gallery with twice the capacity next to the old one and swap them.
+    // Name offsets are relative to the names section and stay valid.
+    const std::string path = m_path;
+    const std::string tmpPath = path + ".tmp";
+    layout(oldHeader.stride, oldHeader.capacity * 2);
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+        out.seekp(static_cast<std::streamoff>(m_header.descriptorsOffset));
+        out.write(descriptors.data(), descriptors.size());
+        out.seekp(static_cast<std::streamoff>(m_header.indexOffset));
+        out.write(index.data(), index.size());
+        out.seekp(static_cast<std::streamoff>(m_header.namesOffset));
+        out.write(names.data(), names.size());
+        if (!out) {
+            vlf::log::error("Failed to write gallery: %s.", tmpPath.c_str());
+            m_header = oldHeader;
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    // Windows does not replace a file that is open.
+    m_file.close();
+    if (!replaceFile(tmpPath, path)) {
+        vlf::log::error("Failed to replace gallery: %s.", path.c_str());
+        std::remove(tmpPath.c_str());
+
+        // Go on with the old file, so later appends still see a consistent gallery.
+        m_header = oldHeader;
+        m_file.clear();
+        m_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!m_file)
+            close();
+        return false;
+    }
+
+    return open(path);
+}
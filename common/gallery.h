@@ -0,0 +1,124 @@
+#ifndef FACEENGINE_GALLERY_H
+#define FACEENGINE_GALLERY_H
+
+#include <FaceEngine.h>
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+// Single file descriptor gallery.
+//
+// File layout:
+//   header       - GalleryHeader, fixed size;
+//   descriptors  - capacity slots of `stride` bytes, each holding a descriptor
+//                  serialized with IDescriptor::save();
+//   index        - capacity GalleryIndexEntry records (id, name offset and length);
+//   names        - name bytes, appended at the end of the file.
+//
+// Descriptor and index sections are preallocated, so an append writes one slot,
+// one index entry and the name, then bumps the count in the header. The count is
+// written last and acts as the commit point. When the gallery is full it is
+// rewritten with twice the capacity, which keeps appends amortized O(1).
+class GalleryFile
+{
+public:
+    struct Entry {
+        uint64_t id;
+        std::string name;
+    };
+
+    GalleryFile() = default;
+    GalleryFile(const GalleryFile&) = delete;
+    GalleryFile &operator=(const GalleryFile&) = delete;
+
+    // Create a new empty gallery, overwriting an existing file.
+    bool create(const std::string &path, uint32_t capacity = 1024);
+
+    // Open an existing gallery for appending.
+    bool open(const std::string &path);
+
+    // Open a gallery if it exists, create it otherwise.
+    bool openOrCreate(const std::string &path, uint32_t capacity = 1024);
+
+    // Append a descriptor. All descriptors must serialize to the same size.
+    bool append(const fsdk::IDescriptor *descriptor, uint64_t id, const std::string &name);
+
+    void close();
+
+    uint32_t getCount() const { return m_header.count; }
+    uint32_t getCapacity() const { return m_header.capacity; }
+
+    // Called for every gallery descriptor in order; return false to stop.
+    // The descriptor object is reused between calls.
+    typedef std::function<bool(const fsdk::IDescriptorPtr &descriptor, const Entry &entry)> Visitor;
+
+    // Map a gallery and pass its descriptors to the visitor.
+    // Returns false on error or if the visitor stopped.
+    static bool read(
+            const std::string &path,
+            const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+            const Visitor &visitor
+    );
+
+    // Number of descriptors in a gallery file; -1 on failure.
+    static int count(const std::string &path);
+
+    // Map a gallery once and load all of its descriptors into a new batch.
+    // Entries receive ids and names in gallery order.
+    static bool load(
+            const std::string &path,
+            const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+            fsdk::IDescriptorBatchPtr &descriptorBatch,
+            std::vector<Entry> &entries
+    );
+
+private:
+    struct GalleryHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t stride;
+        uint32_t count;
+        uint32_t capacity;
+        uint32_t reserved;
+        uint64_t descriptorsOffset;
+        uint64_t indexOffset;
+        uint64_t namesOffset;
+        uint64_t namesSize;
+    };
+
+    struct GalleryIndexEntry {
+        uint64_t id;
+        uint64_t nameOffset;
+        uint32_t nameLength;
+        uint32_t reserved;
+    };
+
+    static bool isValidHeader(const GalleryHeader &header, uint64_t fileSize);
+
+    // Map a gallery file and read its header; false if the file is not a valid gallery.
+    static bool map(const std::string &path, MappedFile &file, GalleryHeader &header);
+
+    // Pass the descriptors of a mapped gallery to the visitor.
+    static bool visit(
+            const std::string &path,
+            const MappedFile &file,
+            const GalleryHeader &header,
+            const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+            const Visitor &visitor
+    );
+
+    void layout(uint32_t stride, uint32_t capacity);
+    bool writeHeader();
+    bool grow();
+
+    std::string m_path;
+    std::fstream m_file;
+    GalleryHeader m_header = GalleryHeader();
+};
+
+#endif //FACEENGINE_GALLERY_H
@@ -0,0 +1,71 @@
+#include "image_planes.h"
+
+#include <vlf/Log.h>
+
+#include "simd.h"
+
+ImagePlanes::ImagePlanes(const fsdk::Image &image):
+    m_source(image)
+{}
+
+bool ImagePlanes::request(int planes) {
+    planes &= ~m_converted;
+    if (!planes)
+        return true;
+    if (!m_source) {
+        vlf::log::error("Source image is invalid.");
+        return false;
+    }
+
+    const bool needBGR = (planes & BGR) != 0;
+    const bool needR = (planes & Gray) != 0;
+
+    if (m_source.getFormat() != fsdk::Format::R8G8B8) {
+        if (needBGR)
+            m_source.convert(m_imageBGR, fsdk::Format::B8G8R8);
+        if (needR)
+            m_source.convert(m_imageR, fsdk::Format::R8);
+    } else {
+        const int width = m_source.getWidth();
+        const int height = m_source.getHeight();
+        if (needBGR)
+            m_imageBGR = fsdk::Image(width, height, fsdk::Format::B8G8R8);
+        if (needR)
+            m_imageR = fsdk::Image(width, height, fsdk::Format::R8);
+        if ((needBGR && !m_imageBGR) || (needR && !m_imageR)) {
+            vlf::log::error("Failed to create image %dx%d.", width, height);
+            return false;
+        }
+
+        const RgbRowFunc rgbRow = getRgbRowFunc(detectSimdLevel());
+        for (int y = 0; y < height; ++y) {
+            rgbRow(
+                    m_source.getScanLineAs<uint8_t>(y),
+                    needBGR ? m_imageBGR.getScanLineAs<uint8_t>(y) : nullptr,
+                    needR ? m_imageR.getScanLineAs<uint8_t>(y) : nullptr,
+                    static_cast<size_t>(width)
+            );
+        }
+    }
+
+    if (needBGR && !m_imageBGR) {
+        vlf::log::error("Conversion to BGR has failed.");
+        return false;
+    }
+    if (needR && !m_imageR) {
+        vlf::log::error("Conversion to grayscale has failed.");
+        return false;
+    }
+    m_converted |= planes;
+    return true;
+}
+
+const fsdk::Image &ImagePlanes::getBGR() {
+    request(BGR);
+    return m_imageBGR;
+}
+
+const fsdk::Image &ImagePlanes::getR() {
+    request(Gray);
+    return m_imageR;
+}
@@ -0,0 +1,40 @@
+#ifndef FACEENGINE_IMAGE_PLANES_H
+#define FACEENGINE_IMAGE_PLANES_H
+
+#include <FaceEngine.h>
+
+// B8G8R8 and R8 versions of an image, converted on first use.
+// Planes requested together are written in one pass over an R8G8B8 source
+// with the RGB row kernel of simd.h; a plane that is never asked for is never
+// made. Sources in other formats go through Image::convert.
+class ImagePlanes
+{
+public:
+    enum Plane {
+        BGR = 1,
+        Gray = 2
+    };
+
+    // The source image must outlive the planes.
+    explicit ImagePlanes(const fsdk::Image &image);
+
+    // Convert the planes of a mask that are not made yet, in one pass.
+    bool request(int planes);
+
+    // A plane, converted on first call. Invalid if the conversion failed.
+    const fsdk::Image &getBGR();
+    const fsdk::Image &getR();
+
+    const fsdk::Image &getSource() const { return m_source; }
+
+    // Mask of the planes made so far.
+    int getConverted() const { return m_converted; }
+
+private:
+    const fsdk::Image &m_source;
+    fsdk::Image m_imageBGR;
+    fsdk::Image m_imageR;
+    int m_converted = 0;
+};
+
+#endif //FACEENGINE_IMAGE_PLANES_H
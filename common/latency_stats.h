@@ -0,0 +1,51 @@
+#ifndef FACEENGINE_LATENCY_STATS_H
+#define FACEENGINE_LATENCY_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Collects latency samples and reports mean and percentiles.
+class LatencyStats
+{
+public:
+    void add(double ms) {
+        m_samples.push_back(ms);
+        m_sorted = false;
+    }
+
+    void clear() {
+        m_samples.clear();
+        m_sorted = true;
+    }
+
+    int getCount() const { return static_cast<int>(m_samples.size()); }
+
+    double getMean() const {
+        if (m_samples.empty())
+            return 0.0;
+        double sum = 0.0;
+        for (double sample : m_samples)
+            sum += sample;
+        return sum / m_samples.size();
+    }
+
+    // Nearest-rank percentile, p in [0, 100].
+    double getPercentile(double p) {
+        if (m_samples.empty())
+            return 0.0;
+        if (!m_sorted) {
+            std::sort(m_samples.begin(), m_samples.end());
+            m_sorted = true;
+        }
+        const double rank = std::ceil(p / 100.0 * m_samples.size());
+        const size_t index = rank < 1.0 ? 0 : static_cast<size_t>(rank) - 1;
+        return m_samples[std::min(index, m_samples.size() - 1)];
+    }
+
+private:
+    std::vector<double> m_samples;
+    bool m_sorted = true;
+};
+
+#endif //FACEENGINE_LATENCY_STATS_H
@@ -0,0 +1,168 @@
+#include "mapped_archive.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path, AccessHint /*hint*/, bool /*populate*/) {
+    close();
+
+    HANDLE file = CreateFileA(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        vlf::log::error("Failed to open file: %s.", path.c_str());
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        vlf::log::error("Failed to get file size: %s.", path.c_str());
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_opened = true;
+    if (m_size == 0)
+        return true;
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        vlf::log::error("Failed to map file: %s.", path.c_str());
+        close();
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        vlf::log::error("Failed to map file: %s.", path.c_str());
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::advise(AccessHint /*hint*/, size_t /*offset*/, size_t /*size*/) const {}
+
+void MappedFile::close() {
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file)
+        CloseHandle(m_file);
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+    m_opened = false;
+}
+
+#else
+
+namespace {
+
+int toAdvice(MappedFile::AccessHint hint) {
+    switch (hint) {
+    case MappedFile::AccessSequential:
+        return MADV_SEQUENTIAL;
+    case MappedFile::AccessRandom:
+        return MADV_RANDOM;
+    case MappedFile::AccessWillNeed:
+        return MADV_WILLNEED;
+    default:
+        return MADV_NORMAL;
+    }
+}
+
+}
+
+bool MappedFile::open(const std::string &path, AccessHint hint, bool populate) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        vlf::log::error("Failed to open file: %s.", path.c_str());
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        vlf::log::error("Failed to get file size: %s.", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<size_t>(fileStat.st_size);
+    m_opened = true;
+    if (m_size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (populate)
+        flags |= MAP_POPULATE;
+#else
+    (void)populate;
+#endif
+
+    void *data = mmap(nullptr, m_size, PROT_READ, flags, fd, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        vlf::log::error("Failed to map file: %s.", path.c_str());
+        m_size = 0;
+        m_opened = false;
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(data);
+
+    if (hint != AccessNormal)
+        advise(hint, 0, m_size);
+
+    return true;
+}
+
+void MappedFile::advise(AccessHint hint, size_t offset, size_t size) const {
+    if (!m_data || offset >= m_size)
+        return;
+
+    // madvise needs a page aligned address.
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t alignedOffset = offset - offset % pageSize;
+    const size_t end = std::min(m_size, offset + size);
+    madvise(const_cast<uint8_t*>(m_data) + alignedOffset, end - alignedOffset, toAdvice(hint));
+}
+
+void MappedFile::close() {
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_opened = false;
+}
+
+#endif
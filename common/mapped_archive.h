@@ -0,0 +1,97 @@
+#ifndef FACEENGINE_MAPPED_ARCHIVE_H
+#define FACEENGINE_MAPPED_ARCHIVE_H
+
+#include <FaceEngine.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    // Expected access pattern, passed to madvise() where available.
+    enum AccessHint {
+        AccessNormal,
+        AccessSequential,
+        AccessRandom,
+        AccessWillNeed
+    };
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile &operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    // Map a file. With populate set, pages are prefaulted at mapping time
+    // (MAP_POPULATE on Linux). Returns false on failure.
+    bool open(const std::string &path, AccessHint hint = AccessNormal, bool populate = false);
+
+    // Apply an access hint to the mapped range [offset, offset + size).
+    void advise(AccessHint hint, size_t offset, size_t size) const;
+
+    void close();
+
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool isOpen() const { return m_opened; }
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_opened = false;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
+
+// Archive reading straight from memory, e.g. a MappedFile.
+// Unlike VectorArchive it neither owns nor copies the source buffer,
+// so loading copies data exactly once: from mapped pages into the SDK object.
+struct MappedArchive: fsdk::IArchive
+{
+    MappedArchive(const uint8_t *data, size_t size):
+        m_data(data),
+        m_size(size)
+    {}
+
+    explicit MappedArchive(const MappedFile &file):
+        m_data(file.data()),
+        m_size(file.size())
+    {}
+
+    // Archive is read only.
+    bool write(const void* /*data*/, size_t /*size*/) override {
+        return false;
+    }
+
+    bool read(void* data, size_t size) override {
+        if (size > m_size - m_offset)
+            return false;
+        memcpy(data, m_data + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+
+    void setSizeHint(size_t /*hint*/) override {}
+
+    // Current read position.
+    size_t getOffset() const { return m_offset; }
+
+    // Move read position. Returns false if the offset is out of range.
+    bool seek(size_t offset) {
+        if (offset > m_size)
+            return false;
+        m_offset = offset;
+        return true;
+    }
+
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+};
+
+#endif //FACEENGINE_MAPPED_ARCHIVE_H
@@ -0,0 +1,148 @@
+#include "netpbm.h"
+
+#include <vlf/Log.h>
+
+#include <cstring>
+
+#include "mapped_archive.h"
+#include "simd.h"
+
+namespace {
+
+bool isSpace(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Read a decimal header field, skipping whitespace and comments before it.
+bool readNumber(const uint8_t *data, size_t size, size_t &offset, int &value) {
+    while (offset < size) {
+        if (data[offset] == '#') {
+            while (offset < size && data[offset] != '\n')
+                ++offset;
+        } else if (isSpace(data[offset])) {
+            ++offset;
+        } else {
+            break;
+        }
+    }
+    if (offset >= size || data[offset] < '0' || data[offset] > '9')
+        return false;
+
+    long long number = 0;
+    while (offset < size && data[offset] >= '0' && data[offset] <= '9') {
+        number = number * 10 + (data[offset++] - '0');
+        if (number > 0x7fffffff)
+            return false;
+    }
+    value = static_cast<int>(number);
+    return true;
+}
+
+bool createImage(fsdk::Image *image, int width, int height, fsdk::Format format) {
+    if (!image)
+        return true;
+    *image = fsdk::Image(width, height, format);
+    if (!*image) {
+        vlf::log::error("Failed to create image %dx%d.", width, height);
+        return false;
+    }
+    return true;
+}
+
+// Write every requested target in one pass over the rows.
+bool load(const char *path, fsdk::Image *imageRGB, fsdk::Image *imageBGR, fsdk::Image *imageR) {
+    MappedFile file;
+    if (!file.open(path, MappedFile::AccessSequential))
+        return false;
+
+    NetpbmHeader header;
+    if (!parseNetpbmHeader(file.data(), file.size(), header)) {
+        vlf::log::error("Failed to parse image header: \"%s\".", path);
+        return false;
+    }
+
+    const int width = header.width;
+    const int height = header.height;
+    if (!createImage(imageRGB, width, height, fsdk::Format::R8G8B8) ||
+        !createImage(imageBGR, width, height, fsdk::Format::B8G8R8) ||
+        !createImage(imageR, width, height, fsdk::Format::R8))
+        return false;
+
+    const RgbRowFunc rgbRow = getRgbRowFunc(detectSimdLevel());
+    const size_t rowSize = static_cast<size_t>(width) * header.channels;
+    const uint8_t *pixels = file.data() + header.dataOffset;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *source = pixels + rowSize * y;
+        uint8_t *rgb = imageRGB ? imageRGB->getScanLineAs<uint8_t>(y) : nullptr;
+        uint8_t *bgr = imageBGR ? imageBGR->getScanLineAs<uint8_t>(y) : nullptr;
+        uint8_t *gray = imageR ? imageR->getScanLineAs<uint8_t>(y) : nullptr;
+
+        if (header.channels == 3) {
+            if (rgb)
+                memcpy(rgb, source, rowSize);
+            if (bgr || gray)
+                rgbRow(source, bgr, gray, static_cast<size_t>(width));
+            continue;
+        }
+
+        if (gray)
+            memcpy(gray, source, rowSize);
+        for (int x = 0; x < width; ++x) {
+            if (rgb)
+                rgb[3 * x] = rgb[3 * x + 1] = rgb[3 * x + 2] = source[x];
+            if (bgr)
+                bgr[3 * x] = bgr[3 * x + 1] = bgr[3 * x + 2] = source[x];
+        }
+    }
+
+    return true;
+}
+
+}
+
+bool parseNetpbmHeader(const uint8_t *data, size_t size, NetpbmHeader &header) {
+    if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6'))
+        return false;
+
+    size_t offset = 2;
+    int maxValue = 0;
+    if (!readNumber(data, size, offset, header.width) ||
+        !readNumber(data, size, offset, header.height) ||
+        !readNumber(data, size, offset, maxValue))
+        return false;
+
+    // Samples are taken as they are, like loadFromPPM does; only 8 bit is supported.
+    if (header.width <= 0 || header.height <= 0 || maxValue <= 0 || maxValue > 255)
+        return false;
+
+    // Exactly one whitespace byte separates the header from the pixels.
+    if (offset >= size || !isSpace(data[offset]))
+        return false;
+    header.dataOffset = offset + 1;
+    header.channels = data[1] == '6' ? 3 : 1;
+
+    const size_t dataSize = static_cast<size_t>(header.width) * header.height * header.channels;
+    return dataSize <= size - header.dataOffset;
+}
+
+bool loadNetpbm(const char *path, fsdk::Format format, fsdk::Image &image) {
+    switch (format) {
+    case fsdk::Format::R8G8B8:
+        return load(path, &image, nullptr, nullptr);
+    case fsdk::Format::B8G8R8:
+        return load(path, nullptr, &image, nullptr);
+    case fsdk::Format::R8:
+        return load(path, nullptr, nullptr, &image);
+    default:
+        vlf::log::error("Unsupported image format for \"%s\".", path);
+        return false;
+    }
+}
+
+bool loadNetpbm(const char *path, fsdk::Image *imageBGR, fsdk::Image *imageR) {
+    return load(path, nullptr, imageBGR, imageR);
+}
+
+bool loadNetpbm(const char *path, fsdk::Image *imageRGB, fsdk::Image *imageBGR, fsdk::Image *imageR) {
+    return load(path, imageRGB, imageBGR, imageR);
+}
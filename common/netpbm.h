@@ -0,0 +1,39 @@
+#ifndef FACEENGINE_NETPBM_H
+#define FACEENGINE_NETPBM_H
+
+#include <FaceEngine.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary Netpbm images: P6 (color) and P5 (grayscale) with 8 bit samples.
+//
+// Image::loadFromPPM followed by Image::convert reads and writes every pixel
+// twice and allocates an intermediate image. The loader below maps the file
+// and writes the requested SDK images directly in one pass over the pixels,
+// using the RGB row kernel of simd.h. Grayscale is integer BT.601 luma and may
+// differ from Image::convert by one level.
+struct NetpbmHeader {
+    int width = 0;
+    int height = 0;
+    // 3 for P6, 1 for P5.
+    int channels = 0;
+    // Offset of the first pixel.
+    size_t dataOffset = 0;
+};
+
+// Parse a P5 or P6 header. Fails on other formats and on 16 bit samples.
+bool parseNetpbmHeader(const uint8_t *data, size_t size, NetpbmHeader &header);
+
+// Load an image in one of R8G8B8 (what loadFromPPM gives), B8G8R8 or R8.
+bool loadNetpbm(const char *path, fsdk::Format format, fsdk::Image &image);
+
+// Load color (B8G8R8) and grayscale (R8) images in one pass.
+// Either target may be null.
+bool loadNetpbm(const char *path, fsdk::Image *imageBGR, fsdk::Image *imageR);
+
+// Load the R8G8B8 image together with its B8G8R8 and R8 versions in one pass.
+// Any target may be null.
+bool loadNetpbm(const char *path, fsdk::Image *imageRGB, fsdk::Image *imageBGR, fsdk::Image *imageR);
+
+#endif //FACEENGINE_NETPBM_H
@@ -0,0 +1,169 @@
+#include "quantized_matrix.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+#include "descriptor_matrix.h"
+
+QuantizedMatrix::QuantizedMatrix(Type type, SimdLevel level):
+    m_type(type),
+    m_level(level),
+    m_l2SqrHalf(getL2SqrHalfFunc(level)),
+    m_l2SqrInt8(getL2SqrInt8Func(level))
+{}
+
+bool QuantizedMatrix::add(const fsdk::IDescriptor *descriptor) {
+    std::vector<float> row;
+    if (!DescriptorMatrix::exportDescriptor(descriptor, row))
+        return false;
+    return add(row.data(), static_cast<int>(descriptor->getDescriptorLength() / sizeof(float)));
+}
+
+bool QuantizedMatrix::add(const float *row, int dimension) {
+    if (m_count == 0) {
+        m_dimension = dimension;
+        m_stride = (static_cast<size_t>(dimension) + 15) / 16 * 16;
+    } else if (dimension != m_dimension) {
+        vlf::log::error("Descriptor dimension %d does not match matrix dimension %d.",
+                dimension, m_dimension);
+        return false;
+    }
+
+    if (m_type == Float16) {
+        m_halfs.resize(m_halfs.size() + m_stride, 0);
+        uint16_t *target = &m_halfs[m_halfs.size() - m_stride];
+        for (int i = 0; i < dimension; ++i)
+            target[i] = floatToHalf(row[i]);
+    } else {
+        float maxValue = 0.f;
+        for (int i = 0; i < dimension; ++i)
+            maxValue = std::max(maxValue, std::fabs(row[i]));
+        const float scale = maxValue > 0.f ? maxValue / 127.f : 1.f;
+        m_bytes.resize(m_bytes.size() + m_stride, 0);
+        int8_t *target = &m_bytes[m_bytes.size() - m_stride];
+        for (int i = 0; i < dimension; ++i)
+            target[i] = static_cast<int8_t>(std::max(-127.f, std::min(127.f, std::round(row[i] / scale))));
+        m_scales.push_back(scale);
+    }
+    ++m_count;
+    return true;
+}
+
+void QuantizedMatrix::reserve(int count) {
+    if (m_stride == 0)
+        return;
+    if (m_type == Float16) {
+        m_halfs.reserve(count * m_stride);
+    } else {
+        m_bytes.reserve(count * m_stride);
+        m_scales.reserve(count);
+    }
+}
+
+void QuantizedMatrix::clear() {
+    m_count = 0;
+    m_dimension = 0;
+    m_stride = 0;
+    m_halfs.clear();
+    m_bytes.clear();
+    m_scales.clear();
+}
+
+float QuantizedMatrix::getDistance(const float *query, int index) const {
+    if (m_type == Float16)
+        return m_l2SqrHalf(query, &m_halfs[m_stride * index], m_stride);
+    return m_l2SqrInt8(query, &m_bytes[m_stride * index], m_scales[index], m_stride);
+}
+
+int QuantizedMatrix::search(const float *query, int k, int *indices, float *distances) const {
+    k = std::min(k, m_count);
+    if (k <= 0)
+        return 0;
+
+    // Max-heap of the k closest rows seen so far.
+    typedef std::pair<float, int> Candidate;
+    std::priority_queue<Candidate> heap;
+    for (int i = 0; i < m_count; ++i) {
+        const float distance = getDistance(query, i);
+        if (static_cast<int>(heap.size()) < k) {
+            heap.push(Candidate(distance, i));
+        } else if (distance < heap.top().first) {
+            heap.pop();
+            heap.push(Candidate(distance, i));
+        }
+    }
+
+    for (int i = k - 1; i >= 0; --i) {
+        indices[i] = heap.top().second;
+        if (distances)
+            distances[i] = heap.top().first;
+        heap.pop();
+    }
+    return k;
+}
+
+size_t QuantizedMatrix::getBytesPerDescriptor() const {
+    if (m_type == Float16)
+        return m_stride * sizeof(uint16_t);
+    return m_stride * sizeof(int8_t) + sizeof(float);
+}
+
+const char *QuantizedMatrix::getTypeName(Type type) {
+    return type == Float16 ? "fp16" : "int8";
+}
+
+bool SimilarityCalibration::fit(
+        const std::vector<float> &distances,
+        const std::vector<float> &similarities,
+        int bins
+) {
+    m_distances.clear();
+    m_similarities.clear();
+    if (distances.size() != similarities.size() || distances.size() < 2 || bins < 2) {
+        vlf::log::error("Not enough pairs to calibrate similarity.");
+        return false;
+    }
+
+    std::vector<std::pair<float, float>> pairs(distances.size());
+    for (size_t i = 0; i < pairs.size(); ++i)
+        pairs[i] = std::make_pair(distances[i], similarities[i]);
+    std::sort(pairs.begin(), pairs.end());
+
+    const size_t binsCount = std::min(static_cast<size_t>(bins), pairs.size());
+    for (size_t bin = 0; bin < binsCount; ++bin) {
+        const size_t begin = pairs.size() * bin / binsCount;
+        const size_t end = pairs.size() * (bin + 1) / binsCount;
+        double distance = 0.0;
+        double similarity = 0.0;
+        for (size_t i = begin; i < end; ++i) {
+            distance += pairs[i].first;
+            similarity += pairs[i].second;
+        }
+        m_distances.push_back(static_cast<float>(distance / (end - begin)));
+        m_similarities.push_back(static_cast<float>(similarity / (end - begin)));
+    }
+
+    // Similarity never grows with distance.
+    for (size_t i = 1; i < m_similarities.size(); ++i)
+        m_similarities[i] = std::min(m_similarities[i], m_similarities[i - 1]);
+    return true;
+}
+
+float SimilarityCalibration::getSimilarity(float distance) const {
+    if (m_distances.empty())
+        return 0.f;
+    if (distance <= m_distances.front())
+        return m_similarities.front();
+    if (distance >= m_distances.back())
+        return m_similarities.back();
+
+    const size_t upper = std::upper_bound(m_distances.begin(), m_distances.end(), distance) - m_distances.begin();
+    const size_t lower = upper - 1;
+    const float span = m_distances[upper] - m_distances[lower];
+    const float t = span > 0.f ? (distance - m_distances[lower]) / span : 0.f;
+    return m_similarities[lower] + t * (m_similarities[upper] - m_similarities[lower]);
+}
@@ -0,0 +1,84 @@
+#ifndef FACEENGINE_QUANTIZED_MATRIX_H
+#define FACEENGINE_QUANTIZED_MATRIX_H
+
+#include <FaceEngine.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "simd.h"
+
+// Descriptors stored with reduced precision.
+// Half precision halves the memory of float descriptors; int8 with one scale
+// per row (max |value| / 127) takes about a quarter. Rows are zero padded to
+// a multiple of 16 values like DescriptorMatrix rows. Queries stay float.
+class QuantizedMatrix
+{
+public:
+    enum Type {
+        Float16,
+        Int8
+    };
+
+    explicit QuantizedMatrix(Type type, SimdLevel level = detectSimdLevel());
+
+    // Quantize raw data of a descriptor. All descriptors must have the same length.
+    bool add(const fsdk::IDescriptor *descriptor);
+
+    // Quantize a padded float row (see DescriptorMatrix::exportDescriptor).
+    bool add(const float *row, int dimension);
+
+    void reserve(int count);
+    void clear();
+
+    // Squared L2 distance from a padded float query to a row.
+    float getDistance(const float *query, int index) const;
+
+    // Indices of the k nearest rows, closest first, and their squared distances.
+    // Returns number found.
+    int search(const float *query, int k, int *indices, float *distances) const;
+
+    int getCount() const { return m_count; }
+    int getDimension() const { return m_dimension; }
+    size_t getStride() const { return m_stride; }
+    Type getType() const { return m_type; }
+    SimdLevel getSimdLevel() const { return m_level; }
+
+    // Storage per descriptor including the scale.
+    size_t getBytesPerDescriptor() const;
+
+    static const char *getTypeName(Type type);
+
+private:
+    Type m_type;
+    SimdLevel m_level;
+    L2SqrHalfFunc m_l2SqrHalf;
+    L2SqrInt8Func m_l2SqrInt8;
+    int m_count = 0;
+    int m_dimension = 0;
+    size_t m_stride = 0;
+    std::vector<uint16_t> m_halfs;
+    std::vector<int8_t> m_bytes;
+    std::vector<float> m_scales;
+};
+
+// Maps squared L2 distance to the similarity of IDescriptorMatcher.
+// The SDK does not expose its similarity function, so it is fitted from
+// pairs scored by the SDK: pairs are sorted by distance and averaged in bins
+// of equal size, then the table is made non-increasing and interpolated.
+class SimilarityCalibration
+{
+public:
+    // Distances are exact squared L2 distances of the scored pairs.
+    bool fit(const std::vector<float> &distances, const std::vector<float> &similarities, int bins = 256);
+
+    float getSimilarity(float distance) const;
+
+    bool isValid() const { return !m_distances.empty(); }
+
+private:
+    std::vector<float> m_distances;
+    std::vector<float> m_similarities;
+};
+
+#endif //FACEENGINE_QUANTIZED_MATRIX_H
@@ -0,0 +1,197 @@
+#include "sharded_gallery.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <future>
+
+bool ShardedGallery::init(const fsdk::IFaceEnginePtr &faceEngine, const Settings &settings) {
+    if (!faceEngine || settings.shardCapacity <= 0) {
+        vlf::log::error("Invalid sharded gallery settings.");
+        return false;
+    }
+    m_settings = settings;
+    m_faceEngine = faceEngine;
+    m_shards.clear();
+    m_count = 0;
+    m_pool.start(settings.threadsCount);
+    return true;
+}
+
+bool ShardedGallery::load(const std::string &path, std::vector<GalleryFile::Entry> &entries) {
+    if (!m_faceEngine) {
+        vlf::log::error("Sharded gallery is not initialized.");
+        return false;
+    }
+    fsdk::IDescriptorFactoryPtr descriptorFactory = fsdk::acquire(m_faceEngine->createDescriptorFactory());
+    if (!descriptorFactory) {
+        vlf::log::error("Failed to create face descriptor factory instance.");
+        return false;
+    }
+
+    // Batches are filled on this thread straight from the mapping, tables are built afterwards.
+    const bool loaded = GalleryFile::read(path, descriptorFactory,
+            [&](const fsdk::IDescriptorPtr &descriptor, const GalleryFile::Entry &entry) {
+                if (!append(descriptor))
+                    return false;
+                entries.push_back(entry);
+                return true;
+            });
+    if (!loaded) {
+        vlf::log::error("Failed to load gallery: \"%s\".", path.c_str());
+        return false;
+    }
+    return build();
+}
+
+bool ShardedGallery::add(fsdk::IDescriptor *descriptor) {
+    return append(descriptor) && build();
+}
+
+int ShardedGallery::search(const fsdk::IDescriptor *descriptor, int k, Neighbour *neighbours) {
+    k = std::min(k, m_count);
+    if (k <= 0)
+        return 0;
+
+    // Every shard contributes its own top-K candidates.
+    std::vector<std::vector<Neighbour>> candidates(m_shards.size());
+    std::vector<char> failed(m_shards.size(), 0);
+    auto searchShard = [&](size_t shardIndex) {
+        Shard &shard = *m_shards[shardIndex];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const int count = std::min(k, shard.batch->getCount());
+        std::vector<int> indices(count, -1);
+        shard.lsh->getKNearestNeighbours(descriptor, count, &indices[0]);
+        indices.erase(std::remove_if(indices.begin(), indices.end(),
+                [&](int index) { return index < 0 || index >= shard.batch->getCount(); }),
+                indices.end());
+        if (indices.empty())
+            return;
+
+        std::vector<fsdk::MatchingResult> results(indices.size());
+        fsdk::Result<fsdk::FSDKError> descriptorMatcherResult = shard.matcher->match(
+                descriptor,
+                shard.batch,
+                &indices[0],
+                static_cast<int>(indices.size()),
+                &results[0]
+        );
+        if (descriptorMatcherResult.isError()) {
+            vlf::log::error("Failed to match. Reason: %s.", descriptorMatcherResult.what());
+            failed[shardIndex] = 1;
+            return;
+        }
+        for (size_t i = 0; i < indices.size(); ++i) {
+            Neighbour neighbour;
+            neighbour.index = shard.firstIndex + indices[i];
+            neighbour.result = results[i];
+            candidates[shardIndex].push_back(neighbour);
+        }
+    };
+
+    if (m_shards.size() == 1) {
+        searchShard(0);
+    } else {
+        std::vector<std::future<void>> futures;
+        for (size_t shardIndex = 0; shardIndex < m_shards.size(); ++shardIndex)
+            futures.push_back(m_pool.submit(std::bind(searchShard, shardIndex)));
+        for (std::future<void> &future : futures)
+            future.wait();
+    }
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end())
+        return -1;
+
+    std::vector<Neighbour> merged;
+    for (const std::vector<Neighbour> &shardCandidates : candidates)
+        merged.insert(merged.end(), shardCandidates.begin(), shardCandidates.end());
+    const int found = std::min(k, static_cast<int>(merged.size()));
+    std::partial_sort(merged.begin(), merged.begin() + found, merged.end(),
+            [](const Neighbour &left, const Neighbour &right) {
+                return left.result.similarity > right.result.similarity;
+            });
+    std::copy(merged.begin(), merged.begin() + found, neighbours);
+    return found;
+}
+
+bool ShardedGallery::append(fsdk::IDescriptor *descriptor) {
+    Shard *shard = m_shards.empty() ? nullptr : m_shards.back().get();
+    if (!shard || shard->batch->getCount() >= m_settings.shardCapacity) {
+        shard = addShard();
+        if (!shard)
+            return false;
+    }
+    fsdk::Result<fsdk::DescriptorBatchError> descriptorBatchAddResult =
+            shard->batch->add(descriptor);
+    if (descriptorBatchAddResult.isError()) {
+        vlf::log::error("Failed to add descriptor to descriptor batch.");
+        return false;
+    }
+    shard->dirty = true;
+    ++m_count;
+    return true;
+}
+
+ShardedGallery::Shard *ShardedGallery::addShard() {
+    if (!m_faceEngine) {
+        vlf::log::error("Sharded gallery is not initialized.");
+        return nullptr;
+    }
+    std::unique_ptr<Shard> shard(new Shard());
+    shard->firstIndex = m_count;
+
+    // Every shard has its own factory, so shards can be built in parallel.
+    shard->descriptorFactory = fsdk::acquire(m_faceEngine->createDescriptorFactory());
+    if (!shard->descriptorFactory) {
+        vlf::log::error("Failed to create face descriptor factory instance.");
+        return nullptr;
+    }
+
+    shard->batch = fsdk::acquire(
+            shard->descriptorFactory->createDescriptorBatch(fsdk::DT_CNN, m_settings.shardCapacity));
+    if (!shard->batch) {
+        vlf::log::error("Failed to create face descriptor batch instance.");
+        return nullptr;
+    }
+
+    shard->matcher = fsdk::acquire(shard->descriptorFactory->createMatcher(fsdk::DT_CNN));
+    if (!shard->matcher) {
+        vlf::log::error("Failed to create face descriptor matcher instance.");
+        return nullptr;
+    }
+
+    m_shards.push_back(std::move(shard));
+    return m_shards.back().get();
+}
+
+bool ShardedGallery::build(Shard &shard) {
+    // Tables are immutable; a changed batch gets a new one.
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.lsh = fsdk::acquire(shard.descriptorFactory->createLSHTable(fsdk::DT_CNN, shard.batch.get()));
+    if (!shard.lsh) {
+        vlf::log::error("Failed to create LSH table instance.");
+        return false;
+    }
+    shard.dirty = false;
+    return true;
+}
+
+bool ShardedGallery::build() {
+    std::vector<Shard*> dirtyShards;
+    for (const std::unique_ptr<Shard> &shard : m_shards) {
+        if (shard->dirty)
+            dirtyShards.push_back(shard.get());
+    }
+    if (dirtyShards.size() == 1)
+        return build(*dirtyShards[0]);
+
+    std::vector<char> built(dirtyShards.size(), 0);
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < dirtyShards.size(); ++i) {
+        Shard *shard = dirtyShards[i];
+        char *result = &built[i];
+        futures.push_back(m_pool.submit([shard, result] { *result = build(*shard) ? 1 : 0; }));
+    }
+    for (std::future<void> &future : futures)
+        future.wait();
+    return std::find(built.begin(), built.end(), 0) == built.end();
+}
@@ -0,0 +1,88 @@
+#ifndef FACEENGINE_SHARDED_GALLERY_H
+#define FACEENGINE_SHARDED_GALLERY_H
+
+#include <FaceEngine.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gallery.h"
+#include "thread_pool.h"
+
+// Descriptor gallery split into shards of limited size.
+// LSH tables are immutable and tied to one batch, so a single large batch
+// needs a full table rebuild on every enrollment. Here each shard owns its
+// batch and LSH table, and an append rebuilds only the tail shard. Tables of
+// all shards are built in parallel on load. A search queries every shard on
+// the thread pool, scores the shard candidates with the SDK matcher and
+// merges them into a global top-K.
+//
+// Searches may run concurrently; adding descriptors must not overlap with searches.
+class ShardedGallery
+{
+public:
+    struct Settings {
+        // Maximal number of descriptors per shard.
+        int shardCapacity = 10000;
+
+        // Threads used to build and search shards; 0 means number of cores.
+        int threadsCount = 0;
+    };
+
+    // One search result; index is the position in the whole gallery.
+    struct Neighbour {
+        int index;
+        fsdk::MatchingResult result;
+    };
+
+    ShardedGallery() = default;
+    ShardedGallery(const ShardedGallery&) = delete;
+    ShardedGallery &operator=(const ShardedGallery&) = delete;
+
+    bool init(const fsdk::IFaceEnginePtr &faceEngine, const Settings &settings);
+
+    // Append descriptors of a gallery file (see GalleryFile) and build the new shards.
+    // Entries receive ids and names of the appended descriptors.
+    bool load(const std::string &path, std::vector<GalleryFile::Entry> &entries);
+
+    // Append one descriptor and rebuild the tail shard.
+    bool add(fsdk::IDescriptor *descriptor);
+
+    // Append a descriptor without rebuilding; call build() before searching.
+    // A new shard is opened when the tail one is full.
+    bool append(fsdk::IDescriptor *descriptor);
+
+    // Rebuild LSH tables of all changed shards in parallel.
+    bool build();
+
+    // Up to k most similar descriptors, best first. Returns number found or -1 on failure.
+    int search(const fsdk::IDescriptor *descriptor, int k, Neighbour *neighbours);
+
+    int getCount() const { return m_count; }
+    int getShardsCount() const { return static_cast<int>(m_shards.size()); }
+
+private:
+    struct Shard {
+        fsdk::IDescriptorFactoryPtr descriptorFactory;
+        fsdk::IDescriptorBatchPtr batch;
+        fsdk::ILSHTablePtr lsh;
+        fsdk::IDescriptorMatcherPtr matcher;
+        int firstIndex = 0;
+        bool dirty = false;
+        // LSH tables and matchers are not thread safe.
+        std::mutex mutex;
+    };
+
+    Shard *addShard();
+    static bool build(Shard &shard);
+
+    Settings m_settings;
+    fsdk::IFaceEnginePtr m_faceEngine;
+    ThreadPool m_pool;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    int m_count = 0;
+};
+
+#endif //FACEENGINE_SHARDED_GALLERY_H
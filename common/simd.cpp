@@ -0,0 +1,497 @@
+#include "simd.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FSDK_EXAMPLES_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang compile each kernel for its own instruction set, so the
+// library itself needs no -mavx flags and runs on any x86 CPU.
+// Every CPU with AVX2 also has F16C, so the AVX2 level implies it.
+#if defined(FSDK_EXAMPLES_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+namespace {
+
+float l2SqrScalar(const float *a, const float *b, size_t length) {
+    // Four accumulators let the compiler vectorize with baseline SSE.
+    float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+    for (size_t i = 0; i < length; i += 4) {
+        for (size_t j = 0; j < 4; ++j) {
+            const float d = a[i + j] - b[i + j];
+            sum[j] += d * d;
+        }
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+float l2SqrHalfScalar(const float *query, const uint16_t *row, size_t length) {
+    float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+    for (size_t i = 0; i < length; i += 4) {
+        for (size_t j = 0; j < 4; ++j) {
+            const float d = query[i + j] - halfToFloat(row[i + j]);
+            sum[j] += d * d;
+        }
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+float l2SqrInt8Scalar(const float *query, const int8_t *row, float scale, size_t length) {
+    float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+    for (size_t i = 0; i < length; i += 4) {
+        for (size_t j = 0; j < 4; ++j) {
+            const float d = query[i + j] - row[i + j] * scale;
+            sum[j] += d * d;
+        }
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+void rgbRowScalar(const uint8_t *rgb, uint8_t *bgr, uint8_t *gray, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i, rgb += 3) {
+        if (bgr) {
+            bgr[3 * i] = rgb[2];
+            bgr[3 * i + 1] = rgb[1];
+            bgr[3 * i + 2] = rgb[0];
+        }
+        if (gray)
+            gray[i] = static_cast<uint8_t>((77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8);
+    }
+}
+
+void bgrxRowScalar(const uint8_t *bgrx, uint8_t *rgb, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i, bgrx += 4, rgb += 3) {
+        rgb[0] = bgrx[2];
+        rgb[1] = bgrx[1];
+        rgb[2] = bgrx[0];
+    }
+}
+
+#ifdef FSDK_EXAMPLES_X86
+
+// Byte shuffles of 16 packed RGB pixels held in three 16 byte vectors.
+// -1 clears a byte, so every result is the OR of shuffles of the sources it takes bytes from.
+alignas(16) const int8_t RgbToBgrMasks[7][16] = {
+    // First BGR vector from sources 0 and 1.
+    { 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -1 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1 },
+    // Second BGR vector from sources 0, 1 and 2.
+    { -1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 0, -1, 4, 3, 2, 7, 6, 5, 10, 9, 8, 13, 12, 11, -1, 15 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1 },
+    // Third BGR vector from sources 1 and 2.
+    { 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { -1, 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10, 15, 14, 13 }
+};
+
+// Planes R, G and B, each from sources 0, 1 and 2.
+alignas(16) const int8_t RgbPlaneMasks[9][16] = {
+    { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 },
+    { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 },
+    { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 }
+};
+
+TARGET_AVX2
+__m256i loadMaskAVX2(const int8_t *mask) {
+    return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(mask)));
+}
+
+// Lane 0 holds bytes [0, 16) of the source, lane 1 bytes [48, 64).
+TARGET_AVX2
+__m256i loadLanesAVX2(const uint8_t *source) {
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 48));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+TARGET_AVX2
+__m256i lumaAVX2(__m256i r, __m256i g, __m256i b) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i kr = _mm256_set1_epi16(77);
+    const __m256i kg = _mm256_set1_epi16(150);
+    const __m256i kb = _mm256_set1_epi16(29);
+    const __m256i half = _mm256_set1_epi16(128);
+    // The weights add up to 256, so sums fit unsigned 16 bit lanes.
+    const __m256i low = _mm256_srli_epi16(_mm256_add_epi16(
+            _mm256_add_epi16(
+                    _mm256_mullo_epi16(_mm256_unpacklo_epi8(r, zero), kr),
+                    _mm256_mullo_epi16(_mm256_unpacklo_epi8(g, zero), kg)),
+            _mm256_add_epi16(
+                    _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), kb),
+                    half)), 8);
+    const __m256i high = _mm256_srli_epi16(_mm256_add_epi16(
+            _mm256_add_epi16(
+                    _mm256_mullo_epi16(_mm256_unpackhi_epi8(r, zero), kr),
+                    _mm256_mullo_epi16(_mm256_unpackhi_epi8(g, zero), kg)),
+            _mm256_add_epi16(
+                    _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), kb),
+                    half)), 8);
+    return _mm256_packus_epi16(low, high);
+}
+
+// 32 pixels per iteration: lane 0 converts pixels [0, 16), lane 1 pixels [16, 32).
+TARGET_AVX2
+void rgbRowAVX2(const uint8_t *rgb, uint8_t *bgr, uint8_t *gray, size_t pixels) {
+    __m256i bgrMasks[7];
+    for (int i = 0; i < 7; ++i)
+        bgrMasks[i] = loadMaskAVX2(RgbToBgrMasks[i]);
+    __m256i planeMasks[9];
+    for (int i = 0; i < 9; ++i)
+        planeMasks[i] = loadMaskAVX2(RgbPlaneMasks[i]);
+
+    size_t i = 0;
+    for (; i + 32 <= pixels; i += 32) {
+        const uint8_t *source = rgb + 3 * i;
+        const __m256i s0 = loadLanesAVX2(source);
+        const __m256i s1 = loadLanesAVX2(source + 16);
+        const __m256i s2 = loadLanesAVX2(source + 32);
+
+        if (bgr) {
+            const __m256i t0 = _mm256_or_si256(
+                    _mm256_shuffle_epi8(s0, bgrMasks[0]),
+                    _mm256_shuffle_epi8(s1, bgrMasks[1]));
+            const __m256i t1 = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_shuffle_epi8(s0, bgrMasks[2]), _mm256_shuffle_epi8(s1, bgrMasks[3])),
+                    _mm256_shuffle_epi8(s2, bgrMasks[4]));
+            const __m256i t2 = _mm256_or_si256(
+                    _mm256_shuffle_epi8(s1, bgrMasks[5]),
+                    _mm256_shuffle_epi8(s2, bgrMasks[6]));
+            __m128i *target = reinterpret_cast<__m128i*>(bgr + 3 * i);
+            _mm_storeu_si128(target, _mm256_castsi256_si128(t0));
+            _mm_storeu_si128(target + 1, _mm256_castsi256_si128(t1));
+            _mm_storeu_si128(target + 2, _mm256_castsi256_si128(t2));
+            _mm_storeu_si128(target + 3, _mm256_extracti128_si256(t0, 1));
+            _mm_storeu_si128(target + 4, _mm256_extracti128_si256(t1, 1));
+            _mm_storeu_si128(target + 5, _mm256_extracti128_si256(t2, 1));
+        }
+
+        if (gray) {
+            __m256i planes[3];
+            for (int c = 0; c < 3; ++c) {
+                planes[c] = _mm256_or_si256(
+                        _mm256_or_si256(
+                                _mm256_shuffle_epi8(s0, planeMasks[3 * c]),
+                                _mm256_shuffle_epi8(s1, planeMasks[3 * c + 1])),
+                        _mm256_shuffle_epi8(s2, planeMasks[3 * c + 2]));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(gray + i), lumaAVX2(planes[0], planes[1], planes[2]));
+        }
+    }
+    rgbRowScalar(rgb + 3 * i, bgr ? bgr + 3 * i : nullptr, gray ? gray + i : nullptr, pixels - i);
+}
+
+// 16 pixels per iteration. Every lane packs 4 pixels into its first 12 bytes
+// and is stored with 16 byte writes that overlap the next pixels, so the loop
+// stops early enough for the last write to stay inside the row.
+TARGET_AVX2
+void bgrxRowAVX2(const uint8_t *bgrx, uint8_t *rgb, size_t pixels) {
+    const __m256i mask = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 18 <= pixels; i += 16) {
+        const __m256i p0 = _mm256_shuffle_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgrx + 4 * i)), mask);
+        const __m256i p1 = _mm256_shuffle_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgrx + 4 * i + 32)), mask);
+        uint8_t *target = rgb + 3 * i;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm256_castsi256_si128(p0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 12), _mm256_extracti128_si256(p0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 24), _mm256_castsi256_si128(p1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 36), _mm256_extracti128_si256(p1, 1));
+    }
+    bgrxRowScalar(bgrx + 4 * i, rgb + 3 * i, pixels - i);
+}
+
+TARGET_AVX2
+float horizontalSumAVX2(__m256 sum) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+TARGET_AVX2
+float l2SqrAVX2(const float *a, const float *b, size_t length) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < length; i += 16) {
+        const __m256 d0 = _mm256_sub_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i));
+        const __m256 d1 = _mm256_sub_ps(_mm256_load_ps(a + i + 8), _mm256_load_ps(b + i + 8));
+        sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+        sum1 = _mm256_fmadd_ps(d1, d1, sum1);
+    }
+    return horizontalSumAVX2(_mm256_add_ps(sum0, sum1));
+}
+
+TARGET_AVX2
+float l2SqrHalfAVX2(const float *query, const uint16_t *row, size_t length) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < length; i += 16) {
+        const __m256 r0 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        const __m256 r1 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 8)));
+        const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(query + i), r0);
+        const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(query + i + 8), r1);
+        sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+        sum1 = _mm256_fmadd_ps(d1, d1, sum1);
+    }
+    return horizontalSumAVX2(_mm256_add_ps(sum0, sum1));
+}
+
+TARGET_AVX2
+float l2SqrInt8AVX2(const float *query, const int8_t *row, float scale, size_t length) {
+    const __m256 factor = _mm256_set1_ps(scale);
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        const __m256 r0 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+        const __m256 r1 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(bytes, 8)));
+        const __m256 d0 = _mm256_fnmadd_ps(r0, factor, _mm256_loadu_ps(query + i));
+        const __m256 d1 = _mm256_fnmadd_ps(r1, factor, _mm256_loadu_ps(query + i + 8));
+        sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+        sum1 = _mm256_fmadd_ps(d1, d1, sum1);
+    }
+    return horizontalSumAVX2(_mm256_add_ps(sum0, sum1));
+}
+
+TARGET_AVX512
+float l2SqrAVX512(const float *a, const float *b, size_t length) {
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t i = 0; i < length; i += 16) {
+        const __m512 d = _mm512_sub_ps(_mm512_load_ps(a + i), _mm512_load_ps(b + i));
+        sum = _mm512_fmadd_ps(d, d, sum);
+    }
+    return _mm512_reduce_add_ps(sum);
+}
+
+TARGET_AVX512
+float l2SqrHalfAVX512(const float *query, const uint16_t *row, size_t length) {
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t i = 0; i < length; i += 16) {
+        const __m512 r = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+        const __m512 d = _mm512_sub_ps(_mm512_loadu_ps(query + i), r);
+        sum = _mm512_fmadd_ps(d, d, sum);
+    }
+    return _mm512_reduce_add_ps(sum);
+}
+
+TARGET_AVX512
+float l2SqrInt8AVX512(const float *query, const int8_t *row, float scale, size_t length) {
+    const __m512 factor = _mm512_set1_ps(scale);
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t i = 0; i < length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        const __m512 r = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(bytes));
+        const __m512 d = _mm512_fnmadd_ps(r, factor, _mm512_loadu_ps(query + i));
+        sum = _mm512_fmadd_ps(d, d, sum);
+    }
+    return _mm512_reduce_add_ps(sum);
+}
+
+SimdLevel detect() {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdAVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdAVX2;
+    return SimdNone;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return SimdNone;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave)
+        return SimdNone;
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    const bool avx512f = (info[1] & (1 << 16)) != 0;
+    if (avx512f && (xcr0 & 0xe6) == 0xe6)
+        return SimdAVX512;
+    if (avx2 && fma && (xcr0 & 0x6) == 0x6)
+        return SimdAVX2;
+    return SimdNone;
+#else
+    return SimdNone;
+#endif
+}
+
+#else
+
+SimdLevel detect() {
+    return SimdNone;
+}
+
+#endif
+
+}
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = detect();
+    return level;
+}
+
+const char *simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdAVX2:
+        return "AVX2";
+    case SimdAVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
+
+L2SqrFunc getL2SqrFunc(SimdLevel level) {
+#ifdef FSDK_EXAMPLES_X86
+    switch (level) {
+    case SimdAVX512:
+        return l2SqrAVX512;
+    case SimdAVX2:
+        return l2SqrAVX2;
+    default:
+        break;
+    }
+#else
+    (void)level;
+#endif
+    return l2SqrScalar;
+}
+
+L2SqrHalfFunc getL2SqrHalfFunc(SimdLevel level) {
+#ifdef FSDK_EXAMPLES_X86
+    switch (level) {
+    case SimdAVX512:
+        return l2SqrHalfAVX512;
+    case SimdAVX2:
+        return l2SqrHalfAVX2;
+    default:
+        break;
+    }
+#else
+    (void)level;
+#endif
+    return l2SqrHalfScalar;
+}
+
+L2SqrInt8Func getL2SqrInt8Func(SimdLevel level) {
+#ifdef FSDK_EXAMPLES_X86
+    switch (level) {
+    case SimdAVX512:
+        return l2SqrInt8AVX512;
+    case SimdAVX2:
+        return l2SqrInt8AVX2;
+    default:
+        break;
+    }
+#else
+    (void)level;
+#endif
+    return l2SqrInt8Scalar;
+}
+
+RgbRowFunc getRgbRowFunc(SimdLevel level) {
+#ifdef FSDK_EXAMPLES_X86
+    // Shuffles do not gain from 512 bit vectors here; AVX-512 CPUs use the AVX2 kernel.
+    if (level == SimdAVX2 || level == SimdAVX512)
+        return rgbRowAVX2;
+#else
+    (void)level;
+#endif
+    return rgbRowScalar;
+}
+
+BgrxRowFunc getBgrxRowFunc(SimdLevel level) {
+#ifdef FSDK_EXAMPLES_X86
+    if (level == SimdAVX2 || level == SimdAVX512)
+        return bgrxRowAVX2;
+#else
+    (void)level;
+#endif
+    return bgrxRowScalar;
+}
+
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t mantissa = bits & 0x7fffff;
+    const int exponent = static_cast<int>((bits >> 23) & 0xff);
+
+    // Infinity and NaN.
+    if (exponent == 0xff)
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+    const int halfExponent = exponent - 127 + 15;
+    if (halfExponent >= 0x1f)
+        return static_cast<uint16_t>(sign | 0x7c00);
+
+    // Subnormal half or zero.
+    if (halfExponent <= 0) {
+        if (halfExponent < -10)
+            return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000;
+        const int shift = 14 - halfExponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Rounding may carry into the exponent, which is still correct.
+    uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+    return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    int exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | (static_cast<uint32_t>(exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Normalize a subnormal half.
+        exponent = 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        mantissa &= 0x3ff;
+        bits = sign | (static_cast<uint32_t>(exponent + 112) << 23) | (mantissa << 13);
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
@@ -0,0 +1,55 @@
+#ifndef FACEENGINE_SIMD_H
+#define FACEENGINE_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Instruction sets the vector kernels can use.
+enum SimdLevel {
+    SimdNone,
+    SimdAVX2,
+    SimdAVX512
+};
+
+// Best instruction set supported by this CPU (detected once).
+SimdLevel detectSimdLevel();
+
+const char *simdLevelName(SimdLevel level);
+
+// Squared L2 distance between two float vectors.
+// Length must be a multiple of 16; pointers must be 64 byte aligned.
+typedef float (*L2SqrFunc)(const float *a, const float *b, size_t length);
+
+// Kernel for a given level; SimdNone gives the portable version.
+L2SqrFunc getL2SqrFunc(SimdLevel level);
+
+// Squared L2 distance between a float query and a half precision row.
+// Length must be a multiple of 16; no alignment is required.
+typedef float (*L2SqrHalfFunc)(const float *query, const uint16_t *row, size_t length);
+
+// Squared L2 distance between a float query and an int8 row dequantized by scale.
+// Length must be a multiple of 16; no alignment is required.
+typedef float (*L2SqrInt8Func)(const float *query, const int8_t *row, float scale, size_t length);
+
+L2SqrHalfFunc getL2SqrHalfFunc(SimdLevel level);
+L2SqrInt8Func getL2SqrInt8Func(SimdLevel level);
+
+// Convert a row of packed R8G8B8 pixels in one pass. Either target may be null:
+// bgr receives B8G8R8 pixels, gray receives luma (77 R + 150 G + 29 B + 128) >> 8.
+// Swapping R and B is symmetric, so the bgr target also turns B8G8R8 into R8G8B8.
+// No alignment is required.
+typedef void (*RgbRowFunc)(const uint8_t *rgb, uint8_t *bgr, uint8_t *gray, size_t pixels);
+
+RgbRowFunc getRgbRowFunc(SimdLevel level);
+
+// Convert a row of 4 byte B8G8R8X8 pixels to R8G8B8, dropping the fourth byte.
+// No alignment is required.
+typedef void (*BgrxRowFunc)(const uint8_t *bgrx, uint8_t *rgb, size_t pixels);
+
+BgrxRowFunc getBgrxRowFunc(SimdLevel level);
+
+// IEEE 754 half precision conversions (round to nearest even).
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+#endif //FACEENGINE_SIMD_H
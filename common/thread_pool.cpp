@@ -0,0 +1,56 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::start(int threadsCount, size_t queueCapacity) {
+    stop();
+
+    if (threadsCount <= 0)
+        threadsCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (queueCapacity == 0)
+        queueCapacity = static_cast<size_t>(threadsCount) * 4;
+
+    m_queue.reset(new BoundedQueue<Task>(queueCapacity));
+    for (int i = 0; i < threadsCount; ++i)
+        m_threads.push_back(std::thread(&ThreadPool::run, this));
+}
+
+void ThreadPool::stop() {
+    if (m_queue)
+        m_queue->close();
+    for (std::thread &thread : m_threads)
+        thread.join();
+    m_threads.clear();
+    m_queue.reset();
+}
+
+std::future<void> ThreadPool::submit(Job job) {
+    Task task;
+    std::future<void> future = task.promise.get_future();
+    if (!m_queue) {
+        job();
+        task.promise.set_value();
+        return future;
+    }
+    task.job = std::move(job);
+    if (!m_queue->push(std::move(task))) {
+        // The pool was stopped; the task and its promise are gone.
+        std::promise<void> rejected;
+        future = rejected.get_future();
+        rejected.set_value();
+    }
+    return future;
+}
+
+void ThreadPool::run() {
+    Task task;
+    while (m_queue->pop(task)) {
+        task.job();
+        task.promise.set_value();
+        task.job = Job();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef FACEENGINE_THREAD_POOL_H
+#define FACEENGINE_THREAD_POOL_H
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+
+// Fixed set of threads running queued jobs.
+// Jobs must not submit to the pool they run on: submit() blocks while the
+// queue is full and could wait for itself.
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Job;
+
+    ThreadPool() = default;
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool &operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // Start threads; 0 means number of cores. Queue capacity 0 means four jobs per thread.
+    void start(int threadsCount = 0, size_t queueCapacity = 0);
+
+    // Finish queued jobs and join the threads.
+    void stop();
+
+    // Queue a job. The future is ready once the job has run.
+    // If the pool is not running the job runs on the calling thread.
+    std::future<void> submit(Job job);
+
+    int getThreadsCount() const { return static_cast<int>(m_threads.size()); }
+
+private:
+    struct Task {
+        Job job;
+        std::promise<void> promise;
+    };
+
+    void run();
+
+    std::vector<std::thread> m_threads;
+    std::unique_ptr<BoundedQueue<Task>> m_queue;
+};
+
+#endif //FACEENGINE_THREAD_POOL_H
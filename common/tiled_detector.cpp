@@ -0,0 +1,203 @@
+#include "tiled_detector.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <thread>
+
+namespace {
+
+// Positions of tiles along one side, first at 0 and last at length - tileSize.
+std::vector<int> spreadTiles(int length, int tileSize, int overlap) {
+    std::vector<int> positions;
+    if (length <= tileSize) {
+        positions.push_back(0);
+        return positions;
+    }
+    const int step = tileSize - overlap;
+    const int count = (length - overlap + step - 1) / step;
+    for (int i = 0; i < count; ++i)
+        positions.push_back(static_cast<int>(static_cast<int64_t>(i) * (length - tileSize) / (count - 1)));
+    return positions;
+}
+
+// Intersection area over the area of the smaller rect.
+float getOverlap(const fsdk::Rect &a, const fsdk::Rect &b) {
+    const int intersection = (a & b).getArea();
+    const int smaller = std::min(a.getArea(), b.getArea());
+    return smaller > 0 ? static_cast<float>(intersection) / smaller : 0.f;
+}
+
+}
+
+bool TiledDetector::init(const fsdk::IFaceEnginePtr &faceEngine, const Settings &settings) {
+    m_pool.stop();
+    m_detectors.clear();
+
+    m_settings = settings;
+    if (m_settings.tileSize < 64 || m_settings.overlap < 0 || m_settings.overlap >= m_settings.tileSize) {
+        vlf::log::error("Invalid tile size %d with overlap %d.", m_settings.tileSize, m_settings.overlap);
+        return false;
+    }
+    int threadsCount = m_settings.threadsCount;
+    if (threadsCount <= 0)
+        threadsCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    fsdk::IDetectorFactoryPtr detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
+    if (!detectorFactory) {
+        vlf::log::error("Failed to create face detector factory instance.");
+        return false;
+    }
+    for (int i = 0; i < threadsCount; ++i) {
+        fsdk::IDetectorPtr detector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_MTCNN));
+        if (!detector) {
+            vlf::log::error("Failed to create face detector instance.");
+            m_detectors.clear();
+            return false;
+        }
+        m_detectors.push_back(detector);
+    }
+
+    m_pool.start(threadsCount);
+    return true;
+}
+
+std::vector<TiledDetector::Tile> TiledDetector::makeTiles(const fsdk::Rect &bounds, int tileSize, int overlap) {
+    const std::vector<int> columns = spreadTiles(bounds.width, tileSize, overlap);
+    const std::vector<int> rows = spreadTiles(bounds.height, tileSize, overlap);
+
+    std::vector<Tile> tiles;
+    tiles.reserve(columns.size() * rows.size());
+    for (size_t row = 0; row < rows.size(); ++row) {
+        for (size_t column = 0; column < columns.size(); ++column) {
+            Tile tile;
+            tile.rect = fsdk::Rect(
+                    bounds.x + columns[column],
+                    bounds.y + rows[row],
+                    std::min(tileSize, bounds.width),
+                    std::min(tileSize, bounds.height)
+            );
+            tile.innerLeft = column > 0;
+            tile.innerTop = row > 0;
+            tile.innerRight = column + 1 < columns.size();
+            tile.innerBottom = row + 1 < rows.size();
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+int TiledDetector::detect(
+        const fsdk::Image &image,
+        fsdk::Detection *detections,
+        fsdk::IMTCNNDetector::Landmarks *landmarks,
+        int maxCount
+) {
+    if (!image) {
+        vlf::log::error("Request image is invalid.");
+        return -1;
+    }
+    if (m_detectors.empty()) {
+        vlf::log::error("Tiled detector is not initialized.");
+        return -1;
+    }
+
+    const std::vector<Tile> tiles = makeTiles(image.getRect(), m_settings.tileSize, m_settings.overlap);
+    m_tilesCount = static_cast<int>(tiles.size());
+
+    // Every detector takes the next free tile until none is left.
+    std::vector<std::vector<Face>> tileFaces(tiles.size());
+    std::atomic<size_t> nextTile(0);
+    std::atomic<bool> failed(false);
+    const size_t jobsCount = std::min(m_detectors.size(), tiles.size());
+    std::vector<std::future<void>> jobs;
+    for (size_t i = 0; i < jobsCount; ++i) {
+        jobs.push_back(m_pool.submit([&, i]() {
+            for (size_t tile = nextTile++; tile < tiles.size() && !failed; tile = nextTile++) {
+                if (!detectTile(m_detectors[i], image, tiles[tile], tileFaces[tile]))
+                    failed = true;
+            }
+        }));
+    }
+    for (std::future<void> &job : jobs)
+        job.get();
+    if (failed)
+        return -1;
+
+    std::vector<Face> faces;
+    for (const std::vector<Face> &tile : tileFaces)
+        faces.insert(faces.end(), tile.begin(), tile.end());
+
+    // Whole faces go before the cut ones, then by score, so a face on a tile
+    // border is represented by the tile that saw all of it.
+    std::stable_sort(faces.begin(), faces.end(), [](const Face &a, const Face &b) {
+        if (a.clipped != b.clipped)
+            return !a.clipped;
+        return a.detection.score > b.detection.score;
+    });
+
+    std::vector<const Face*> kept;
+    for (const Face &face : faces) {
+        bool duplicate = false;
+        for (const Face *other : kept) {
+            if (getOverlap(face.detection.rect, other->detection.rect) > m_settings.overlapThreshold) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate)
+            kept.push_back(&face);
+    }
+
+    std::stable_sort(kept.begin(), kept.end(), [](const Face *a, const Face *b) {
+        return a->detection.score > b->detection.score;
+    });
+    const int count = std::min(static_cast<int>(kept.size()), maxCount);
+    for (int i = 0; i < count; ++i) {
+        detections[i] = kept[i]->detection;
+        if (landmarks)
+            landmarks[i] = kept[i]->landmarks;
+    }
+    return count;
+}
+
+bool TiledDetector::detectTile(
+        const fsdk::IDetectorPtr &detector,
+        const fsdk::Image &image,
+        const Tile &tile,
+        std::vector<Face> &faces
+) {
+    std::vector<fsdk::Detection> detections(m_settings.maxDetectionsPerTile);
+    std::vector<fsdk::IMTCNNDetector::Landmarks> landmarks(m_settings.maxDetectionsPerTile);
+    fsdk::ResultValue<fsdk::FSDKError, int> detectorResult =
+            detector.as<fsdk::IMTCNNDetector>()->detect(
+                    image,
+                    tile.rect,
+                    &detections[0],
+                    &landmarks[0],
+                    m_settings.maxDetectionsPerTile
+            );
+    if (detectorResult.isError()) {
+        vlf::log::error("Failed to detect faces. Reason: %s.", detectorResult.what());
+        return false;
+    }
+
+    // Boxes within a couple of pixels of an inner tile edge may be cut by it.
+    const int margin = 2;
+    for (int i = 0; i < detectorResult.getValue(); ++i) {
+        Face face;
+        face.detection = detections[i];
+        face.landmarks = landmarks[i];
+        const fsdk::Rect &rect = face.detection.rect;
+        face.clipped =
+                (tile.innerLeft && rect.x <= tile.rect.x + margin) ||
+                (tile.innerTop && rect.y <= tile.rect.y + margin) ||
+                (tile.innerRight && rect.x + rect.width >= tile.rect.x + tile.rect.width - margin) ||
+                (tile.innerBottom && rect.y + rect.height >= tile.rect.y + tile.rect.height - margin);
+        faces.push_back(face);
+    }
+    return true;
+}
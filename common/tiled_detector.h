@@ -0,0 +1,95 @@
+#ifndef FACEENGINE_TILED_DETECTOR_H
+#define FACEENGINE_TILED_DETECTOR_H
+
+#include <FaceEngine.h>
+
+#include <vector>
+
+#include "thread_pool.h"
+
+// MTCNN detection of very large images split into overlapping tiles.
+// One detect() call over the whole image runs on one thread. Here the image
+// is cut into square tiles that overlap by more than the largest expected
+// face, every thread owns a detector and works through the tiles passing
+// them as the detection rect, and the results are merged with non-maximum
+// suppression so that faces seen by two tiles are reported once.
+//
+// Not thread safe; detect() uses every detector of the object.
+class TiledDetector
+{
+public:
+    struct Settings {
+        // Number of detector threads; 0 means number of cores.
+        int threadsCount = 0;
+
+        // Side of a tile in pixels. Images that fit one tile take a single call.
+        int tileSize = 1024;
+
+        // Overlap of neighbouring tiles; faces up to this size are whole in some tile.
+        int overlap = 192;
+
+        // Detections kept per tile.
+        int maxDetectionsPerTile = 64;
+
+        // Two detections are the same face if their intersection covers this
+        // share of the smaller one. A face cut by a tile edge yields a box
+        // inside the whole face box, which plain IoU would keep.
+        float overlapThreshold = 0.5f;
+    };
+
+    struct Tile {
+        fsdk::Rect rect;
+        // Tile edges shared with a neighbour tile rather than the image border.
+        bool innerLeft;
+        bool innerTop;
+        bool innerRight;
+        bool innerBottom;
+    };
+
+    TiledDetector() = default;
+    TiledDetector(const TiledDetector&) = delete;
+    TiledDetector &operator=(const TiledDetector&) = delete;
+
+    // Create one MTCNN detector per thread and start the threads. Returns false on failure.
+    bool init(const fsdk::IFaceEnginePtr &faceEngine, const Settings &settings);
+
+    // Detect faces of the whole image; landmarks are relative to their detection
+    // rect as with IMTCNNDetector. Faces are sorted by score and the best
+    // maxCount are returned. Returns the number of faces, or -1 on failure.
+    int detect(
+            const fsdk::Image &image,
+            fsdk::Detection *detections,
+            fsdk::IMTCNNDetector::Landmarks *landmarks,
+            int maxCount
+    );
+
+    int getThreadsCount() const { return static_cast<int>(m_detectors.size()); }
+
+    // Number of tiles the last image was split into.
+    int getTilesCount() const { return m_tilesCount; }
+
+    // Overlapping tiles covering the bounds, spread evenly in both directions.
+    static std::vector<Tile> makeTiles(const fsdk::Rect &bounds, int tileSize, int overlap);
+
+private:
+    struct Face {
+        fsdk::Detection detection;
+        fsdk::IMTCNNDetector::Landmarks landmarks;
+        // The box touches a tile edge inside the image, so the face may be cut.
+        bool clipped;
+    };
+
+    bool detectTile(
+            const fsdk::IDetectorPtr &detector,
+            const fsdk::Image &image,
+            const Tile &tile,
+            std::vector<Face> &faces
+    );
+
+    Settings m_settings;
+    std::vector<fsdk::IDetectorPtr> m_detectors;
+    ThreadPool m_pool;
+    int m_tilesCount = 0;
+};
+
+#endif //FACEENGINE_TILED_DETECTOR_H
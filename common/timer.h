@@ -0,0 +1,34 @@
+#ifndef FACEENGINE_TIMER_H
+#define FACEENGINE_TIMER_H
+
+#include <chrono>
+
+// Wall clock stopwatch used to time SDK calls.
+class Timer
+{
+public:
+    Timer():
+        m_start(std::chrono::steady_clock::now())
+    {}
+
+    // Restart the measurement.
+    void reset() {
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    // Milliseconds elapsed since construction or last reset.
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    // Seconds elapsed since construction or last reset.
+    double elapsedSec() const {
+        return elapsedMs() / 1000.0;
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif //FACEENGINE_TIMER_H
@@ -1,17 +1,17 @@
 #include <FaceEngine.h>
 #include <vlf/Log.h>
 
+#include <cstdlib>
 #include <iostream>
+#include <vector>
 
-// Extract face descriptor.
-fsdk::IDescriptorPtr extractDescriptor(
-        fsdk::IDetectorPtr faceDetector,
-        fsdk::IFeatureFactoryPtr featureFactory,
-        fsdk::IFeatureDetectorPtr featureDetector,
-        fsdk::IDescriptorFactoryPtr descriptorFactory,
-        fsdk::IDescriptorExtractorPtr descriptorExtractor,
-        const fsdk::Image &image
-);
+#include "candidate_ranking.h"
+#include "command_line.h"
+#include "descriptor_cache.h"
+#include "engine_context.h"
+#include "face_cascade.h"
+#include "face_extraction.h"
+#include "netpbm.h"
 
 int main(int argc, char *argv[])
 {
@@ -19,137 +19,167 @@ int main(int argc, char *argv[])
     // Arguments:
     // 1) path to a first image,
     // 2) path to a second image,
-    // 3) matching threshold.
+    // 3) matching threshold,
+    // 4) optional descriptor cache directory.
+    // Options:
+    // --detect-max-side <pixels> - detect faces on a copy downscaled to the given larger side,
+    // --min-face <pixels> - skip faces with a smaller side,
+    // --min-quality <quality> - skip extraction of faces whose warp has a lower quality,
+    // --rank <none|score|area|center> - detect facial features of the best ranked faces first
+    // and stop at the first confident one,
+    // --candidates <count> - detect facial features of at most the given number of faces,
+    // --mtcnn - detect faces and landmarks with MTCNN instead of DPM and VGG feature detection.
     // If matching score is above the threshold, then both images
     // belong to the same person, otherwise they belong to different persons.
     // Images should be in ppm format.
-    if(argc != 4) {
-        std::cout << "Usage: "<<  argv[0] << " <image1> <image2> <threshold>\n"
+    int detectionMaxSide = 0;
+    int minFaceSize = 0;
+    float minQuality = 0.f;
+    RankingPolicy rankingPolicy = RankingNone;
+    int maxCandidates = 0;
+    bool mtcnn = false;
+    CommandLine commandLine;
+    commandLine.addDetectionMaxSide(detectionMaxSide);
+    commandLine.addOption("--min-face", minFaceSize);
+    commandLine.addOption("--min-quality", minQuality);
+    commandLine.addOption("--rank", [&](const char *name) { return parseRankingPolicy(name, rankingPolicy); });
+    commandLine.addOption("--candidates", maxCandidates);
+    commandLine.addFlag("--mtcnn", mtcnn);
+    const bool validOptions = commandLine.parse(argc, argv);
+    const std::vector<char*> &arguments = commandLine.getArguments();
+    if (!validOptions || minFaceSize < 0 || minQuality < 0.f || maxCandidates < 0 ||
+        (arguments.size() != 3 && arguments.size() != 4)) {
+        std::cout << "Usage: "<<  argv[0] << " <image1> <image2> <threshold> [cacheDir] [--detect-max-side <pixels>]\n"
+                "       [--min-face <pixels>] [--min-quality <quality>]"
+                " [--rank <none|score|area|center>] [--candidates <count>] [--mtcnn]\n"
                 " *image1 - path to first image\n"
                 " *image2 - path to second image\n"
                 " *threshold - similarity threshold in range (0..1]\n"
+                " *cacheDir - directory to keep extracted descriptors in\n"
+                << CommandLine::getDetectionMaxSideUsage() <<
+                " *min-face - smallest face side processed (default: any)\n"
+                " *min-quality - lowest warp quality extracted (default: no quality check)\n"
+                " *rank - order of the faces tried, taking the first confident one (default: none, the most confident face)\n"
+                " *candidates - number of faces tried (default: all)\n"
+                " *mtcnn - use MTCNN detection and landmarks instead of DPM and VGG feature detection\n"
                 << std::endl;
         return -1;
     }
-    char *firstImagePath = argv[1];
-    char *secondImagePath = argv[2];
-    float threshold = (float)atof(argv[3]);
+    char *firstImagePath = arguments[0];
+    char *secondImagePath = arguments[1];
+    float threshold = (float)atof(arguments[2]);
+    const char *cachePath = arguments.size() == 4 ? arguments[3] : nullptr;
 
     vlf::log::info("firstImagePath: \"%s\".", firstImagePath);
     vlf::log::info("secondImagePath: \"%s\".", secondImagePath);
     vlf::log::info("threshold: %1.3f.", threshold);
-
-    // Factory objects.
-    // These set up various SDK components.
+    if (cachePath)
+        vlf::log::info("cachePath: \"%s\".", cachePath);
+    if (detectionMaxSide > 0)
+        vlf::log::info("detection max side: %d.", detectionMaxSide);
+    vlf::log::info("min face: %d, min quality: %.3f.", minFaceSize, minQuality);
+    vlf::log::info("ranking: %s, candidates: %d.", getRankingPolicyName(rankingPolicy), maxCandidates);
+    vlf::log::info("pipeline: %s.", mtcnn ? "MTCNN" : "DPM + VGG");
+
+    // Engine context.
     // Note: SDK defines smart pointers for various object types named like IInterfacePtr.
     // Such objects implement reference counting to manage their life time. The smart pointers
     // will ensure that reference counting functions are called appropriately and the objects
     // are properly destroyed after use.
-    fsdk::ISettingsProviderPtr config;                    // Config root SDK object.
-    fsdk::IFaceEnginePtr faceEngine;                      // Root SDK object.
-    fsdk::IDetectorFactoryPtr detectorFactory;            // Face detector factory.
-    fsdk::IFeatureFactoryPtr featureFactory;              // Facial feature detector factory.
-    fsdk::IDescriptorFactoryPtr descriptorFactory;        // Facial descriptor factory.
-
-    // SDK components that we will use for facial recognition.
-    fsdk::IDetectorPtr faceDetector;                      // Face detector.
-    fsdk::IFeatureDetectorPtr featureDetector;            // Facial feature detector.
-    fsdk::IDescriptorExtractorPtr descriptorExtractor;    // Facial descriptor extractor.
-    fsdk::IDescriptorMatcherPtr descriptorMatcher;        // Descriptor matcher.
-
-    // Create config FaceEngine root SDK object.
-    config = fsdk::acquire(fsdk::createSettingsProvider("./data/faceengine.conf"));
-    if (!config) {
-        vlf::log::error("Failed to load face engine config instance.");
+    // MTCNN gives the landmarks with the detections, so the MTCNN pipeline
+    // needs no feature detector.
+    EngineContext::Settings settings;
+    settings.detectorType = mtcnn ? fsdk::ODT_MTCNN : fsdk::ODT_DPM;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
         return -1;
-    }
-
-    // Create FaceEngine root SDK object.
-    faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
-    if (!faceEngine) {
-        vlf::log::error("Failed to create face engine instance.");
-        return -1;
-    }
-    faceEngine->setSettingsProvider(config);
-    faceEngine->setDataDirectory("./data/");
-
-    // Create detector factory.
-    detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
-    if (!detectorFactory) {
-        vlf::log::error("Failed to create face detector factory instance.");
-        return -1;
-    }
-
-    // Create feature factory.
-    featureFactory = fsdk::acquire(faceEngine->createFeatureFactory());
-    if (!featureFactory) {
-        vlf::log::error("Failed to create face feature factory instance.");
-        return -1;
-    }
-
-    // Create descriptor factory.
-    descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
-    if(!descriptorFactory) {
-        vlf::log::error("Failed to create face descriptor factory instance.");
-        return -1;
-    }
 
-    // Create DPM detector.
-    faceDetector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_DPM));
-    if (!faceDetector) {
-        vlf::log::error("Failed to create face detector instance.");
-        return -1;
-    }
-
-    // Create VGG feature detector.
-    featureDetector = fsdk::acquire(featureFactory->createDetector(fsdk::FET_VGG));
-    if(!featureDetector) {
-        vlf::log::error("Failed to create face feature detector instance.");
-        return -1;
-    }
-
-    // Create CNN descriptor extractor.
-    descriptorExtractor = fsdk::acquire(descriptorFactory->createExtractor(fsdk::DT_CNN));
-    if (!descriptorExtractor) {
-        vlf::log::error("Failed to create face descriptor extractor instance.");
+    // SDK components that we will use for facial recognition.
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    fsdk::IDetectorPtr faceDetector = engineContext.getDetector();
+    fsdk::IFeatureDetectorPtr featureDetector(nullptr);
+    fsdk::IDescriptorExtractorPtr descriptorExtractor = engineContext.getExtractor();
+    fsdk::IDescriptorMatcherPtr descriptorMatcher = engineContext.getMatcher();
+    if (!featureFactory || !descriptorFactory || !faceDetector || !descriptorExtractor || !descriptorMatcher)
         return -1;
-    }
-
-    // Create CNN descriptor matcher.
-    descriptorMatcher = fsdk::acquire(descriptorFactory->createMatcher(fsdk::DT_CNN));
-    if (!descriptorMatcher) {
-        vlf::log::error("Failed to create face descriptor matcher instance.");
+    if (!mtcnn) {
+        featureDetector = engineContext.getFeatureDetector();
+        if (!featureDetector)
+            return -1;
+    }
+
+    // Warper and quality estimator are only needed for the quality check.
+    fsdk::IWarperPtr warper(nullptr);
+    fsdk::IQualityEstimatorPtr qualityEstimator(nullptr);
+    if (minQuality > 0.f) {
+        warper = engineContext.getWarper();
+        qualityEstimator = engineContext.getQualityEstimator();
+        if (!warper || !qualityEstimator)
+            return -1;
+    }
+    engineContext.logTimings();
+
+    // Rejection cascade.
+    // Small faces are dropped before their feature set is detected, and with
+    // a quality threshold the best face is warped and checked before extraction.
+    FaceCascade::Settings cascadeSettings;
+    cascadeSettings.minFaceSize = minFaceSize;
+    cascadeSettings.minQuality = minQuality;
+    FaceCascade cascade(warper, qualityEstimator, cascadeSettings);
+
+    // Descriptor cache.
+    // Descriptors are stored under a hash of the image file, the model version,
+    // the detector type, the detection max side and the settings choosing the
+    // extracted face. A cached image is neither decoded nor processed.
+    DescriptorCache::FaceSelection faceSelection;
+    faceSelection.rankingPolicy = rankingPolicy;
+    faceSelection.maxCandidates = maxCandidates;
+    faceSelection.minFaceSize = minFaceSize;
+    faceSelection.minQuality = minQuality;
+    DescriptorCache descriptorCache;
+    if (cachePath && !descriptorCache.open(
+            cachePath, engineContext.getDescriptorModel(), settings.detectorType, detectionMaxSide, faceSelection))
         return -1;
-    }
 
-    // Load images.
-    fsdk::Image image1, image2;
-    if (!image1.loadFromPPM(firstImagePath)) {
-        vlf::log::error("Failed to load image: \"%s\".", firstImagePath);
-        return -1;
-    }
-    if (!image2.loadFromPPM(secondImagePath)) {
-        vlf::log::error("Failed to load image: \"%s\".", secondImagePath);
-        return -1;
-    }
+    // Face extraction.
+    // Without a feature detector faces are detected with MTCNN and their
+    // feature sets are made from its landmarks. Feature sets must be at least
+    // this confident.
+    FaceExtractionSettings extractionSettings;
+    extractionSettings.confidenceThreshold = 0.25f;
+    extractionSettings.detectionMaxSide = detectionMaxSide;
+    extractionSettings.rankingPolicy = rankingPolicy;
+    extractionSettings.maxCandidates = maxCandidates;
+    extractionSettings.verbose = true;
+
+    // Load an image and extract its face descriptor.
+    auto loadAndExtract = [&](const char *imagePath) -> fsdk::IDescriptorPtr {
+        fsdk::Image image;
+        if (!loadNetpbm(imagePath, fsdk::Format::R8G8B8, image)) {
+            vlf::log::error("Failed to load image: \"%s\".", imagePath);
+            return nullptr;
+        }
+        return extractBestFace(
+                faceDetector,
+                featureFactory,
+                featureDetector,
+                descriptorFactory,
+                descriptorExtractor,
+                &cascade,
+                image,
+                extractionSettings
+        );
+    };
 
     // Extract face descriptors.
-    fsdk::IDescriptorPtr descriptor1 = extractDescriptor(
-            faceDetector,
-            featureFactory,
-            featureDetector,
-            descriptorFactory,
-            descriptorExtractor,
-            image1
-    );
-    fsdk::IDescriptorPtr descriptor2 = extractDescriptor(
-            faceDetector,
-            featureFactory,
-            featureDetector,
-            descriptorFactory,
-            descriptorExtractor,
-            image2
-    );
+    fsdk::IDescriptorPtr descriptor1 = descriptorCache.getOrExtract(firstImagePath, descriptorFactory,
+            [&]() { return loadAndExtract(firstImagePath); });
+    fsdk::IDescriptorPtr descriptor2 = descriptorCache.getOrExtract(secondImagePath, descriptorFactory,
+            [&]() { return loadAndExtract(secondImagePath); });
+    if (descriptorCache.isOpen())
+        descriptorCache.logStats();
+    cascade.logStats();
     if (!descriptor1 || !descriptor2) {
         return -1;
     }
@@ -179,126 +209,3 @@ int main(int argc, char *argv[])
 
    return 0;
 }
-
-fsdk::IDescriptorPtr extractDescriptor(
-        fsdk::IDetectorPtr faceDetector,
-        fsdk::IFeatureFactoryPtr featureFactory,
-        fsdk::IFeatureDetectorPtr featureDetector,
-        fsdk::IDescriptorFactoryPtr descriptorFactory,
-        fsdk::IDescriptorExtractorPtr descriptorExtractor,
-        const fsdk::Image &image
-) {
-    // Facial feature detection confidence threshold.
-    const float confidenceThreshold = 0.25f;
-
-    if (!image) {
-        vlf::log::error("Request image is invalid.");
-        return nullptr;
-    }
-
-    // Create color and grayscale images.
-    fsdk::Image imageBGR;
-    fsdk::Image imageR;
-    image.convert(imageBGR, fsdk::Format::B8G8R8);
-    image.convert(imageR, fsdk::Format::R8);
-    if (!imageBGR) {
-        vlf::log::error("Conversion to BGR has failed.");
-        return nullptr;
-    }
-    if (!imageR) {
-        vlf::log::error("Conversion to grayscale has failed.");
-        return nullptr;
-    }
-
-    // Stage 1. Detect a face.
-    vlf::log::info("Detecting faces.");
-
-    // Detect no more than 10 faces in the image.
-    enum { MaxDetections = 10 };
-    fsdk::Detection detections[MaxDetections];
-    int detectionsCount(MaxDetections);
-
-    // Detect faces in the image.
-    fsdk::ResultValue<fsdk::FSDKError, int> detectorResult = faceDetector->detect(
-            imageR,
-            imageR.getRect(),
-            &detections[0],
-            detectionsCount
-    );
-    if (detectorResult.isError()) {
-        vlf::log::error("Failed to detect face detection. Reason: %s.", detectorResult.what());
-        return nullptr;
-    }
-    detectionsCount = detectorResult.getValue();
-
-    vlf::log::info("Found %d face(s).", detectionsCount);
-
-    // Stage 2. Detect facial features set and compute a confidence score.
-    vlf::log::info("Detecting facial features set.");
-
-    fsdk::IFeatureSetPtr bestFeatureSet(nullptr);
-    int bestDetectionIndex(0);
-
-    // Create feature set.
-    fsdk::IFeatureSetPtr featureSet = fsdk::acquire(featureFactory->createFeatureSet());
-    if (!featureSet) {
-        vlf::log::error("Failed to create face feature set instance.");
-        return nullptr;
-    }
-
-    // Loop through all the faces and find one with the best score.
-    for (int detectionIndex = 0; detectionIndex < detectionsCount; ++detectionIndex) {
-        fsdk::Detection &detection = detections[detectionIndex];
-        vlf::log::info("Detecting facial features (%d/%d).", (detectionIndex + 1), detectionsCount);
-
-        // Detect feature set.
-        fsdk::Result<fsdk::FSDKError> featureSetResult = featureDetector->detect(
-                imageR,
-                detection,
-                featureSet
-        );
-        if (featureSetResult.isError()) {
-            vlf::log::error("Failed to detect feature set. Reason: %s.", featureSetResult.what());
-            return nullptr;
-        }
-
-        // Choose the best feature set.
-        if (!bestFeatureSet || featureSet->getConfidence() > bestFeatureSet->getConfidence()) {
-            bestFeatureSet = featureSet;
-            bestDetectionIndex = detectionIndex;
-        }
-    }
-
-    // If not detect facial features or feature confidence score is too low, abort.
-    if (!bestFeatureSet || bestFeatureSet->getConfidence() < confidenceThreshold) {
-        vlf::log::info("Face detection succeeded, but no faces with good confidence found.");
-        return nullptr;
-    }
-    vlf::log::info("Best face confidence is %0.3f.", bestFeatureSet->getConfidence());
-    fsdk::Detection bestDetection = detections[bestDetectionIndex];
-
-    // Stage 3. Create CNN face descriptor.
-    vlf::log::info("Extracting descriptor.");
-
-    // Create CNN face descriptor.
-    fsdk::IDescriptorPtr descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
-    if (!descriptor) {
-        vlf::log::error("Failed to create face descrtiptor instance.");
-        return nullptr;
-    }
-
-    // Extract face descriptor.
-    // This is typically the most time-consuming task.
-    fsdk::Result<fsdk::FSDKError> descriptorExtractorResult = descriptorExtractor->extract(
-            imageBGR,
-            bestDetection,
-            bestFeatureSet,
-            descriptor
-    );
-    if(descriptorExtractorResult.isError()) {
-        vlf::log::error("Failed to extract face descriptor. Reason: %s.", descriptorExtractorResult.what());
-        return nullptr;
-    }
-
-    return descriptor;
-}
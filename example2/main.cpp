@@ -2,6 +2,13 @@
 #include <vlf/Log.h>
 
 #include <iostream>
+#include <vector>
+
+#include "command_line.h"
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "face_cascade.h"
+#include "netpbm.h"
 
 int main(int argc, char *argv[])
 {
@@ -11,115 +18,71 @@ int main(int argc, char *argv[])
     // Parse command line arguments.
     // Arguments:
     // 1) path to a first image.
+    // Options:
+    // --detect-max-side <pixels> - detect faces on a copy downscaled to the given larger side,
+    // --min-face <pixels> - skip faces with a smaller side,
+    // --min-quality <quality> - skip attribute estimation of warps with a lower quality.
     // Image should be in ppm format.
-    if (argc != 2) {
-        std::cout << "USAGE: " << argv[0] << " <image>\n"
+    int detectionMaxSide = 0;
+    int minFaceSize = 0;
+    float minQuality = 0.f;
+    CommandLine commandLine;
+    commandLine.addDetectionMaxSide(detectionMaxSide);
+    commandLine.addOption("--min-face", minFaceSize);
+    commandLine.addOption("--min-quality", minQuality);
+    const bool validOptions = commandLine.parse(argc, argv);
+    const std::vector<char*> &arguments = commandLine.getArguments();
+    if (!validOptions || minFaceSize < 0 || minQuality < 0.f || arguments.size() != 1) {
+        std::cout << "USAGE: " << argv[0] << " <image> [--detect-max-side <pixels>] [--min-face <pixels>]"
+                " [--min-quality <quality>]\n"
                 " *image - path to image\n"
+                << CommandLine::getDetectionMaxSideUsage() <<
+                " *min-face - smallest face side processed (default: any)\n"
+                " *min-quality - lowest warp quality passed to attribute estimation (default: any)\n"
                 << std::endl;
         return -1;
     }
-    char *imagePath = argv[1];
+    char *imagePath = arguments[0];
 
     vlf::log::info("imagePath: \"%s\".", imagePath);
-
-    // Create config FaceEngine root SDK object.
-    fsdk::ISettingsProviderPtr config;
-    config = fsdk::acquire(fsdk::createSettingsProvider("./data/faceengine.conf"));
-    if (!config) {
-        vlf::log::error("Failed to load face engine config instance.");
-        return -1;
-    }
-
-    // Create FaceEngine root SDK object.
-    fsdk::IFaceEnginePtr faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
-    if (!faceEngine) {
-        vlf::log::error("Failed to create face engine instance.");
-        return -1;
-    }
-    faceEngine->setSettingsProvider(config);
-    faceEngine->setDataDirectory("./data/");
-
-    // Create detector factory.
-    fsdk::IDetectorFactoryPtr detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
-    if (!detectorFactory) {
-        vlf::log::error("Failed to create face detector factory instance.");
-        return -1;
-    }
-    
-    // Create DPM detector.
-    fsdk::IDetectorPtr detector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_DPM));
-    if (!detector) {
-        vlf::log::error("Failed to create face detector instance.");
-        return -1;
-    }
-
-    // Create feature factory.
-    fsdk::IFeatureFactoryPtr featureFactory = fsdk::acquire(faceEngine->createFeatureFactory());
-    if (!featureFactory) {
-        vlf::log::error("Failed to create face feature factory instance.");
-        return -1;
-    }
-    
-    // Create VGG feature detector.
-    fsdk::IFeatureDetectorPtr featureDetector = fsdk::acquire(featureFactory->createDetector(fsdk::FET_VGG));
-    if (!featureDetector) {
-        vlf::log::error("Failed to create face featrure detector instance.");
-        return -1;
-    }
-
-    // Create descriptor factory.
-    fsdk::IDescriptorFactoryPtr descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
-    if (!descriptorFactory) {
-        vlf::log::error("Failed to create face descriptor factory instance.");
-        return -1;
-    }
-    
-    // Create CNN warper.
-    fsdk::IWarperPtr warper = fsdk::acquire(descriptorFactory->createWarper(fsdk::DT_CNN));
-    if (!warper) {
-        vlf::log::error("Failed to create face warper instance.");
-        return -1;
-    }
-
-    // Create estimator factory.
-    fsdk::IEstimatorFactoryPtr estimatorFactory = fsdk::acquire(faceEngine->createEstimatorFactory());
-    if (!estimatorFactory) {
-        vlf::log::error("Failed to create face estimator factory instance.");
-        return -1;
-    }
-
-    // Create quality estimator.
-    fsdk::IQualityEstimatorPtr qualityEstimator =
-            fsdk::acquire(static_cast<fsdk::IQualityEstimator*>(
-                    estimatorFactory->createEstimator(fsdk::ET_QUALITY)
-            ));
-    if (!qualityEstimator) {
-        vlf::log::error("Failed to create face quality estimator instance.");
-        return -1;
-    }
-    
-    // Create complex estimator.
-    fsdk::IComplexEstimatorPtr complexEstimator =
-            fsdk::acquire(static_cast<fsdk::IComplexEstimator*>(
-                    estimatorFactory->createEstimator(fsdk::ET_COMPLEX)
-            ));
-    if (!complexEstimator) {
-        vlf::log::error("Failed to create face complex estimator instance.");
-        return -1;
-    }
-
-    // Load image.
+    if (detectionMaxSide > 0)
+        vlf::log::info("detection max side: %d.", detectionMaxSide);
+    vlf::log::info("min face: %d, min quality: %.3f.", minFaceSize, minQuality);
+
+    // Create engine context.
+    EngineContext::Settings settings;
+    settings.detectorType = fsdk::ODT_DPM;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
+        return -1;
+
+    // Create SDK components.
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IFeatureDetectorPtr featureDetector = engineContext.getFeatureDetector();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    fsdk::IQualityEstimatorPtr qualityEstimator = engineContext.getQualityEstimator();
+    fsdk::IComplexEstimatorPtr complexEstimator = engineContext.getComplexEstimator();
+    if (!detector || !featureFactory || !featureDetector ||
+        !warper || !qualityEstimator || !complexEstimator)
+        return -1;
+    engineContext.logTimings();
+
+    // Rejection cascade.
+    // Small faces are dropped before their feature set is detected, faces with
+    // a weak feature set before they are warped and warps of low quality
+    // before attributes are estimated.
+    FaceCascade::Settings cascadeSettings;
+    cascadeSettings.minFaceSize = minFaceSize;
+    cascadeSettings.minQuality = minQuality;
+    FaceCascade cascade(warper, qualityEstimator, cascadeSettings);
+
+    // Load image and its grayscale version.
+    // Both are written in one pass over the mapped file.
     fsdk::Image image;
-    if (!image.loadFromPPM(imagePath)) {
-        vlf::log::error("Failed to load image: \"%s\".", imagePath);
-        return -1;
-    }
-
-    // Create grayscale image.
     fsdk::Image imageR;
-    image.convert(imageR, fsdk::Format::R8);
-    if (!imageR) {
-        vlf::log::error("Conversion to grayscale has failed.");
+    if (!loadNetpbm(imagePath, &image, nullptr, &imageR)) {
+        vlf::log::error("Failed to load image: \"%s\".", imagePath);
         return -1;
     }
 
@@ -128,21 +91,19 @@ int main(int argc, char *argv[])
     // Detect no more than 10 faces in the image.
     enum { MaxDetections = 10 };
 	fsdk::Detection detections[MaxDetections];
-	int detectionsCount(MaxDetections);
 
     // Detect faces in the image.
-    fsdk::ResultValue<fsdk::FSDKError, int> detectorResult =
-            detector->detect(
-                    imageR,
-                    imageR.getRect(),
-                    &detections[0],
-                    detectionsCount
-            );
-    if (detectorResult.isError()) {
-        vlf::log::error("Failed to detect face detection. Reason: %s.", detectorResult.what());
+    // Detections found on a downscaled copy are mapped back to the image.
+    const int detectionsCount = detectFaces(
+            detector,
+            imageR,
+            detectionMaxSide,
+            &detections[0],
+            nullptr,
+            MaxDetections
+    );
+    if (detectionsCount < 0)
         return -1;
-    }
-    detectionsCount = detectorResult.getValue();
     vlf::log::info("Found %d face(s).", detectionsCount);
 
     // Create feature set.
@@ -160,48 +121,60 @@ int main(int argc, char *argv[])
 	            << "\nRect: x=" << detection.rect.x << " y=" << detection.rect.y
                 <<" w=" << detection.rect.width << " h=" << detection.rect.height << std::endl;
 
-        // Detect feature set.
-        fsdk::Result<fsdk::FSDKError> featureDetectorResult =
-                featureDetector->detect(imageR, detection, featureSet);
-        if (featureDetectorResult.isError()) {
-            vlf::log::error("Failed to detect feature set. Reason: %s.", featureDetectorResult.what());
-            return -1;
+        // Check face size.
+        if (!cascade.checkDetection(detection)) {
+            vlf::log::info("Face detection succeeded, but the face is too small.");
+            continue;
         }
 
-        // Estimate confidence score of feature set.
-        if (featureSet->getConfidence() < confidenceThreshold) {
+        // Detect feature set and estimate its confidence score.
+        bool featureSetPassed = false;
+        const bool featureSetDetected = cascade.runStage(FaceCascade::StageLandmarks, [&](bool &passed) {
+            fsdk::Result<fsdk::FSDKError> featureDetectorResult =
+                    featureDetector->detect(imageR, detection, featureSet);
+            if (featureDetectorResult.isError()) {
+                vlf::log::error("Failed to detect feature set. Reason: %s.", featureDetectorResult.what());
+                return false;
+            }
+            passed = featureSetPassed = featureSet->getConfidence() >= confidenceThreshold;
+            return true;
+        });
+        if (!featureSetDetected)
+            return -1;
+        if (!featureSetPassed) {
             vlf::log::info("Face detection succeeded, but confidence score of feature set is small.");
             continue;
         }
 
-        // Get warped face from detection.
+        // Get warped face from detection and its quality estimate.
         fsdk::Image warp;
-        fsdk::Result<fsdk::FSDKError> warperResult = warper->warp(image, detection, featureSet, warp);
-        if (warperResult.isError()) {
-            vlf::log::error("Failed to create warped face. Reason: %s.", warperResult.what());
+        float qualityOut;
+        bool qualityPassed;
+        if (!cascade.checkQuality(image, detection, featureSet, warp, qualityOut, qualityPassed))
             return -1;
-        }
-        
+
         // Save warped face.
         warp.saveAsPPM(("warp_" + std::to_string(detectionIndex) + ".ppm").c_str());
-        
-        // Get quality estimate.
-        float qualityOut;
-        fsdk::Result<fsdk::FSDKError> qualityEstimatorResult = qualityEstimator->estimate(warp, &qualityOut);
-        if(qualityEstimatorResult.isError()) {
-            vlf::log::error("Failed to get quality estimate. Reason: %s.", qualityEstimatorResult.what());
-            return -1;
-        }
         std::cout << "Quality estimated\nQuality: " << qualityOut << std::endl;
+        if (!qualityPassed) {
+            vlf::log::info("Warped face quality is too low for attribute estimation.");
+            continue;
+        }
 
         // Get complex estimate.
         fsdk::ComplexEstimation complexEstimationOut;
-        fsdk::Result<fsdk::FSDKError> complexEstimatorResult =
-                complexEstimator->estimate(warp, complexEstimationOut);
-        if(complexEstimatorResult.isError()) {
-            vlf::log::error("Failed to get complex estimate. Reason: %s.", complexEstimatorResult.what());
+        const bool complexEstimated = cascade.runStage(FaceCascade::StageAttributes, [&](bool &passed) {
+            fsdk::Result<fsdk::FSDKError> complexEstimatorResult =
+                    complexEstimator->estimate(warp, complexEstimationOut);
+            if(complexEstimatorResult.isError()) {
+                vlf::log::error("Failed to get complex estimate. Reason: %s.", complexEstimatorResult.what());
+                return false;
+            }
+            passed = true;
+            return true;
+        });
+        if (!complexEstimated)
             return -1;
-        }
         std::cout << "Complex attributes estimated\n"
                 "Gender: " << complexEstimationOut.gender << " (1 - man, 0 - woman)\n"
                 "Wear glasses: " << complexEstimationOut.wearGlasses
@@ -211,5 +184,7 @@ int main(int argc, char *argv[])
                 << std::endl;
     }
 
+    cascade.logStats();
+
     return 0;
 }
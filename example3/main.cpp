@@ -1,7 +1,22 @@
 #include <FaceEngine.h>
 #include <vlf/Log.h>
 
+#include <future>
 #include <iostream>
+#include <vector>
+
+#include "command_line.h"
+#include "detection_scaling.h"
+#include "crowd_detector.h"
+#include "engine_context.h"
+#include "estimation_batcher.h"
+#include "face_cascade.h"
+#include "netpbm.h"
+#include "tiled_detector.h"
+#include "timer.h"
+
+// Print the estimated attributes of a face.
+void printComplexEstimation(const fsdk::ComplexEstimation &complexEstimation);
 
 int main(int argc, char *argv[])
 {
@@ -11,132 +26,194 @@ int main(int argc, char *argv[])
     // Parse command line arguments.
     // Arguments:
     // 1) path to a first image.
+    // Options:
+    // --detect-max-side <pixels> - detect faces on a copy downscaled to the given larger side,
+    // --tile-size <pixels> - detect faces on overlapping tiles in parallel, for very large images,
+    // --crowd - detect any number of faces,
+    // --min-face <pixels> - skip faces with a smaller side,
+    // --top <count> - in crowd mode process only the given number of faces with the largest score x area,
+    // --min-eye-distance <pixels> - skip faces with closer eye points,
+    // --max-yaw <degrees> - skip faces turned further aside,
+    // --min-quality <quality> - skip attribute estimation of warps with a lower quality,
+    // --batch <size> - estimate the warps of all faces in batches of the given size,
+    // --max-wait <ms> - longest wait for a partial batch to fill.
     // Image should be in ppm format.
-    if (argc != 2) {
-        std::cout << "USAGE: " << argv[0] << " <image>\n"
+    int detectionMaxSide = 0;
+    int tileSize = 0;
+    bool crowd = false;
+    int minFaceSize = 0;
+    int topCount = 0;
+    float minEyeDistance = 0.f;
+    float maxYaw = 0.f;
+    float minQuality = 0.f;
+    int batchSize = 0;
+    int maxWaitMs = 20;
+    CommandLine commandLine;
+    commandLine.addDetectionMaxSide(detectionMaxSide);
+    commandLine.addOption("--tile-size", tileSize);
+    commandLine.addFlag("--crowd", crowd);
+    commandLine.addOption("--min-face", minFaceSize);
+    commandLine.addOption("--top", topCount);
+    commandLine.addOption("--min-eye-distance", minEyeDistance);
+    commandLine.addOption("--max-yaw", maxYaw);
+    commandLine.addOption("--min-quality", minQuality);
+    commandLine.addOption("--batch", batchSize);
+    commandLine.addOption("--max-wait", maxWaitMs);
+    const bool validOptions = commandLine.parse(argc, argv);
+    const std::vector<char*> &arguments = commandLine.getArguments();
+    if (!validOptions || tileSize < 0 || minFaceSize < 0 || topCount < 0 ||
+        minEyeDistance < 0.f || maxYaw < 0.f || minQuality < 0.f || batchSize < 0 || maxWaitMs < 0 ||
+        (tileSize > 0 && (detectionMaxSide > 0 || crowd)) || arguments.size() != 1) {
+        std::cout << "USAGE: " << argv[0] << " <image> [--detect-max-side <pixels> | --tile-size <pixels>]"
+                " [--crowd [--top <count>]] [--min-face <pixels>]\n"
+                "       [--min-eye-distance <pixels>] [--max-yaw <degrees>] [--min-quality <quality>]\n"
+                "       [--batch <size> [--max-wait <ms>]]\n"
                 " *image - path to image\n"
+                << CommandLine::getDetectionMaxSideUsage() <<
+                " *tile-size - side of the detection tiles (default: one detector call)\n"
+                " *crowd - grow detection buffers instead of stopping at 10 faces\n"
+                " *top - number of faces processed in crowd mode (default: all)\n"
+                " *min-face - smallest face side processed (default: any)\n"
+                " *min-eye-distance - smallest distance between the eye points processed (default: any)\n"
+                " *max-yaw - largest rough yaw processed (default: any)\n"
+                " *min-quality - lowest warp quality passed to attribute estimation (default: any)\n"
+                " *batch - number of warps estimated in one sweep (default: one face at a time)\n"
+                " *max-wait - longest wait in milliseconds for a partial batch (default: 20)\n"
                 << std::endl;
         return -1;
     }
-    char *imagePath = argv[1];
+    char *imagePath = arguments[0];
 
     vlf::log::info("imagePath: \"%s\".", imagePath);
+    if (detectionMaxSide > 0)
+        vlf::log::info("detection max side: %d.", detectionMaxSide);
+    if (tileSize > 0)
+        vlf::log::info("tile size: %d.", tileSize);
+    if (crowd)
+        vlf::log::info("crowd mode, top: %d.", topCount);
+    vlf::log::info("min face: %d, min eye distance: %.1f, max yaw: %.1f, min quality: %.3f.",
+            minFaceSize, minEyeDistance, maxYaw, minQuality);
+    if (batchSize > 0)
+        vlf::log::info("batch size: %d, max wait: %d ms.", batchSize, maxWaitMs);
 
-    // Create config FaceEngine root SDK object.
-    fsdk::ISettingsProviderPtr config;
-    config = fsdk::acquire(fsdk::createSettingsProvider("./data/faceengine.conf"));
-    if (!config) {
-        vlf::log::error("Failed to load face engine config instance.");
+    // Create engine context.
+    EngineContext::Settings settings;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
         return -1;
-    }
 
-    // Create FaceEngine root SDK object.
-    fsdk::IFaceEnginePtr faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
-    if (!faceEngine) {
-        vlf::log::error("Failed to create face engine instance.");
+    // Create SDK components.
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    fsdk::IQualityEstimatorPtr qualityEstimator = engineContext.getQualityEstimator();
+    fsdk::IComplexEstimatorPtr complexEstimator = engineContext.getComplexEstimator();
+    if (!detector || !featureFactory || !warper || !qualityEstimator || !complexEstimator)
         return -1;
-    }
-    faceEngine->setSettingsProvider(config);
-    faceEngine->setDataDirectory("./data/");
-
-    // Create detector factory.
-    fsdk::IDetectorFactoryPtr detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
-    if (!detectorFactory) {
-        vlf::log::error("Failed to create face detector factory instance.");
-        return -1;
-    }
-
-    // Create MTCNN detector.
-    fsdk::IDetectorPtr detector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_MTCNN));
-    if (!detector) {
-        vlf::log::error("Failed to create face detector instance.");
-        return -1;
-    }
-
-    // Create feature factory.
-    fsdk::IFeatureFactoryPtr featureFactory = fsdk::acquire(faceEngine->createFeatureFactory());
-    if (!featureFactory) {
-        vlf::log::error("Failed to create face feature factory instance.");
-        return -1;
-    }
+    engineContext.logTimings();
 
-    // Create descriptor factory.
-    fsdk::IDescriptorFactoryPtr descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
-    if (!descriptorFactory) {
-        vlf::log::error("Failed to create face descriptor factory instance.");
-        return -1;
-    }
-
-    // Create CNN warper.
-    fsdk::IWarperPtr warper = fsdk::acquire(descriptorFactory->createWarper(fsdk::DT_CNN));
-    if (!warper) {
-        vlf::log::error("Failed to create face warper instance.");
-        return -1;
+    // Tiled detector.
+    // Every thread owns an MTCNN detector and works on its share of the tiles.
+    TiledDetector tiledDetector;
+    if (tileSize > 0) {
+        TiledDetector::Settings tiledSettings;
+        tiledSettings.tileSize = tileSize;
+        if (!tiledDetector.init(engineContext.getFaceEngine(), tiledSettings))
+            return -1;
     }
 
-    // Create estimator factory.
-    fsdk::IEstimatorFactoryPtr estimatorFactory = fsdk::acquire(faceEngine->createEstimatorFactory());
-    if (!estimatorFactory) {
-        vlf::log::error("Failed to create face estimator factory instance.");
-        return -1;
-    }
+    // Crowd detector.
+    // Its buffers grow until every face fits. Small and weak faces are dropped
+    // before any feature set or warp is made for them.
+    CrowdDetector::Settings crowdSettings;
+    crowdSettings.minFaceSize = minFaceSize;
+    crowdSettings.minScore = confidenceThreshold;
+    crowdSettings.topCount = topCount;
+    crowdSettings.detectionMaxSide = detectionMaxSide;
+    CrowdDetector crowdDetector(detector, crowdSettings);
 
-    // Create complex estimator.
-    fsdk::IComplexEstimatorPtr complexEstimator =
-            fsdk::acquire(static_cast<fsdk::IComplexEstimator*>(
-                    estimatorFactory->createEstimator(fsdk::ET_COMPLEX)
-            ));
-    if (!complexEstimator) {
-        vlf::log::error("Failed to create face complex estimator instance.");
-        return -1;
-    }
+    // Rejection cascade.
+    // Every face passes the cheap checks on its detection and landmarks before
+    // it is warped, and the warp quality before attributes are estimated.
+    FaceCascade::Settings cascadeSettings;
+    cascadeSettings.minScore = confidenceThreshold;
+    cascadeSettings.minFaceSize = minFaceSize;
+    cascadeSettings.minEyeDistance = minEyeDistance;
+    cascadeSettings.maxYaw = maxYaw;
+    cascadeSettings.minQuality = minQuality;
+    FaceCascade cascade(warper, qualityEstimator, cascadeSettings);
 
-    // Create quality estimator.
-    fsdk::IQualityEstimatorPtr qualityEstimator =
-            fsdk::acquire(static_cast<fsdk::IQualityEstimator*>(
-                    estimatorFactory->createEstimator(fsdk::ET_QUALITY)
-            ));
-    if (!qualityEstimator) {
-        vlf::log::error("Failed to create face quality estimator instance.");
-        return -1;
+    // Estimation batcher.
+    // In batch mode the warps of all faces are queued, and the quality and
+    // complex estimators each run over a whole batch in one sweep.
+    EstimationBatcher batcher;
+    if (batchSize > 0) {
+        EstimationBatcher::Settings batchSettings;
+        batchSettings.batchSize = batchSize;
+        batchSettings.maxWaitMs = maxWaitMs;
+        batchSettings.minQuality = minQuality;
+        if (!batcher.start(qualityEstimator, complexEstimator, batchSettings))
+            return -1;
     }
 
     // Load image.
     fsdk::Image image;
-    if (!image.loadFromPPM(imagePath)) {
+    if (!loadNetpbm(imagePath, fsdk::Format::R8G8B8, image)) {
         vlf::log::error("Failed to load image: \"%s\".", imagePath);
         return -1;
     }
 
     vlf::log::info("Detecting faces.");
 
-    // Detect no more than 10 faces in the image.
-    enum { MaxDetections = 10 };
+    // Detect no more than 10 faces in the image, or 256 in a tiled one.
+    // The crowd detector grows the buffers itself.
+    const int maxDetections = tileSize > 0 ? 256 : 10;
 
     // Data used for MTCNN detection.
-	fsdk::Detection detections[MaxDetections];
-	int detectionsCount(MaxDetections);
-	fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
+    std::vector<fsdk::Detection> detections(maxDetections);
+    std::vector<fsdk::IMTCNNDetector::Landmarks> landmarks(maxDetections);
 
     // Detect faces in the image.
-    fsdk::ResultValue<fsdk::FSDKError, int> detectorResult =
-            detector.as<fsdk::IMTCNNDetector>()->detect(
-                    image,
-                    image.getRect(),
-                    &detections[0],
-                    &landmarks[0],
-                    detectionsCount
-            );
-    if (detectorResult.isError()) {
-        vlf::log::error("Failed tor create face detection. Reason: %s.", detectorResult.what());
+    // Detections and landmarks found on a downscaled copy are mapped back to the
+    // image; tiled detection merges faces seen by neighbouring tiles.
+    Timer detectionTimer;
+    int detectionsCount = 0;
+    if (crowd) {
+        detectionsCount = crowdDetector.detect(image, detections, landmarks);
+    } else if (tileSize > 0) {
+        detectionsCount = tiledDetector.detect(image, &detections[0], &landmarks[0], maxDetections);
+    } else {
+        detectionsCount = detectFaces(
+                detector,
+                image,
+                detectionMaxSide,
+                &detections[0],
+                &landmarks[0],
+                maxDetections
+        );
+    }
+    if (detectionsCount < 0)
         return -1;
+    vlf::log::info("Found %d face(s) in %.2f ms.", detectionsCount, detectionTimer.elapsedMs());
+    if (tileSize > 0)
+        vlf::log::info("Image split into %d tile(s) on %d thread(s).",
+                tiledDetector.getTilesCount(), tiledDetector.getThreadsCount());
+    if (crowd) {
+        const CrowdDetector::Stats &crowdStats = crowdDetector.getStats();
+        vlf::log::info("Detected %d face(s), dropped %d small, %d weak, %d over top; %d retries, capacity %d.",
+                crowdStats.detected, crowdStats.tooSmall, crowdStats.lowScore, crowdStats.overTop,
+                crowdStats.retries, crowdDetector.getCapacity());
+        if (crowdStats.truncated)
+            vlf::log::info("Detection capacity is exhausted; some faces may be missing.");
     }
-    detectionsCount = detectorResult.getValue();
-    vlf::log::info("Found %d face(s).", detectionsCount);
 
     // Feature set.
     fsdk::IFeatureSetPtr featureSet(nullptr);
 
+    // Faces queued for batched estimation.
+    std::vector<int> batchedIndices;
+    std::vector<std::future<EstimationBatcher::Estimation>> batchedEstimations;
+
     // Loop through all the faces.
     for (int detectionIndex = 0; detectionIndex < detectionsCount; ++detectionIndex) {
 	    fsdk::Detection &detection = detections[detectionIndex];
@@ -145,9 +222,15 @@ int main(int argc, char *argv[])
 	            << "Rect: x=" << detection.rect.x << " y=" << detection.rect.y
                 << " w=" << detection.rect.width << " h=" << detection.rect.height << std::endl;
 
-        // Estimate confidence score of face detection.
-        if (detection.score < confidenceThreshold) {
-            vlf::log::info("Face detection succeeded, but confidence score of detection is small.");
+        // Check confidence score of face detection and face size.
+        if (!cascade.checkDetection(detection)) {
+            vlf::log::info("Face detection succeeded, but the face is too weak or too small.");
+            continue;
+        }
+
+        // Check the landmark geometry: eye distance and rough yaw.
+        if (!cascade.checkLandmarks(landmarks[detectionIndex])) {
+            vlf::log::info("Face detection succeeded, but the face is too small or turned aside.");
             continue;
         }
 
@@ -158,42 +241,85 @@ int main(int argc, char *argv[])
             return -1;
         }
 
-        // Get warped face from detection.
+        // In batch mode only warp the face here and queue the warp.
+        if (batchSize > 0) {
+            fsdk::Image warp;
+            fsdk::Result<fsdk::FSDKError> warperResult = warper->warp(image, detection, featureSet, warp);
+            if (warperResult.isError()) {
+                vlf::log::error("Failed to create warped face. Reason: %s.", warperResult.what());
+                return -1;
+            }
+            warp.saveAsPPM(("warp_" + std::to_string(detectionIndex) + ".ppm").c_str());
+            batchedIndices.push_back(detectionIndex);
+            batchedEstimations.push_back(batcher.submit(warp));
+            continue;
+        }
+
+        // Get warped face from detection and its quality estimate.
         fsdk::Image warp;
-        fsdk::Result<fsdk::FSDKError> warperResult = warper->warp(image, detection, featureSet, warp);
-        if (warperResult.isError()) {
-            vlf::log::error("Failed to create warped face. Reason: %s.", warperResult.what());
+        float qualityOut;
+        bool qualityPassed;
+        if (!cascade.checkQuality(image, detection, featureSet, warp, qualityOut, qualityPassed))
             return -1;
-        }
 
         // Save warped face.
         warp.saveAsPPM(("warp_" + std::to_string(detectionIndex) + ".ppm").c_str());
-        
-        // Get quality estimate.
-        float qualityOut;
-        fsdk::Result<fsdk::FSDKError> qualityEstimatorResult = qualityEstimator->estimate(warp, &qualityOut);
-        if(qualityEstimatorResult.isError()) {
-            vlf::log::error("Failed to create quality estimating. Reason: %s.", qualityEstimatorResult.what());
-            return -1;
-        }
         std::cout << "Quality estimated\nQuality: " << qualityOut << std::endl;
+        if (!qualityPassed) {
+            vlf::log::info("Warped face quality is too low for attribute estimation.");
+            continue;
+        }
 
         // Get complex estimate.
         fsdk::ComplexEstimation complexEstimationOut;
-        fsdk::Result<fsdk::FSDKError> complexEstimatorResult =
-                complexEstimator->estimate(warp, complexEstimationOut);
-        if(complexEstimatorResult.isError()) {
-            vlf::log::error("Failed to create complex estimator. Reason: %s.", complexEstimatorResult.what());
+        const bool complexEstimated = cascade.runStage(FaceCascade::StageAttributes, [&](bool &passed) {
+            fsdk::Result<fsdk::FSDKError> complexEstimatorResult =
+                    complexEstimator->estimate(warp, complexEstimationOut);
+            if(complexEstimatorResult.isError()) {
+                vlf::log::error("Failed to create complex estimator. Reason: %s.", complexEstimatorResult.what());
+                return false;
+            }
+            passed = true;
+            return true;
+        });
+        if (!complexEstimated)
+            return -1;
+        printComplexEstimation(complexEstimationOut);
+    }
+
+    // Collect the batched estimates.
+    for (size_t i = 0; i < batchedEstimations.size(); ++i) {
+        const EstimationBatcher::Estimation estimation = batchedEstimations[i].get();
+        if (estimation.failed)
             return -1;
+        std::cout << "Detection " << batchedIndices[i] + 1 << "\n"
+                << "Quality estimated\nQuality: " << estimation.quality << std::endl;
+        if (!estimation.hasAttributes) {
+            vlf::log::info("Warped face quality is too low for attribute estimation.");
+            continue;
         }
-        std::cout << "Complex attributes estimated\n"
-                "Gender: " << complexEstimationOut.gender << " (1 - man, 0 - woman)\n"
-                "Wear glasses: " << complexEstimationOut.wearGlasses
-                << " (1 - person wears glasses, 0 - person doesn't wear glasses)\n"
-                "Age: " << complexEstimationOut.age
-                << " (in years)\n"
-                << std::endl;
+        printComplexEstimation(estimation.attributes);
+    }
+
+    cascade.logStats();
+    if (batchSize > 0) {
+        batcher.stop();
+        batcher.logStats();
     }
 
+    const double processingSec = detectionTimer.elapsedSec();
+    vlf::log::info("Processed %d face(s) in %.2f ms (%.1f faces/sec).",
+            detectionsCount, processingSec * 1000.0, processingSec > 0.0 ? detectionsCount / processingSec : 0.0);
+
     return 0;
 }
+
+void printComplexEstimation(const fsdk::ComplexEstimation &complexEstimation) {
+    std::cout << "Complex attributes estimated\n"
+            "Gender: " << complexEstimation.gender << " (1 - man, 0 - woman)\n"
+            "Wear glasses: " << complexEstimation.wearGlasses
+            << " (1 - person wears glasses, 0 - person doesn't wear glasses)\n"
+            "Age: " << complexEstimation.age
+            << " (in years)\n"
+            << std::endl;
+}
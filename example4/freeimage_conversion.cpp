@@ -0,0 +1,178 @@
+#include "freeimage_conversion.h"
+
+#include <vlf/Log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <vector>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace {
+
+// Converts one source row of `width` pixels to R8G8B8.
+typedef std::function<void(const BYTE *source, uint8_t *target, unsigned width)> RowConverter;
+
+// Rows of 1, 4 or 8 bit palette indices; grayscale bitmaps have a palette too.
+void convertIndexed(const BYTE *source, uint8_t *target, unsigned width, unsigned bpp, const RGBQUAD *palette) {
+    const unsigned perByte = 8 / bpp;
+    const unsigned mask = (1u << bpp) - 1;
+    for (unsigned x = 0; x < width; ++x, target += 3) {
+        // The leftmost pixel is in the highest bits.
+        const unsigned shift = 8 - bpp * (x % perByte + 1);
+        const RGBQUAD &color = palette[(source[x / perByte] >> shift) & mask];
+        target[0] = color.rgbRed;
+        target[1] = color.rgbGreen;
+        target[2] = color.rgbBlue;
+    }
+}
+
+// Channels are scaled to 8 bit the way FreeImage_ConvertTo24Bits does.
+void convert565(const BYTE *source, uint8_t *target, unsigned width) {
+    const WORD *pixels = reinterpret_cast<const WORD*>(source);
+    for (unsigned x = 0; x < width; ++x, target += 3) {
+        const WORD pixel = pixels[x];
+        target[0] = static_cast<uint8_t>((((pixel & FI16_565_RED_MASK) >> FI16_565_RED_SHIFT) * 0xff) / 0x1f);
+        target[1] = static_cast<uint8_t>((((pixel & FI16_565_GREEN_MASK) >> FI16_565_GREEN_SHIFT) * 0xff) / 0x3f);
+        target[2] = static_cast<uint8_t>((((pixel & FI16_565_BLUE_MASK) >> FI16_565_BLUE_SHIFT) * 0xff) / 0x1f);
+    }
+}
+
+void convert555(const BYTE *source, uint8_t *target, unsigned width) {
+    const WORD *pixels = reinterpret_cast<const WORD*>(source);
+    for (unsigned x = 0; x < width; ++x, target += 3) {
+        const WORD pixel = pixels[x];
+        target[0] = static_cast<uint8_t>((((pixel & FI16_555_RED_MASK) >> FI16_555_RED_SHIFT) * 0xff) / 0x1f);
+        target[1] = static_cast<uint8_t>((((pixel & FI16_555_GREEN_MASK) >> FI16_555_GREEN_SHIFT) * 0xff) / 0x1f);
+        target[2] = static_cast<uint8_t>((((pixel & FI16_555_BLUE_MASK) >> FI16_555_BLUE_SHIFT) * 0xff) / 0x1f);
+    }
+}
+
+// Row converter for a FIT_BITMAP of a supported depth; empty for other depths.
+RowConverter getRowConverter(FIBITMAP *sourceImage) {
+    const unsigned bpp = FreeImage_GetBPP(sourceImage);
+    const SimdLevel level = detectSimdLevel();
+    switch (bpp) {
+    case 1:
+    case 4:
+    case 8: {
+        const RGBQUAD *palette = FreeImage_GetPalette(sourceImage);
+        if (!palette)
+            return RowConverter();
+        return [bpp, palette](const BYTE *source, uint8_t *target, unsigned width) {
+            convertIndexed(source, target, width, bpp, palette);
+        };
+    }
+    case 16:
+        if (FreeImage_GetRedMask(sourceImage) == FI16_565_RED_MASK &&
+            FreeImage_GetGreenMask(sourceImage) == FI16_565_GREEN_MASK &&
+            FreeImage_GetBlueMask(sourceImage) == FI16_565_BLUE_MASK)
+            return convert565;
+        return convert555;
+#if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
+    case 24: {
+        // Swapping R and B of B8G8R8 gives R8G8B8.
+        const RgbRowFunc swap = getRgbRowFunc(level);
+        return [swap](const BYTE *source, uint8_t *target, unsigned width) {
+            swap(source, target, nullptr, width);
+        };
+    }
+    case 32: {
+        const BgrxRowFunc bgrxRow = getBgrxRowFunc(level);
+        return [bgrxRow](const BYTE *source, uint8_t *target, unsigned width) {
+            bgrxRow(source, target, width);
+        };
+    }
+#else
+    case 24:
+        return [](const BYTE *source, uint8_t *target, unsigned width) {
+            memcpy(target, source, width * 3);
+        };
+    case 32:
+        return [](const BYTE *source, uint8_t *target, unsigned width) {
+            for (unsigned x = 0; x < width; ++x, source += 4, target += 3) {
+                target[0] = source[0];
+                target[1] = source[1];
+                target[2] = source[2];
+            }
+        };
+#endif
+    default:
+        return RowConverter();
+    }
+}
+
+}
+
+fsdk::Image convertImage(FIBITMAP *sourceImage, ThreadPool *pool) {
+    if (!sourceImage) {
+        vlf::log::error("Source image is invalid.");
+        return fsdk::Image();
+    }
+
+    RowConverter rowConverter;
+    if (FreeImage_GetImageType(sourceImage) == FIT_BITMAP)
+        rowConverter = getRowConverter(sourceImage);
+    if (!rowConverter) {
+        // Let FreeImage handle the rare layouts.
+        FIBITMAP *converted = FreeImage_ConvertTo24Bits(sourceImage);
+        if (!converted) {
+            vlf::log::error("Failed to convert image to 24 bpp.");
+            return fsdk::Image();
+        }
+        fsdk::Image image = convertImage(converted, pool);
+        FreeImage_Unload(converted);
+        return image;
+    }
+
+    const unsigned width = FreeImage_GetWidth(sourceImage);
+    const unsigned height = FreeImage_GetHeight(sourceImage);
+    fsdk::Image colorImage(width, height, fsdk::Format::R8G8B8);
+    if (!colorImage) {
+        vlf::log::error("Failed to create image %ux%u.", width, height);
+        return fsdk::Image();
+    }
+
+    auto convertRows = [&](unsigned begin, unsigned end) {
+        for (unsigned y = begin; y < end; ++y) {
+            rowConverter(
+                    FreeImage_GetScanLine(sourceImage, static_cast<int>(height - 1 - y)),
+                    colorImage.getScanLineAs<uint8_t>(static_cast<int>(y)),
+                    width
+            );
+        }
+    };
+
+    // Bands of at least 64 rows; smaller ones do not pay for the hand-off.
+    const unsigned minBandRows = 64;
+    unsigned bandsCount = pool ? static_cast<unsigned>(pool->getThreadsCount()) : 1;
+    bandsCount = std::max(1u, std::min(bandsCount, height / minBandRows));
+    if (bandsCount == 1) {
+        convertRows(0, height);
+        return colorImage;
+    }
+
+    std::vector<std::future<void>> bands;
+    for (unsigned band = 0; band < bandsCount; ++band) {
+        const unsigned begin = height * band / bandsCount;
+        const unsigned end = height * (band + 1) / bandsCount;
+        bands.push_back(pool->submit([&convertRows, begin, end]() { convertRows(begin, end); }));
+    }
+    for (std::future<void> &band : bands)
+        band.get();
+
+    return colorImage;
+}
+
+FIBITMAP *loadReducedJPEG(const char *path, int sizeHint) {
+    if (FreeImage_GetFileType(path, 0) != FIF_JPEG) {
+        vlf::log::error("Not a JPEG image: \"%s\".", path);
+        return nullptr;
+    }
+    // The hint lives in the upper 16 bits of the load flags.
+    const int hint = std::max(1, std::min(sizeHint, 0xffff));
+    return FreeImage_Load(FIF_JPEG, path, hint << 16);
+}
@@ -0,0 +1,23 @@
+#ifndef FACEENGINE_FREEIMAGE_CONVERSION_H
+#define FACEENGINE_FREEIMAGE_CONVERSION_H
+
+#include <FaceEngine.h>
+#include <FreeImage.h>
+
+class ThreadPool;
+
+// Convert a FreeImage bitmap to an R8G8B8 image.
+// Whole rows are read with FreeImage_GetScanLine and flipped, since FreeImage
+// stores bitmaps bottom-up. 24 and 32 bpp rows are swizzled with the SIMD row
+// kernels of simd.h, 1, 4 and 8 bpp rows go through the palette and 16 bpp rows
+// are unpacked from 565 or 555. Other image types (16 bit per channel, float)
+// are converted to 24 bpp by FreeImage first. With a running pool, bands of
+// rows are converted in parallel. Returns an invalid image on failure.
+fsdk::Image convertImage(FIBITMAP *sourceImage, ThreadPool *pool = nullptr);
+
+// Decode a JPEG scaled down in the DCT domain (FreeImage JPEG size hint):
+// libjpeg picks the smallest of the 1/1, 1/2, 1/4 and 1/8 scales that keeps
+// the larger side at least sizeHint pixels. Returns nullptr for other formats.
+FIBITMAP *loadReducedJPEG(const char *path, int sizeHint);
+
+#endif //FACEENGINE_FREEIMAGE_CONVERSION_H
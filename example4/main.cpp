@@ -2,7 +2,18 @@
 #include <vlf/Log.h>
 
 #include <FreeImage.h>
+#include <cstdlib>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+#include "command_line.h"
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "face_cascade.h"
+#include "freeimage_conversion.h"
+#include "thread_pool.h"
+#include "timer.h"
 
 // FreeImage error handler.
 void FreeImageErrorHandler(FREE_IMAGE_FORMAT fif, const char *message);
@@ -10,9 +21,6 @@ void FreeImageErrorHandler(FREE_IMAGE_FORMAT fif, const char *message);
 // Helper function to load image.
 FIBITMAP *genericLoader(const char *imagePath, int flag);
 
-// Helper function to convert FIBITMAP image to FSDK image.
-fsdk::Image convertImage(FIBITMAP *sourceImage);
-
 int main(int argc, char *argv[])
 {
     // Facial feature detection confidence threshold.
@@ -20,96 +28,84 @@ int main(int argc, char *argv[])
 
     // Parse command line arguments.
     // Arguments:
-    // 1) path to a first image.
-    if (argc != 2) {
-        std::cout << "USAGE: " << argv[0] << " <image>\n"
+    // 1) path to a first image,
+    // 2) optional number of threads for image conversion.
+    // Options:
+    // --detect-size <pixels> - detect faces on a JPEG decoded at reduced resolution,
+    // with the larger side of at least the given number of pixels,
+    // --min-face <pixels> - skip faces with a smaller side,
+    // --min-eye-distance <pixels> - skip faces with closer eye points,
+    // --max-yaw <degrees> - skip faces turned further aside,
+    // --min-quality <quality> - skip attribute estimation of warps with a lower quality.
+    int detectSize = 0;
+    int minFaceSize = 0;
+    float minEyeDistance = 0.f;
+    float maxYaw = 0.f;
+    float minQuality = 0.f;
+    CommandLine commandLine;
+    commandLine.addOption("--detect-size", detectSize);
+    commandLine.addOption("--min-face", minFaceSize);
+    commandLine.addOption("--min-eye-distance", minEyeDistance);
+    commandLine.addOption("--max-yaw", maxYaw);
+    commandLine.addOption("--min-quality", minQuality);
+    const bool validOptions = commandLine.parse(argc, argv);
+    const std::vector<char*> &arguments = commandLine.getArguments();
+    if (!validOptions || detectSize < 0 || minFaceSize < 0 ||
+        minEyeDistance < 0.f || maxYaw < 0.f || minQuality < 0.f ||
+        arguments.empty() || arguments.size() > 2) {
+        std::cout << "USAGE: " << argv[0] << " <image> [threads] [--detect-size <pixels>] [--min-face <pixels>]\n"
+                "       [--min-eye-distance <pixels>] [--max-yaw <degrees>] [--min-quality <quality>]\n"
                 " *image - path to image\n"
+                " *threads - number of conversion threads (default: number of cores)\n"
+                " *detect-size - larger side of the reduced JPEG used for detection (default: full resolution)\n"
+                " *min-face - smallest face side processed (default: any)\n"
+                " *min-eye-distance - smallest distance between the eye points processed (default: any)\n"
+                " *max-yaw - largest rough yaw processed (default: any)\n"
+                " *min-quality - lowest warp quality passed to attribute estimation (default: any)\n"
                 << std::endl;
         return -1;
     }
-    char *imagePath = argv[1];
+    char *imagePath = arguments[0];
+    int threadsCount = arguments.size() > 1 ?
+            atoi(arguments[1]) :
+            static_cast<int>(std::thread::hardware_concurrency());
+    if (threadsCount < 1)
+        threadsCount = 1;
 
     vlf::log::info("imagePath: \"%s\".", imagePath);
-
-    // Create config FaceEngine root SDK object.
-    fsdk::ISettingsProviderPtr config;
-    config = fsdk::acquire(fsdk::createSettingsProvider("./data/faceengine.conf"));
-    if (!config) {
-        vlf::log::error("Failed to load face engine config instance.");
+    vlf::log::info("threads: %d.", threadsCount);
+    if (detectSize > 0)
+        vlf::log::info("detect size: %d.", detectSize);
+    vlf::log::info("min face: %d, min eye distance: %.1f, max yaw: %.1f, min quality: %.3f.",
+            minFaceSize, minEyeDistance, maxYaw, minQuality);
+
+    // Create engine context.
+    EngineContext::Settings settings;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
         return -1;
-    }
 
-    // Create FaceEngine root SDK object.
-    fsdk::IFaceEnginePtr faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
-    if (!faceEngine) {
-        vlf::log::error("Failed to create face engine instance.");
+    // Create SDK components.
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    fsdk::IQualityEstimatorPtr qualityEstimator = engineContext.getQualityEstimator();
+    fsdk::IComplexEstimatorPtr complexEstimator = engineContext.getComplexEstimator();
+    if (!detector || !featureFactory || !warper || !qualityEstimator || !complexEstimator)
         return -1;
-    }
-    faceEngine->setSettingsProvider(config);
-    faceEngine->setDataDirectory("./data/");
-
-    // Create detector factory.
-    fsdk::IDetectorFactoryPtr detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
-    if (!detectorFactory) {
-        vlf::log::error("Failed to create face detector factory instance.");
-        return -1;
-    }
-
-    // Create MTCNN detector.
-    fsdk::IDetectorPtr detector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_MTCNN));
-    if (!detector) {
-        vlf::log::error("Failed to create face detector instance.");
-        return -1;
-    }
-
-    // Create feature factory.
-    fsdk::IFeatureFactoryPtr featureFactory = fsdk::acquire(faceEngine->createFeatureFactory());
-    if (!featureFactory) {
-        vlf::log::error("Failed to create face feature factory instance.");
-        return -1;
-    }
-
-    // Create descriptor factory.
-    fsdk::IDescriptorFactoryPtr descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
-    if (!descriptorFactory) {
-        vlf::log::error("Failed to create face descriptor factory instance.");
-        return -1;
-    }
+    engineContext.logTimings();
+
+    // Rejection cascade.
+    // Every face passes the cheap checks on its detection and landmarks before
+    // it is warped, and the warp quality before attributes are estimated.
+    FaceCascade::Settings cascadeSettings;
+    cascadeSettings.minScore = confidenceThreshold;
+    cascadeSettings.minFaceSize = minFaceSize;
+    cascadeSettings.minEyeDistance = minEyeDistance;
+    cascadeSettings.maxYaw = maxYaw;
+    cascadeSettings.minQuality = minQuality;
+    FaceCascade cascade(warper, qualityEstimator, cascadeSettings);
 
-    // Create CNN warper.
-    fsdk::IWarperPtr warper = fsdk::acquire(descriptorFactory->createWarper(fsdk::DT_CNN));
-    if (!warper) {
-        vlf::log::error("Failed to create face warper instance.");
-        return -1;
-    }
-
-    // Create estimator factory.
-    fsdk::IEstimatorFactoryPtr estimatorFactory = fsdk::acquire(faceEngine->createEstimatorFactory());
-    if (!estimatorFactory) {
-        vlf::log::error("Failed to create face estimator factory instance.");
-        return -1;
-    }
-
-    // Create complex estimator.
-    fsdk::IComplexEstimatorPtr complexEstimator =
-            fsdk::acquire(static_cast<fsdk::IComplexEstimator*>(
-                    estimatorFactory->createEstimator(fsdk::ET_COMPLEX)
-            ));
-    if (!complexEstimator) {
-        vlf::log::error("Failed to create face complex estimator instance.");
-        return -1;
-    }
-
-    // Create quality estimator.
-    fsdk::IQualityEstimatorPtr qualityEstimator =
-            fsdk::acquire(static_cast<fsdk::IQualityEstimator*>(
-                    estimatorFactory->createEstimator(fsdk::ET_QUALITY)
-            ));
-    if (!qualityEstimator) {
-        vlf::log::error("Failed to create face quality estimator instance.");
-        return -1;
-    }
-    
     // FREEIMAGE_STATIC_LIB.
     // Call this ONLY when linking with FreeImage as a static library.
 #ifdef FREEIMAGE_STATIC_LIB
@@ -122,24 +118,39 @@ int main(int argc, char *argv[])
 
     vlf::log::info("FREEIMAGE VERSION: %s.", FreeImage_GetVersion());
 
-    // Load source image.
-    FIBITMAP *sourceImage = genericLoader(imagePath, 0);
+    // Rows are converted in bands, one per pool thread.
+    ThreadPool conversionPool;
+    if (threadsCount > 1)
+        conversionPool.start(threadsCount);
+
+    // Load the image for detection.
+    // With --detect-size a JPEG is decoded scaled down in the DCT domain, which
+    // costs a fraction of a full decode. The full resolution image is decoded
+    // later, and only if there are faces to warp.
+    Timer totalTimer;
+    const bool isReduced = detectSize > 0 && FreeImage_GetFileType(imagePath, 0) == FIF_JPEG;
+    if (detectSize > 0 && !isReduced)
+        vlf::log::info("Not a JPEG image, detecting at full resolution.");
+    FIBITMAP *sourceImage = isReduced ?
+            loadReducedJPEG(imagePath, detectSize) :
+            genericLoader(imagePath, 0);
     if (!sourceImage) {
         vlf::log::error("Failed to load image: \"%s\".", imagePath);
         return -1;
     }
 
     // Convert FIBITMAP image to FSDK image.
-    fsdk::Image image = convertImage(sourceImage);
+    fsdk::Image detectionImage = convertImage(sourceImage, &conversionPool);
 
     // Free the loaded FIBITMAP.
     FreeImage_Unload(sourceImage);
 
-    // FREEIMAGE_STAITC_LIB.
-    // Call this ONLY when linking with FreeImage as a static library.
-#ifdef FREEIMAGE_STATIC_LIB
-    FreeImage_DeInitialise();
-#endif
+    if (!detectionImage) {
+        vlf::log::error("Failed to convert image: \"%s\".", imagePath);
+        return -1;
+    }
+    vlf::log::info("Image %dx%d loaded and converted in %.2f ms.",
+            detectionImage.getWidth(), detectionImage.getHeight(), totalTimer.elapsedMs());
 
     vlf::log::info("Detecting faces.");
 
@@ -154,8 +165,8 @@ int main(int argc, char *argv[])
     // Detect faces in the image.
     fsdk::ResultValue<fsdk::FSDKError, int> detectorResult =
             detector.as<fsdk::IMTCNNDetector>()->detect(
-                    image,
-                    image.getRect(),
+                    detectionImage,
+                    detectionImage.getRect(),
                     &detections[0],
                     &landmarks[0],
                     detectionsCount
@@ -167,6 +178,39 @@ int main(int argc, char *argv[])
     detectionsCount = detectorResult.getValue();
     vlf::log::info("Found %d face(s).", detectionsCount);
 
+    // Full resolution image for warping. Detections found on the reduced image
+    // are mapped to its coordinates.
+    fsdk::Image image = detectionImage;
+    if (isReduced && detectionsCount > 0) {
+        Timer timer;
+        FIBITMAP *fullImage = genericLoader(imagePath, 0);
+        if (!fullImage) {
+            vlf::log::error("Failed to load image: \"%s\".", imagePath);
+            return -1;
+        }
+        image = convertImage(fullImage, &conversionPool);
+        FreeImage_Unload(fullImage);
+        if (!image) {
+            vlf::log::error("Failed to convert image: \"%s\".", imagePath);
+            return -1;
+        }
+
+        const float scaleX = static_cast<float>(image.getWidth()) / detectionImage.getWidth();
+        const float scaleY = static_cast<float>(image.getHeight()) / detectionImage.getHeight();
+        for (int detectionIndex = 0; detectionIndex < detectionsCount; ++detectionIndex)
+            scaleDetection(detections[detectionIndex], &landmarks[detectionIndex], scaleX, scaleY, image.getRect());
+        vlf::log::info("Full resolution image %dx%d loaded and converted in %.2f ms.",
+                image.getWidth(), image.getHeight(), timer.elapsedMs());
+    }
+    conversionPool.stop();
+    vlf::log::info("Image ready for warping %.2f ms after loading started.", totalTimer.elapsedMs());
+
+    // FREEIMAGE_STAITC_LIB.
+    // Call this ONLY when linking with FreeImage as a static library.
+#ifdef FREEIMAGE_STATIC_LIB
+    FreeImage_DeInitialise();
+#endif
+
     // Feature set.
     fsdk::IFeatureSetPtr featureSet(nullptr);
 
@@ -178,9 +222,15 @@ int main(int argc, char *argv[])
 	            << "Rect: x=" << detection.rect.x << " y=" << detection.rect.y
                 << " w=" << detection.rect.width << " h=" << detection.rect.height << std::endl;
 
-        // Estimate confidence score of face detection.
-        if (detection.score < confidenceThreshold) {
-            vlf::log::info("Face detection succeeded, but confidence score of detection is small.");
+        // Check confidence score of face detection and face size.
+        if (!cascade.checkDetection(detection)) {
+            vlf::log::info("Face detection succeeded, but the face is too weak or too small.");
+            continue;
+        }
+
+        // Check the landmark geometry: eye distance and rough yaw.
+        if (!cascade.checkLandmarks(landmarks[detectionIndex])) {
+            vlf::log::info("Face detection succeeded, but the face is too small or turned aside.");
             continue;
         }
 
@@ -191,34 +241,35 @@ int main(int argc, char *argv[])
             return -1;
         }
 
-        // Get warped face from detection.
+        // Get warped face from detection and its quality estimate.
         fsdk::Image warp;
-        fsdk::Result<fsdk::FSDKError> warperResult = warper->warp(image, detection, featureSet, warp);
-        if (warperResult.isError()) {
-            vlf::log::error("Failed to create warped face. Reason: %s.", warperResult.what());
+        float qualityOut;
+        bool qualityPassed;
+        if (!cascade.checkQuality(image, detection, featureSet, warp, qualityOut, qualityPassed))
             return -1;
-        }
 
         // Save warped face.
         warp.saveAsPPM(("warp_" + std::to_string(detectionIndex) + ".ppm").c_str());
-        
-        // Get quality estimate.
-        float qualityOut;
-        fsdk::Result<fsdk::FSDKError> qualityEstimatorResult = qualityEstimator->estimate(warp, &qualityOut);
-        if(qualityEstimatorResult.isError()) {
-            vlf::log::error("Failed to create quality estimating. Reason: %s.", qualityEstimatorResult.what());
-            return -1;
-        }
         std::cout << "Quality estimated\nQuality: " << qualityOut << std::endl;
+        if (!qualityPassed) {
+            vlf::log::info("Warped face quality is too low for attribute estimation.");
+            continue;
+        }
 
         // Get complex estimate.
         fsdk::ComplexEstimation complexEstimationOut;
-        fsdk::Result<fsdk::FSDKError> complexEstimatorResult =
-                complexEstimator->estimate(warp, complexEstimationOut);
-        if(complexEstimatorResult.isError()) {
-            vlf::log::error("Failed to create complex estimator. Reason: %s.", complexEstimatorResult.what());
+        const bool complexEstimated = cascade.runStage(FaceCascade::StageAttributes, [&](bool &passed) {
+            fsdk::Result<fsdk::FSDKError> complexEstimatorResult =
+                    complexEstimator->estimate(warp, complexEstimationOut);
+            if(complexEstimatorResult.isError()) {
+                vlf::log::error("Failed to create complex estimator. Reason: %s.", complexEstimatorResult.what());
+                return false;
+            }
+            passed = true;
+            return true;
+        });
+        if (!complexEstimated)
             return -1;
-        }
         std::cout << "Complex attributes estimated\n"
                 "Gender: " << complexEstimationOut.gender << " (1 - man, 0 - woman)\n"
                 "Wear glasses: " << complexEstimationOut.wearGlasses
@@ -228,6 +279,8 @@ int main(int argc, char *argv[])
                 << std::endl;
     }
 
+    cascade.logStats();
+
     return 0;
 }
 
@@ -259,29 +312,3 @@ FIBITMAP *genericLoader(const char *imagePath, int flag) {
     
     return nullptr;
 }
-
-fsdk::Image convertImage(FIBITMAP *sourceImage) {
-    unsigned width = FreeImage_GetWidth(sourceImage);
-    unsigned height = FreeImage_GetHeight(sourceImage);
-    fsdk::Image colorImage(
-        width,
-        height,
-        fsdk::Format::R8G8B8
-    );
-
-    uint8_t *data = colorImage.getDataAs<uint8_t>();
-    for (unsigned y = 0; y != height; ++y) {
-        for(unsigned x = 0; x != width; ++x) {
-            RGBQUAD pixel;
-            FreeImage_GetPixelColor(sourceImage, x, height - 1 - y, &pixel);
-
-            uint8_t *ptr = data + (y * width + x) * 3;
-
-            ptr[0] = pixel.rgbRed;
-            ptr[1] = pixel.rgbGreen;
-            ptr[2] = pixel.rgbBlue;
-        }
-    }
-
-    return colorImage;
-}
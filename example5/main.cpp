@@ -5,9 +5,13 @@
 #include <QPainter>
 #include <QPen>
 #include <iostream>
+#include <vector>
 
-// Helper function to convert Qt image to FSDK image.
-fsdk::Image convertImage(const QImage &sourceImage);
+#include "command_line.h"
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "qimage_conversion.h"
+#include "timer.h"
 
 int main(int argc, char *argv[])
 {
@@ -17,94 +21,41 @@ int main(int argc, char *argv[])
     // Parse command line arguments.
     // Arguments:
     // 1) path to a first image.
-    if (argc != 2) {
-        std::cout << "USAGE: " << argv[0] << " <image>\n"
+    // Options:
+    // --detect-max-side <pixels> - detect faces on a copy downscaled to the given larger side.
+    int detectionMaxSide = 0;
+    CommandLine commandLine;
+    commandLine.addDetectionMaxSide(detectionMaxSide);
+    const bool validOptions = commandLine.parse(argc, argv);
+    const std::vector<char*> &arguments = commandLine.getArguments();
+    if (!validOptions || arguments.size() != 1) {
+        std::cout << "USAGE: " << argv[0] << " <image> [--detect-max-side <pixels>]\n"
                 " *image - path to image\n"
+                << CommandLine::getDetectionMaxSideUsage()
                 << std::endl;
         return -1;
     }
-    char *imagePath = argv[1];
+    char *imagePath = arguments[0];
 
     vlf::log::info("imagePath: \"%s\".", imagePath);
+    if (detectionMaxSide > 0)
+        vlf::log::info("detection max side: %d.", detectionMaxSide);
 
-    // Create config FaceEngine root SDK object.
-    fsdk::ISettingsProviderPtr config;
-    config = fsdk::acquire(fsdk::createSettingsProvider("./data/faceengine.conf"));
-    if (!config) {
-        vlf::log::error("Failed to load face engine config instance.");
+    // Create engine context.
+    EngineContext::Settings settings;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
         return -1;
-    }
-
-    // Create FaceEngine root SDK object.
-    fsdk::IFaceEnginePtr faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
-    if (!faceEngine) {
-        vlf::log::error("Failed to create face engine instance.");
-        return -1;
-    }
-    faceEngine->setSettingsProvider(config);
-    faceEngine->setDataDirectory("./data/");
-
-    // Create detector factory.
-    fsdk::IDetectorFactoryPtr detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
-    if (!detectorFactory) {
-        vlf::log::error("Failed to create face detector factory instance.");
-        return -1;
-    }
-
-    // Create MTCNN detector.
-    fsdk::IDetectorPtr detector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_MTCNN));
-    if (!detector) {
-        vlf::log::error("Failed to create face detector instance.");
-        return -1;
-    }
-
-    // Create feature factory.
-    fsdk::IFeatureFactoryPtr featureFactory = fsdk::acquire(faceEngine->createFeatureFactory());
-    if (!featureFactory) {
-        vlf::log::error("Failed to create face feature factory instance.");
-        return -1;
-    }
-
-    // Create descriptor factory.
-    fsdk::IDescriptorFactoryPtr descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
-    if (!descriptorFactory) {
-        vlf::log::error("Failed to create face descriptor factory instance.");
-        return -1;
-    }
-
-    // Create CNN warper.
-    fsdk::IWarperPtr warper = fsdk::acquire(descriptorFactory->createWarper(fsdk::DT_CNN));
-    if (!warper) {
-        vlf::log::error("Failed to create face warper instance.");
-        return -1;
-    }
-
-    // Create estimator factory.
-    fsdk::IEstimatorFactoryPtr estimatorFactory = fsdk::acquire(faceEngine->createEstimatorFactory());
-    if (!estimatorFactory) {
-        vlf::log::error("Failed to create face estimator factory instance.");
-        return -1;
-    }
-
-    // Create complex estimator.
-    fsdk::IComplexEstimatorPtr complexEstimator =
-            fsdk::acquire(static_cast<fsdk::IComplexEstimator*>(
-                    estimatorFactory->createEstimator(fsdk::ET_COMPLEX)
-            ));
-    if (!complexEstimator) {
-        vlf::log::error("Failed to create face complex estimator instance.");
-        return -1;
-    }
 
-    // Create quality estimator.
-    fsdk::IQualityEstimatorPtr qualityEstimator =
-            fsdk::acquire(static_cast<fsdk::IQualityEstimator*>(
-                    estimatorFactory->createEstimator(fsdk::ET_QUALITY)
-            ));
-    if (!qualityEstimator) {
-        vlf::log::error("Failed to create face quality estimator instance.");
+    // Create SDK components.
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    fsdk::IQualityEstimatorPtr qualityEstimator = engineContext.getQualityEstimator();
+    fsdk::IComplexEstimatorPtr complexEstimator = engineContext.getComplexEstimator();
+    if (!detector || !featureFactory || !warper || !qualityEstimator || !complexEstimator)
         return -1;
-    }
+    engineContext.logTimings();
 
     // Load source image.
     QImage sourceImage;
@@ -114,7 +65,13 @@ int main(int argc, char *argv[])
     }
 
     // Convert Qt image to FSDK image.
+    Timer conversionTimer;
     fsdk::Image image = convertImage(sourceImage);
+    if (!image) {
+        vlf::log::error("Failed to convert image: \"%s\".", imagePath);
+        return -1;
+    }
+    vlf::log::info("Image %dx%d converted in %.2f ms.", image.getWidth(), image.getHeight(), conversionTimer.elapsedMs());
 
     vlf::log::info("Detecting faces.");
 
@@ -123,23 +80,20 @@ int main(int argc, char *argv[])
 
     // Data used for MTCNN detection.
 	fsdk::Detection detections[MaxDetections];
-	int detectionsCount(MaxDetections);
 	fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
 
     // Detect faces in the image.
-    fsdk::ResultValue<fsdk::FSDKError, int> detectorResult =
-            detector.as<fsdk::IMTCNNDetector>()->detect(
-                    image,
-                    image.getRect(),
-                    &detections[0],
-                    &landmarks[0],
-                    detectionsCount
-            );
-    if (detectorResult.isError()) {
-        vlf::log::error("Failed tor create face detection. Reason: %s.", detectorResult.what());
+    // Detections and landmarks found on a downscaled copy are mapped back to the image.
+    const int detectionsCount = detectFaces(
+            detector,
+            image,
+            detectionMaxSide,
+            &detections[0],
+            &landmarks[0],
+            MaxDetections
+    );
+    if (detectionsCount < 0)
         return -1;
-    }
-    detectionsCount = detectorResult.getValue();
     vlf::log::info("Found %d face(s).", detectionsCount);
     
     // Create image with face detection and marked detection points.
@@ -243,35 +197,3 @@ int main(int argc, char *argv[])
 
     return 0;
 }
-
-fsdk::Image convertImage(const QImage &sourceImage) {
-    fsdk::Image colorImage(
-        sourceImage.width(),
-        sourceImage.height(),
-        fsdk::Format::R8G8B8
-    );
-
-    // Do not rely on Qt image format conversion.
-    // This code isn't very fast but does the right
-    // thing in all cases.
-    uchar *data = colorImage.getDataAs<uchar>();
-    for (int y = 0; y < colorImage.getHeight(); ++y) {
-        for(int x = 0; x < colorImage.getWidth(); ++x) {
-            union rgba {
-                uchar ch[4];
-                uint dword;
-            };
-
-            rgba pixel;
-            pixel.dword = sourceImage.pixel(x, y);
-
-            uchar *ptr = data + (y * colorImage.getWidth() + x) * 3;
-
-            ptr[0] = pixel.ch[2]; // r-g-b order
-            ptr[1] = pixel.ch[1];
-            ptr[2] = pixel.ch[0];
-        }
-    }
-
-    return colorImage;
-}
@@ -0,0 +1,63 @@
+#include "qimage_conversion.h"
+
+#include <vlf/Log.h>
+
+#include <cstring>
+
+#include "simd.h"
+
+fsdk::Image convertImage(const QImage &sourceImage) {
+    if (sourceImage.isNull()) {
+        vlf::log::error("Source image is invalid.");
+        return fsdk::Image();
+    }
+
+    const QImage::Format format = sourceImage.format();
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // 0xAARRGGBB words are B, G, R, A bytes in memory.
+    const bool isBGRX = format == QImage::Format_RGB32 || format == QImage::Format_ARGB32 ||
+            format == QImage::Format_ARGB32_Premultiplied;
+#else
+    const bool isBGRX = false;
+#endif
+    if (!isBGRX && format != QImage::Format_RGB888) {
+        // One conversion by Qt. QImage::pixel() returns premultiplied colors
+        // for premultiplied formats, so those stay premultiplied and other
+        // images with alpha stay unpremultiplied.
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        QImage::Format target = QImage::Format_RGB32;
+        if (sourceImage.pixelFormat().premultiplied() == QPixelFormat::Premultiplied)
+            target = QImage::Format_ARGB32_Premultiplied;
+        else if (sourceImage.hasAlphaChannel())
+            target = QImage::Format_ARGB32;
+#else
+        const QImage::Format target = QImage::Format_RGB888;
+#endif
+        const QImage converted = sourceImage.convertToFormat(target);
+        if (converted.isNull()) {
+            vlf::log::error("Failed to convert image format %d.", static_cast<int>(format));
+            return fsdk::Image();
+        }
+        return convertImage(converted);
+    }
+
+    const int width = sourceImage.width();
+    const int height = sourceImage.height();
+    fsdk::Image colorImage(width, height, fsdk::Format::R8G8B8);
+    if (!colorImage) {
+        vlf::log::error("Failed to create image %dx%d.", width, height);
+        return fsdk::Image();
+    }
+
+    const BgrxRowFunc bgrxRow = getBgrxRowFunc(detectSimdLevel());
+    for (int y = 0; y < height; ++y) {
+        const uchar *source = sourceImage.constScanLine(y);
+        uint8_t *target = colorImage.getScanLineAs<uint8_t>(y);
+        if (isBGRX)
+            bgrxRow(source, target, static_cast<size_t>(width));
+        else
+            memcpy(target, source, static_cast<size_t>(width) * 3);
+    }
+
+    return colorImage;
+}
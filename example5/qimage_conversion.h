@@ -0,0 +1,19 @@
+#ifndef FACEENGINE_QIMAGE_CONVERSION_H
+#define FACEENGINE_QIMAGE_CONVERSION_H
+
+#include <FaceEngine.h>
+
+#include <QImage>
+
+// Convert a Qt image to an R8G8B8 image.
+// Rows are read with QImage::constScanLine. Format_RGB32, Format_ARGB32 and
+// Format_ARGB32_Premultiplied rows are reordered with the SIMD row kernel of
+// simd.h, Format_RGB888 rows are copied. Other formats take one
+// QImage::convertToFormat to one of those first; premultiplied formats go to
+// Format_ARGB32_Premultiplied and keep their premultiplied colors. Colors are
+// those of QImage::pixel() with alpha dropped: premultiplied for premultiplied
+// formats, unpremultiplied for the others.
+// Returns an invalid image on failure.
+fsdk::Image convertImage(const QImage &sourceImage);
+
+#endif //FACEENGINE_QIMAGE_CONVERSION_H
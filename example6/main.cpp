@@ -6,23 +6,75 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <array>
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <thread>
+
+#include "command_line.h"
+#include "descriptor_cache.h"
+#include "engine_context.h"
+#include "extraction_worker_pool.h"
+#include "face_extraction.h"
+#include "latency_stats.h"
+#include "netpbm.h"
+#include "sharded_gallery.h"
+#include "timer.h"
+
+// Helper function to load images names list.
+bool loadImagesNames(
+        const char *listPath,
+        std::vector<std::string> &imagesNamesList
+);
+
+// Descriptor of one image in flight. Cache hits are resolved at once.
+struct PendingDescriptor {
+    std::future<fsdk::IDescriptorPtr> descriptor;
+    DescriptorCache::Key key;
+    bool store = false;
+    Timer timer;
+};
+
+// Look an image up in the cache or decode it and submit it to the pool.
+// Returns false if the image could not be loaded.
+bool submitImage(
+        ExtractionWorkerPool &pool,
+        DescriptorCache &descriptorCache,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const std::string &imagePath,
+        PendingDescriptor &pending
+);
+
+// Wait for a descriptor and store it in the cache if it was extracted.
+fsdk::IDescriptorPtr finishDescriptor(
+        DescriptorCache &descriptorCache,
+        PendingDescriptor &pending
+);
 
-// Helper function to load images.
-bool loadImages(
+// Decode gallery images and extract their descriptors in parallel.
+// Descriptors are added to the gallery in list order.
+bool enrollGallery(
+        ExtractionWorkerPool &pool,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
         const char *imagesDirPath,
-        const char *listPath,
-        std::vector<std::string> &imagesNamesList,
-        std::vector<fsdk::Image> &imagesList
+        const std::vector<std::string> &imagesNamesList,
+        DescriptorCache &descriptorCache,
+        ShardedGallery &gallery
 );
 
-// Extract face descriptor.
-fsdk::IDescriptorPtr extractDescriptor(
-        fsdk::IDetectorPtr detector,
-        fsdk::IFeatureFactoryPtr featureFactory,
-        fsdk::IDescriptorFactoryPtr descriptorFactory,
-        fsdk::IDescriptorExtractorPtr descriptorExtractor,
-        fsdk::Image &image
+// Identify every probe of a list against the gallery.
+// Writes one record per probe to the output in list order.
+bool identifyProbes(
+        ExtractionWorkerPool &pool,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const std::vector<std::string> &probesList,
+        const std::vector<std::string> &imagesNamesList,
+        ShardedGallery &gallery,
+        int numberNearestNeighbors,
+        float threshold,
+        DescriptorCache &descriptorCache,
+        std::ostream &output
 );
 
 int main(int argc, char *argv[])
@@ -34,205 +86,255 @@ int main(int argc, char *argv[])
 	// and therefore should be rebuilt if the corresponding batch is changed.
 	// LSH table methods are not thread safe; users should create a table per thread
 	// if parallel processing is required.
-
-    // Number of required nearest neighbors.
-    const int numberNearestNeighbors = 3;
-
-	// Number of matching result.
-	const int numberMatchingResult = 6;
+	// ShardedGallery (see common/) keeps a batch and an LSH table per shard, so they
+	// stay resident and only the tail shard is rebuilt when the gallery grows.
 
     // Parse command line arguments.
     // Arguments:
-    // 1) path to a image,
+    // 1) path to a image or, with --probes, path to a probe images list,
     // 2) path to a images directory,
     // 3) path to a images names list,
-    // 4) matching threshold.
+    // 4) matching threshold,
+    // 5) optional number of threads.
+    // Options:
+    // --probes <list> - identify every image of the list (one path per line),
+    // --k <number> - number of nearest neighbors (default: 3),
+    // --output <file> - write identification records to a file instead of stdout,
+    // --cache <dir> - reuse descriptors of unchanged images from a cache directory,
+    // --detect-max-side <pixels> - detect faces on a copy downscaled to the given larger side.
     // If matching score is above the threshold, then both images
     // belong to the same person, otherwise they belong to different persons.
     // Images should be in ppm format.
-    if (argc != 5) {
-        std::cout << "Usage: "<<  argv[0] << " <image> <imagesDir> <list> <threshold>\n"
+    const char *probesPath = nullptr;
+    const char *outputPath = nullptr;
+    const char *cachePath = nullptr;
+    int numberNearestNeighbors = 3;
+    int detectionMaxSide = 0;
+    CommandLine commandLine;
+    commandLine.addOption("--probes", probesPath);
+    commandLine.addOption("--k", numberNearestNeighbors);
+    commandLine.addOption("--output", outputPath);
+    commandLine.addOption("--cache", cachePath);
+    commandLine.addDetectionMaxSide(detectionMaxSide);
+    const bool validOptions = commandLine.parse(argc, argv);
+    const std::vector<char*> &arguments = commandLine.getArguments();
+    const size_t firstArgument = probesPath ? 0 : 1;
+    if (!validOptions || numberNearestNeighbors < 1 ||
+        arguments.size() < firstArgument + 3 || arguments.size() > firstArgument + 4) {
+        std::cout << "Usage: "<<  argv[0] << " <image> <imagesDir> <list> <threshold> [threads]"
+                " [--k <number>] [--cache <dir>] [--detect-max-side <pixels>]\n"
+                "       " << argv[0] << " --probes <probes> <imagesDir> <list> <threshold> [threads]"
+                " [--k <number>] [--output <file>] [--cache <dir>]"
+                " [--detect-max-side <pixels>]\n"
                 " *image - path to image\n"
+                " *probes - path to probe images list, one path per line\n"
                 " *imagesDir - path to images directory\n"
                 " *list - path to images names list\n"
                 " *threshold - similarity threshold in range (0..1]\n"
+                " *threads - number of worker threads (default: number of cores)\n"
+                " *k - number of nearest neighbors (default: 3)\n"
+                " *output - file for identification records (default: stdout)\n"
+                " *cache - directory of the persistent descriptor cache\n"
+                << CommandLine::getDetectionMaxSideUsage()
                 << std::endl;
         return -1;
     }
-    char *imagePath = argv[1];
-    char *imagesDirPath = argv[2];
-    char *listPath = argv[3];
-    float threshold = (float)atof(argv[4]);
-
-    vlf::log::info("imagePath: \"%s\".", imagePath);
+    char *imagePath = probesPath ? nullptr : arguments[0];
+    char *imagesDirPath = arguments[firstArgument];
+    char *listPath = arguments[firstArgument + 1];
+    float threshold = (float)atof(arguments[firstArgument + 2]);
+    int threadsCount = arguments.size() > firstArgument + 3 ?
+            atoi(arguments[firstArgument + 3]) :
+            static_cast<int>(std::thread::hardware_concurrency());
+    if (threadsCount < 1)
+        threadsCount = 1;
+
+    if (probesPath)
+        vlf::log::info("probesPath: \"%s\".", probesPath);
+    else
+        vlf::log::info("imagePath: \"%s\".", imagePath);
     vlf::log::info("imagesDirPath: \"%s\".", imagesDirPath);
     vlf::log::info("listPath: \"%s\".", listPath);
     vlf::log::info("threshold: %1.3f.", threshold);
-
-    // Create config FaceEngine root SDK object.
-    fsdk::ISettingsProviderPtr config;
-    config = fsdk::acquire(fsdk::createSettingsProvider("./data/faceengine.conf"));
-    if (!config) {
-        vlf::log::error("Failed to load face engine config instance.");
+    vlf::log::info("threads: %d.", threadsCount);
+    vlf::log::info("nearest neighbors: %d.", numberNearestNeighbors);
+    if (cachePath)
+        vlf::log::info("cachePath: \"%s\".", cachePath);
+    if (detectionMaxSide > 0)
+        vlf::log::info("detection max side: %d.", detectionMaxSide);
+
+    // Create engine context.
+    // Models are brought up and warmed up before enrollment, so the
+    // enrollment throughput does not include their startup cost.
+    EngineContext::Settings settings;
+    settings.preload = true;
+    settings.useWarper = false;
+    settings.useMatcher = false;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
         return -1;
-    }
 
-    // Create FaceEngine root SDK object.
-    fsdk::IFaceEnginePtr faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
-    if (!faceEngine) {
-        vlf::log::error("Failed to create face engine instance.");
+    // Open descriptor cache. Workers use the MTCNN detector and take the face
+    // with the best detection score.
+    DescriptorCache descriptorCache;
+    if (cachePath && !descriptorCache.open(
+            cachePath,
+            engineContext.getDescriptorModel(),
+            fsdk::ODT_MTCNN,
+            detectionMaxSide,
+            DescriptorCache::FaceSelection()))
         return -1;
-    }
-    faceEngine->setSettingsProvider(config);
-    faceEngine->setDataDirectory("./data/");
-
-    // Create detector factory.
-    fsdk::IDetectorFactoryPtr detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
-    if (!detectorFactory) {
-        vlf::log::error("Failed to create face detector factory instance.");
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    if (!descriptorFactory)
         return -1;
-    }
 
-    // Create MTCNN detector.
-    fsdk::IDetectorPtr detector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_MTCNN));
-    if (!detector) {
-        vlf::log::error("Failed to create face detector instance.");
+    // Load images names. Images themselves are decoded during enrollment.
+    std::vector<std::string> imagesNamesList;
+    if (!loadImagesNames(listPath, imagesNamesList)) {
+        vlf::log::error("Failed to load images names.");
         return -1;
     }
 
-    // Create feature factory.
-    fsdk::IFeatureFactoryPtr featureFactory = fsdk::acquire(faceEngine->createFeatureFactory());
-    if (!featureFactory) {
-        vlf::log::error("Failed to create face feature factory instance.");
-        return -1;
-    }
+    vlf::log::info("Creating gallery.");
 
-    // Create descriptor factory.
-    fsdk::IDescriptorFactoryPtr descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
-    if (!descriptorFactory) {
-        vlf::log::error("Failed to create face descriptor factory instance.");
+    // Create sharded gallery. It stays resident for all probes.
+    ShardedGallery::Settings gallerySettings;
+    gallerySettings.threadsCount = threadsCount;
+    ShardedGallery gallery;
+    if (!gallery.init(engineContext.getFaceEngine(), gallerySettings)) {
+        vlf::log::error("Failed to create gallery.");
         return -1;
     }
 
-    // Create CNN descriptor extractor.
-    fsdk::IDescriptorExtractorPtr descriptorExtractor =
-            fsdk::acquire(descriptorFactory->createExtractor(fsdk::DT_CNN));
-    if (!descriptorExtractor) {
-        vlf::log::error("Failed to create face descriptor extractor instance.");
-        return -1;
-    }
-    
-    // Create CNN descriptor matcher.
-    fsdk::IDescriptorMatcherPtr descriptorMatcher =
-            fsdk::acquire(descriptorFactory->createMatcher(fsdk::DT_CNN));
-    if (!descriptorMatcher) {
-        vlf::log::error("Failed to create face descriptor matcher instance.");
+    // Extraction pool shared by enrollment and probe identification.
+    // Every pool thread owns its own MTCNN detector and descriptor extractor,
+    // so they are created once per run.
+    ExtractionWorkerPool::Settings poolSettings;
+    poolSettings.threadsCount = threadsCount;
+    poolSettings.detectionMaxSide = detectionMaxSide;
+    ExtractionWorkerPool pool;
+    if (!pool.start(engineContext.getFaceEngine(), poolSettings)) {
+        vlf::log::error("Failed to start extraction pool.");
         return -1;
     }
 
-    // Load images.
-    std::vector<std::string> imagesNamesList;
-    std::vector<fsdk::Image> imagesList;
-    if (!loadImages(imagesDirPath, listPath, imagesNamesList, imagesList)) {
-        vlf::log::error("Failed to load images.");
+    // Extract faces descriptors and build LSH tables.
+    Timer enrollmentTimer;
+    if (!enrollGallery(
+            pool,
+            descriptorFactory,
+            imagesDirPath,
+            imagesNamesList,
+            descriptorCache,
+            gallery)) {
+        vlf::log::error("Failed to enroll gallery.");
         return -1;
     }
+    const double enrollmentSec = enrollmentTimer.elapsedSec();
+    vlf::log::info("Enrolled %d image(s) in %.2f s (%.1f images/sec), %d shard(s).",
+            static_cast<int>(imagesNamesList.size()),
+            enrollmentSec,
+            enrollmentSec > 0.0 ? imagesNamesList.size() / enrollmentSec : 0.0,
+            gallery.getShardsCount()
+    );
 
-    vlf::log::info("Creating descriptor barch.");
+    if (probesPath) {
+        std::vector<std::string> probesList;
+        if (!loadImagesNames(probesPath, probesList)) {
+            vlf::log::error("Failed to load probes list.");
+            return -1;
+        }
 
-    // Create CNN face descriptor batch.
-    fsdk::IDescriptorBatchPtr descriptorBatch =
-            fsdk::acquire(descriptorFactory->createDescriptorBatch(fsdk::DT_CNN, static_cast<int>(imagesList.size())));
-    if (!descriptorBatch) {
-        vlf::log::error("Failed to create face descriptor batch instance.");
-        return -1;
-    }
+        std::ofstream outputFile;
+        if (outputPath) {
+            outputFile.open(outputPath);
+            if (!outputFile) {
+                vlf::log::error("Failed to open file: %s.", outputPath);
+                return -1;
+            }
+        }
 
-    // Extract faces descriptors.
-    for (fsdk::Image &image : imagesList) {
-        fsdk::IDescriptorPtr descriptor = extractDescriptor(
-                detector,
-                featureFactory,
+        if (!identifyProbes(
+                pool,
                 descriptorFactory,
-                descriptorExtractor,
-                image
-        );
-        if (!descriptor)
-            return -1;
-        fsdk::Result<fsdk::DescriptorBatchError> descriptorBatchAddResult =
-                descriptorBatch->add(descriptor);
-        if (descriptorBatchAddResult.isError()) {
-            vlf::log::error("Failed to add descriptor to descriptor batch.");
+                probesList,
+                imagesNamesList,
+                gallery,
+                numberNearestNeighbors,
+                threshold,
+                descriptorCache,
+                outputPath ? outputFile : std::cout)) {
+            vlf::log::error("Failed to identify probes.");
             return -1;
         }
+        if (descriptorCache.isOpen())
+            descriptorCache.logStats();
+        return 0;
     }
 
-    vlf::log::info("Creating LSH table.");
-
-    // Create CNN LSH table.
-    fsdk::ILSHTablePtr lsh =
-            fsdk::acquire(descriptorFactory->createLSHTable(fsdk::DT_CNN, descriptorBatch.get()));
-    if (!lsh) {
-        vlf::log::error("Failed to create LSH table instance.");
+    // Create SDK components.
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IDescriptorExtractorPtr descriptorExtractor = engineContext.getExtractor();
+    if (!detector || !featureFactory || !descriptorExtractor)
         return -1;
-    }
-
-    // KNN index array.
-    std::array<int, numberNearestNeighbors> nearestNeighbors;
-
-    fsdk::Image image;
-    if (!image.loadFromPPM(imagePath)) {
-        vlf::log::error("Failed to load image: \"%s\".", imagePath);
-        return false;
-    }
+    engineContext.logTimings();
 
-    // Extract face descriptor.
-    fsdk::IDescriptorPtr descriptor = extractDescriptor(
-            detector,
-            featureFactory,
+    // Extract face descriptor, or take it from the cache.
+    fsdk::IDescriptorPtr descriptor = descriptorCache.getOrExtract(
+            imagePath,
             descriptorFactory,
-            descriptorExtractor,
-            image
+            [&]() -> fsdk::IDescriptorPtr {
+                fsdk::Image image;
+                if (!loadNetpbm(imagePath, fsdk::Format::R8G8B8, image)) {
+                    vlf::log::error("Failed to load image: \"%s\".", imagePath);
+                    return nullptr;
+                }
+                // The same extraction as in the pool workers.
+                FaceExtractionSettings extractionSettings;
+                extractionSettings.confidenceThreshold = poolSettings.confidenceThreshold;
+                extractionSettings.detectionMaxSide = detectionMaxSide;
+                extractionSettings.verbose = true;
+                return extractBestFace(
+                        detector,
+                        featureFactory,
+                        fsdk::IFeatureDetectorPtr(),
+                        descriptorFactory,
+                        descriptorExtractor,
+                        nullptr,
+                        image,
+                        extractionSettings
+                );
+            }
     );
+    if (descriptorCache.isOpen())
+        descriptorCache.logStats();
     if (!descriptor)
         return -1;
 
-    // Get numberNearestNeighbors nearest neighbours.
-    lsh->getKNearestNeighbours(descriptor, numberNearestNeighbors, &nearestNeighbors[0]);
-    vlf::log::info("Name image: \"%s\", nearest neighbors: \"%s\", \"%s\", \"%s\".",
-            imagePath,
-            imagesNamesList[nearestNeighbors[0]].c_str(),
-            imagesNamesList[nearestNeighbors[1]].c_str(),
-            imagesNamesList[nearestNeighbors[2]].c_str()
-    );
-
-    // Match descriptor and descriptor batch.
-    fsdk::MatchingResult matchingResult[numberMatchingResult];
-    fsdk::Result<fsdk::FSDKError> descriptorMatcherResult =
-            descriptorMatcher->match(
-                    descriptor,
-                    descriptorBatch,
-                    &nearestNeighbors[0],
-                    numberNearestNeighbors,
-                    &matchingResult[0]
-            );
-    if (!descriptorMatcherResult) {
-        vlf::log::error("Failed to match. Reason: %s.", descriptorMatcherResult.what());
+    // Get numberNearestNeighbors nearest neighbours, scored by the matcher.
+    std::vector<ShardedGallery::Neighbour> neighbours(numberNearestNeighbors);
+    const int neighboursCount = gallery.search(descriptor, numberNearestNeighbors, &neighbours[0]);
+    if (neighboursCount < 0) {
+        vlf::log::error("Failed to match.");
         return -1;
     }
 
     std::ostringstream oss;
 
-    for (size_t j = 0; j < imagesList.size(); ++j) {
+    // Only the found neighbours have results.
+    for (int j = 0; j < neighboursCount; ++j) {
+        const std::string &imageName = imagesNamesList[neighbours[j].index];
+        const float similarity = neighbours[j].result.similarity;
         vlf::log::info("Images: \"%s\" and \"%s\" matched with score: %1.1f%%.",
                 imagePath,
-                imagesNamesList[j].c_str(),
-                matchingResult[j].similarity * 100.f
+                imageName.c_str(),
+                similarity * 100.f
         );
 
         oss << "Images: \"" << imagePath << "\" and \""
-                << imagesNamesList[j] << "\" ";
-        if (matchingResult[j].similarity > threshold)
+                << imageName << "\" ";
+        if (similarity > threshold)
             oss << "belong to one person." << std::endl;
         else
             oss << "belong to different persons." << std::endl;
@@ -243,11 +345,9 @@ int main(int argc, char *argv[])
     return 0;
 }
 
-bool loadImages(
-        const char *imagesDirPath,
+bool loadImagesNames(
         const char *listPath,
-        std::vector<std::string> &imagesNamesList,
-        std::vector<fsdk::Image> &imagesList
+        std::vector<std::string> &imagesNamesList
 ) {
     std::ifstream listFile(listPath);
     if (!listFile) {
@@ -255,133 +355,186 @@ bool loadImages(
         return false;
     }
     std::string imageName;
-    while (listFile >> imageName) {
-        fsdk::Image image;
-        std::string imagePath = std::string(imagesDirPath) + "/" + imageName;
-        if (!image.loadFromPPM(imagePath.c_str())) {
-            vlf::log::error("Failed to load image: \"%s\".", imagePath.c_str());
-            return false;
-        }
+    while (listFile >> imageName)
         imagesNamesList.push_back(imageName);
-        imagesList.push_back(image);
-    }
     listFile.close();
 
     return true;
 }
 
-fsdk::IDescriptorPtr extractDescriptor(
-        fsdk::IDetectorPtr detector,
-        fsdk::IFeatureFactoryPtr featureFactory,
-        fsdk::IDescriptorFactoryPtr descriptorFactory,
-        fsdk::IDescriptorExtractorPtr descriptorExtractor,
-        fsdk::Image &image
+bool submitImage(
+        ExtractionWorkerPool &pool,
+        DescriptorCache &descriptorCache,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const std::string &imagePath,
+        PendingDescriptor &pending
 ) {
-    // Facial feature detection confidence threshold.
-    const float confidenceThreshold = 0.25f;
-
-    if (!image) {
-        vlf::log::error("Request image is invalid.");
-        return nullptr;
-    }
-
-    // Create color image.
-    fsdk::Image imageBGR;
-    image.convert(imageBGR, fsdk::Format::B8G8R8);
-    if (!imageBGR) {
-        vlf::log::error("Conversion to BGR has failed.");
-        return nullptr;
+    pending.timer.reset();
+    pending.store = false;
+    if (descriptorCache.isOpen() && descriptorCache.makeKey(imagePath, pending.key)) {
+        // A hit skips decoding as well as extraction.
+        fsdk::IDescriptorPtr descriptor = descriptorCache.find(pending.key, descriptorFactory);
+        if (descriptor) {
+            std::promise<fsdk::IDescriptorPtr> ready;
+            ready.set_value(descriptor);
+            pending.descriptor = ready.get_future();
+            return true;
+        }
+        pending.store = true;
     }
 
-    vlf::log::info("Detecting faces.");
-
-    // Detect no more than 10 faces in the image.
-    enum { MaxDetections = 10 };
-
-    // Data used for MTCNN detection.
-    fsdk::Detection detections[MaxDetections];
-    int detectionsCount(MaxDetections);
-    fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
-
-    // Detect faces in the image.
-    fsdk::ResultValue<fsdk::FSDKError, int> detectorResult =
-            detector.as<fsdk::IMTCNNDetector>()->detect(
-                    image,
-                    image.getRect(),
-                    &detections[0],
-                    &landmarks[0],
-                    detectionsCount
-            );
-    if (detectorResult.isError()) {
-        vlf::log::error("Failed to create face detection. Reason: %s.", detectorResult.what());
-        return nullptr;
+    fsdk::Image image;
+    if (!loadNetpbm(imagePath.c_str(), fsdk::Format::R8G8B8, image)) {
+        vlf::log::error("Failed to load image: \"%s\".", imagePath.c_str());
+        return false;
     }
-    detectionsCount = detectorResult.getValue();
-    vlf::log::info("Found %d face(s).", detectionsCount);
-
-    fsdk::IFeatureSetPtr bestFeatureSet(nullptr);
-    int bestDetectionIndex(0);
-    float bestDetectionScore(0.f);
-
-    // Feature set.
-    fsdk::IFeatureSetPtr featureSet(nullptr);
-
-    // Loop through all the faces and find one with the best score.
-    for (int detectionIndex = 0; detectionIndex < detectionsCount; ++detectionIndex) {
-        fsdk::Detection &detection = detections[detectionIndex];
+    pending.descriptor = pool.submit(image);
+    return true;
+}
 
-        // Estimate confidence score of face detection.
-        if (detection.score < confidenceThreshold) {
-            vlf::log::info("Face detection succeeded, but confidence score of detection is small.");
-            continue;
-        }
+fsdk::IDescriptorPtr finishDescriptor(
+        DescriptorCache &descriptorCache,
+        PendingDescriptor &pending
+) {
+    fsdk::IDescriptorPtr descriptor = pending.descriptor.get();
+    // Extraction time is taken from submission, so it includes the wait in the pool queue.
+    if (descriptor && pending.store)
+        descriptorCache.store(pending.key, descriptor, pending.timer.elapsedMs());
+    return descriptor;
+}
 
-        // Choose the best feature set.
-        if (bestFeatureSet && detection.score <= bestDetectionScore) {
-            continue;
-        }
-        
-        // Create feature set.
-        featureSet = fsdk::acquire(featureFactory->createFeatureSet(landmarks[detectionIndex], detection.score));
-        if (!featureSet) {
-            vlf::log::error("Failed to create face feature set instance.");
-            return nullptr;
+bool enrollGallery(
+        ExtractionWorkerPool &pool,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const char *imagesDirPath,
+        const std::vector<std::string> &imagesNamesList,
+        DescriptorCache &descriptorCache,
+        ShardedGallery &gallery
+) {
+    // Results are consumed in submission order, so the gallery keeps list order.
+    // Only a few decoded images are alive at any time (the pool queue and the
+    // window below are bounded), so memory does not grow with the list size.
+    const size_t maxInFlight = static_cast<size_t>(pool.getThreadsCount()) * 4;
+    std::deque<PendingDescriptor> inFlight;
+
+    auto commitOldest = [&]() -> bool {
+        fsdk::IDescriptorPtr descriptor = finishDescriptor(descriptorCache, inFlight.front());
+        inFlight.pop_front();
+        if (!descriptor) {
+            vlf::log::error("Failed to extract gallery face descriptor.");
+            return false;
         }
-
-        bestDetectionIndex = detectionIndex;
-        bestDetectionScore = detection.score;
-        bestFeatureSet = featureSet;
-    }
-
-    // If not detect facial features or feature confidence score is too low, abort.
-    if (!bestFeatureSet) {
-        vlf::log::info("Face detection succeeded, but no faces with good confidence found.");
-        return nullptr;
+        return gallery.append(descriptor);
+    };
+
+    // Decode images on this thread and feed the workers.
+    for (const std::string &imageName : imagesNamesList) {
+        PendingDescriptor pending;
+        if (!submitImage(pool, descriptorCache, descriptorFactory,
+                std::string(imagesDirPath) + "/" + imageName, pending))
+            return false;
+        inFlight.push_back(std::move(pending));
+        if (inFlight.size() >= maxInFlight && !commitOldest())
+            return false;
     }
-    vlf::log::info("Best face confidence is %0.3f.", bestDetectionScore);
-    fsdk::Detection bestDetection = detections[bestDetectionIndex];
-
-    // Create a face descriptor.
-    fsdk::IDescriptorPtr descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
-    if (!descriptor) {
-        vlf::log::error("Failed to create face descrtiptor instance.");
-        return nullptr;
+    while (!inFlight.empty()) {
+        if (!commitOldest())
+            return false;
     }
 
-    vlf::log::info("Extracting descriptor.");
+    // Build LSH tables of all shards in parallel.
+    return gallery.build();
+}
 
-    // Extract face descriptor.
-    // This is typically the most time consuming task.
-    fsdk::Result<fsdk::FSDKError> descriptorExtractorResult = descriptorExtractor->extract(
-            imageBGR,
-            bestDetection,
-            bestFeatureSet,
-            descriptor
-    );
-    if(descriptorExtractorResult.isError()) {
-        vlf::log::error("Failed to extract face descriptor. Reason: %s.", descriptorExtractorResult.what());
-        return nullptr;
+bool identifyProbes(
+        ExtractionWorkerPool &pool,
+        const fsdk::IDescriptorFactoryPtr &descriptorFactory,
+        const std::vector<std::string> &probesList,
+        const std::vector<std::string> &imagesNamesList,
+        ShardedGallery &gallery,
+        int numberNearestNeighbors,
+        float threshold,
+        DescriptorCache &descriptorCache,
+        std::ostream &output
+) {
+    // Probe in flight. Latency is measured from decoding to the written record.
+    struct Probe {
+        std::string path;
+        bool loaded;
+        PendingDescriptor pending;
+    };
+    const size_t maxInFlight = static_cast<size_t>(pool.getThreadsCount()) * 2;
+    std::deque<Probe> inFlight;
+
+    std::vector<ShardedGallery::Neighbour> neighbours(numberNearestNeighbors);
+    LatencyStats latencyStats;
+    int identifiedCount = 0;
+    int unknownCount = 0;
+    int failedCount = 0;
+
+    // Record: probe path, status, best name, best similarity and all candidates
+    // as name:similarity, separated by tabs. Status is one of
+    // "match", "unknown", "noface" or "error".
+    auto commitOldest = [&]() -> bool {
+        Probe &probe = inFlight.front();
+        output << probe.path;
+        fsdk::IDescriptorPtr descriptor = probe.loaded ?
+                finishDescriptor(descriptorCache, probe.pending) : nullptr;
+        const int neighboursCount = descriptor ?
+                gallery.search(descriptor, numberNearestNeighbors, &neighbours[0]) : 0;
+        if (!probe.loaded || neighboursCount < 0) {
+            output << "\terror\t-\t0.000";
+            ++failedCount;
+        } else if (!descriptor) {
+            output << "\tnoface\t-\t0.000";
+            ++failedCount;
+        } else if (neighboursCount > 0 && neighbours[0].result.similarity > threshold) {
+            output << "\tmatch\t" << imagesNamesList[neighbours[0].index]
+                    << "\t" << neighbours[0].result.similarity;
+            ++identifiedCount;
+        } else {
+            output << "\tunknown\t-\t" << (neighboursCount > 0 ? neighbours[0].result.similarity : 0.f);
+            ++unknownCount;
+        }
+        for (int j = 0; j < std::max(neighboursCount, 0); ++j)
+            output << "\t" << imagesNamesList[neighbours[j].index] << ":" << neighbours[j].result.similarity;
+        output << "\n";
+        latencyStats.add(probe.pending.timer.elapsedMs());
+        inFlight.pop_front();
+        return static_cast<bool>(output);
+    };
+
+    output.setf(std::ios::fixed);
+    output.precision(3);
+
+    Timer timer;
+    for (const std::string &probePath : probesList) {
+        Probe probe;
+        probe.path = probePath;
+        probe.loaded = submitImage(pool, descriptorCache, descriptorFactory, probePath, probe.pending);
+        inFlight.push_back(std::move(probe));
+        if (inFlight.size() >= maxInFlight && !commitOldest())
+            return false;
+    }
+    while (!inFlight.empty()) {
+        if (!commitOldest())
+            return false;
     }
+    output.flush();
+    const double elapsedSec = timer.elapsedSec();
+
+    vlf::log::info("Identified %d probe(s) in %.2f s (%.1f probes/sec): %d matched, %d unknown, %d failed.",
+            static_cast<int>(probesList.size()),
+            elapsedSec,
+            elapsedSec > 0.0 ? probesList.size() / elapsedSec : 0.0,
+            identifiedCount,
+            unknownCount,
+            failedCount
+    );
+    vlf::log::info("Probe latency: p50 %.1f ms, p99 %.1f ms.",
+            latencyStats.getPercentile(50),
+            latencyStats.getPercentile(99)
+    );
 
-    return descriptor;
+    return true;
 }
@@ -2,9 +2,15 @@
 #include <vlf/Log.h>
 
 #include <iostream>
+#include <string>
 #include <vector>
 
-#include "io_util.h"
+#include "command_line.h"
+#include "detection_scaling.h"
+#include "engine_context.h"
+#include "gallery.h"
+#include "netpbm.h"
+#include "timer.h"
 
 int main(int argc, char *argv[])
 {
@@ -14,84 +20,51 @@ int main(int argc, char *argv[])
     // Parse command line arguments.
     // Arguments:
     // 1) path to a first image.
+    // Options:
+    // --detect-max-side <pixels> - detect faces on a copy downscaled to the given larger side.
     // Image should be in ppm format.
-    if (argc != 2) {
-        std::cout << "USAGE: " << argv[0] << " <image>\n"
+    int detectionMaxSide = 0;
+    CommandLine commandLine;
+    commandLine.addDetectionMaxSide(detectionMaxSide);
+    const bool validOptions = commandLine.parse(argc, argv);
+    const std::vector<char*> &arguments = commandLine.getArguments();
+    if (!validOptions || arguments.size() != 1) {
+        std::cout << "USAGE: " << argv[0] << " <image> [--detect-max-side <pixels>]\n"
                 " *image - path to image\n"
+                << CommandLine::getDetectionMaxSideUsage()
                 << std::endl;
         return -1;
     }
-    char *imagePath = argv[1];
+    char *imagePath = arguments[0];
 
     vlf::log::info("imagePath: \"%s\".", imagePath);
+    if (detectionMaxSide > 0)
+        vlf::log::info("detection max side: %d.", detectionMaxSide);
 
-    // Create config FaceEngine root SDK object.
-    fsdk::ISettingsProviderPtr config;
-    config = fsdk::acquire(fsdk::createSettingsProvider("./data/faceengine.conf"));
-    if (!config) {
-        vlf::log::error("Failed to load face engine config instance.");
+    // Create engine context.
+    EngineContext::Settings settings;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
         return -1;
-    }
-
-    // Create FaceEngine root SDK object.
-    fsdk::IFaceEnginePtr faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
-    if (!faceEngine) {
-        vlf::log::error("Failed to create face engine instance.");
-        return -1;
-    }
-    faceEngine->setSettingsProvider(config);
-    faceEngine->setDataDirectory("./data/");
-
-    // Create detector factory.
-    fsdk::IDetectorFactoryPtr detectorFactory = fsdk::acquire(faceEngine->createDetectorFactory());
-    if (!detectorFactory) {
-        vlf::log::error("Failed to create face detector factory instance.");
-        return -1;
-    }
-
-    // Create MTCNN detector.
-    fsdk::IDetectorPtr detector = fsdk::acquire(detectorFactory->createDetector(fsdk::ODT_MTCNN));
-    if (!detector) {
-        vlf::log::error("Failed to create face detector instance.");
-        return -1;
-    }
-
-    // Create feature factory.
-    fsdk::IFeatureFactoryPtr featureFactory = fsdk::acquire(faceEngine->createFeatureFactory());
-    if (!featureFactory) {
-        vlf::log::error("Failed to create face feature factory instance.");
-        return -1;
-    }
-    
-    // Create descriptor factory.
-    fsdk::IDescriptorFactoryPtr descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
-    if (!descriptorFactory) {
-        vlf::log::error("Failed to create face descriptor factory instance.");
-        return -1;
-    }
-
-    // Create CNN warper.
-    fsdk::IWarperPtr warper = fsdk::acquire(descriptorFactory->createWarper(fsdk::DT_CNN));
-    if (!warper) {
-        vlf::log::error("Failed to create face warper instance.");
-        return -1;
-    }
 
-    // Create CNN descriptor extractor.
-    fsdk::IDescriptorExtractorPtr descriptorExtractor = fsdk::acquire(descriptorFactory->createExtractor(fsdk::DT_CNN));
-    if (!descriptorExtractor) {
-        vlf::log::error("Failed to create face descriptor extractor instance.");
+    // Create SDK components.
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    fsdk::IFeatureFactoryPtr featureFactory = engineContext.getFeatureFactory();
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    fsdk::IWarperPtr warper = engineContext.getWarper();
+    fsdk::IDescriptorExtractorPtr descriptorExtractor = engineContext.getExtractor();
+    if (!detector || !featureFactory || !descriptorFactory || !warper || !descriptorExtractor)
         return -1;
-    }
+    engineContext.logTimings();
 
-    // Load image.
+    // Load image and its BGR version.
+    // Both are written in one pass over the mapped file.
     fsdk::Image image;
-    if (!image.loadFromPPM(imagePath)) {
+    fsdk::Image imageBGR;
+    if (!loadNetpbm(imagePath, &image, &imageBGR, nullptr)) {
         vlf::log::error("Failed to load image: \"%s\".", imagePath);
         return -1;
     }
-    fsdk::Image imageBGR;
-    image.convert(imageBGR, fsdk::Format::B8G8R8);
 
     vlf::log::info("Detecting faces.");
 
@@ -100,23 +73,20 @@ int main(int argc, char *argv[])
 
     // Data used for MTCNN detection.
 	fsdk::Detection detections[MaxDetections];
-	int detectionsCount(MaxDetections);
 	fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
 
     // Detect faces on the photo.
-    fsdk::ResultValue<fsdk::FSDKError, int> detectorResult =
-            detector.as<fsdk::IMTCNNDetector>()->detect(
-                    image,
-                    image.getRect(),
-                    &detections[0],
-                    &landmarks[0],
-                    detectionsCount
-            );
-    if (detectorResult.isError()) {
-        vlf::log::error("Failed tor create face detection. Reason: %s.", detectorResult.what());
+    // Detections and landmarks found on a downscaled copy are mapped back to the image.
+    const int detectionsCount = detectFaces(
+            detector,
+            image,
+            detectionMaxSide,
+            &detections[0],
+            &landmarks[0],
+            MaxDetections
+    );
+    if (detectionsCount < 0)
         return -1;
-    }
-    detectionsCount = detectorResult.getValue();
     vlf::log::info("Found %d face(s).", detectionsCount);
 
     // Feature set.
@@ -125,11 +95,17 @@ int main(int argc, char *argv[])
     // Face descriptor.
     fsdk::IDescriptorPtr descriptor(nullptr);
     
-    // Create CNN face descriptor batch.
-    fsdk::IDescriptorBatchPtr descriptorBatch =
-            fsdk::acquire(descriptorFactory->createDescriptorBatch(fsdk::DT_CNN, detectionsCount));
-    if (!descriptorBatch) {
-        vlf::log::error("Failed to create face descriptor batch instance.");
+    // Time spent on warping and extraction of all faces.
+    int extractedCount = 0;
+    double warpMs = 0.0;
+    double extractionMs = 0.0;
+
+    // Open descriptor gallery.
+    // All descriptors go into one append-only file; descriptors from previous
+    // runs are kept.
+    GalleryFile gallery;
+    if (!gallery.openOrCreate("gallery.fgl")) {
+        vlf::log::error("Failed to open descriptor gallery.");
         return -1;
     }
 
@@ -151,16 +127,22 @@ int main(int argc, char *argv[])
         }
 
         // Get warped face from detection.
+        // The face is aligned once; the descriptor is extracted from this warp
+        // instead of the full image, which would align it again.
+        Timer timer;
         fsdk::Image warp;
-        fsdk::Result<fsdk::FSDKError> warperResult = warper->warp(image, detection, featureSet, warp);
+        fsdk::Result<fsdk::FSDKError> warperResult = warper->warp(imageBGR, detection, featureSet, warp);
         if (warperResult.isError()) {
             vlf::log::error("Failed to create warp. Reason: %s.", warperResult.what());
             return -1;
         }
+        warpMs += timer.elapsedMs();
+
+        // Save warped face in RGB order.
+        fsdk::Image warpRGB;
+        warp.convert(warpRGB, fsdk::Format::R8G8B8);
+        warpRGB.saveAsPPM(("warp_" + std::to_string(detectionIndex) + ".ppm").c_str());
 
-        // Save warped face.
-        warp.saveAsPPM(("warp_" + std::to_string(detectionIndex) + ".ppm").c_str());
-        
         // Create face descriptor.
         descriptor = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
         if (!descriptor) {
@@ -170,54 +152,32 @@ int main(int argc, char *argv[])
 
         vlf::log::info("Extracting descriptor (%d/%d).", (detectionIndex + 1), detectionsCount);
 
-        // Extract face descriptor.
-        fsdk::Result<fsdk::FSDKError> descriptorExtractorResult = descriptorExtractor->extract(
-                imageBGR,
-                detection,
-                featureSet,
-                descriptor
-        );
+        // Extract face descriptor from the warp.
+        timer.reset();
+        fsdk::Result<fsdk::FSDKError> descriptorExtractorResult =
+                descriptorExtractor->extractFromWarpedImage(warp, descriptor);
         if (descriptorExtractorResult.isError()) {
             vlf::log::error("Failed to extract face descriptor. Reason: %s.", descriptorExtractorResult.what());
             return -1;
         }
+        extractionMs += timer.elapsedMs();
+        ++extractedCount;
 
         vlf::log::info("Saving descriptor (%d/%d).", (detectionIndex + 1), detectionsCount);
 
-        // Save face descriptor.
-        std::vector<uint8_t> data;
-        VectorArchive vectorArchive(data);
-        if (!descriptor->save(&vectorArchive)) {
-            vlf::log::error("Failed to save face descriptor to vector.");
-        }
-        if (!writeFile("descriptor_" + std::to_string(detectionIndex) + ".xpk", data)) {
-            vlf::log::error("Failed to save face descritpor to file.");
-            return -1;
-        }
-
-        vlf::log::info("Adding descriptor to descriptor barch (%d/%d).", (detectionIndex + 1), detectionsCount);
-
-        // Add descriptor to descriptor barch.
-        fsdk::Result<fsdk::DescriptorBatchError> descriptorBatchAddResult = descriptorBatch->add(descriptor);
-        if (descriptorBatchAddResult.isError()) {
-            vlf::log::error("Failed to add descriptor to descriptor batch.");
+        // Append face descriptor to the gallery.
+        // Gallery id is the position in the gallery, name tells where the face came from.
+        const std::string name = std::string(imagePath) + "#" + std::to_string(detectionIndex);
+        if (!gallery.append(descriptor, gallery.getCount(), name)) {
+            vlf::log::error("Failed to save face descriptor to gallery.");
             return -1;
         }
     }
 
-    vlf::log::info("Saving descriptor barch.");
-
-    // Save descriptor batch.
-    std::vector<uint8_t> data;
-    VectorArchive vectorArchive(data);
-    if (!descriptorBatch->save(&vectorArchive)) {
-        vlf::log::error("Failed to save descritpor batch to vector.");
-        return -1;
-    }
-    if (!writeFile("descriptor_batch.xpk", data)) {
-        vlf::log::error("Failed to save descritpor batch to file.");
-        return -1;
-    }
+    if (extractedCount > 0)
+        vlf::log::info("Per face: warp %.2f ms, extraction from warp %.2f ms.",
+                warpMs / extractedCount, extractionMs / extractedCount);
+    vlf::log::info("Gallery contains %d descriptor(s).", static_cast<int>(gallery.getCount()));
 
     return 0;
 }
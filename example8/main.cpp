@@ -1,91 +1,72 @@
 #include <FaceEngine.h>
 #include <vlf/Log.h>
 
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
-#include "io_util.h"
+#include "engine_context.h"
+#include "gallery.h"
 
 int main(int argc, char *argv[])
 {
     // Parse command line arguments.
     // Arguments:
-    // 1) path to a first descriptor,
-    // 2) path to a second descriptor,
-    // 3) matching threshold.
+    // 1) path to a descriptor gallery written by example7,
+    // 2) position of a first descriptor in the gallery,
+    // 3) position of a second descriptor in the gallery,
+    // 4) matching threshold.
     // If matching score is above the threshold, then both descriptors
     // belong to the same person, otherwise they belong to different persons.
-    if(argc != 4) {
-        std::cout << "Usage: "<<  argv[0] << " <descriptor1> <descriptor2> <threshold>\n"
-                " *descriptor1 - path to first descriptor\n"
-                " *descriptor2 - path to second descriptor\n"
+    if(argc != 5) {
+        std::cout << "Usage: "<<  argv[0] << " <gallery> <index1> <index2> <threshold>\n"
+                " *gallery - path to descriptor gallery (gallery.fgl from example7)\n"
+                " *index1 - position of first descriptor in the gallery\n"
+                " *index2 - position of second descriptor in the gallery\n"
                 " *threshold - similarity threshold in range (0..1]\n"
                 << std::endl;
         return -1;
     }
-    char *firstDescriptorPath = argv[1];
-    char *secondDescriptorPath = argv[2];
-    float threshold = (float)atof(argv[3]);
+    char *galleryPath = argv[1];
+    int firstIndex = atoi(argv[2]);
+    int secondIndex = atoi(argv[3]);
+    float threshold = (float)atof(argv[4]);
 
-    vlf::log::info("firstDescriptorPath: \"%s\".", firstDescriptorPath);
-    vlf::log::info("secondDescriptorPath: \"%s\".", secondDescriptorPath);
+    vlf::log::info("galleryPath: \"%s\".", galleryPath);
+    vlf::log::info("indices: %d, %d.", firstIndex, secondIndex);
     vlf::log::info("threshold: %1.3f.", threshold);
 
-    // Create config FaceEngine root SDK object.
-    fsdk::ISettingsProviderPtr config;
-    config = fsdk::acquire(fsdk::createSettingsProvider("./data/faceengine.conf"));
-    if (!config) {
-        vlf::log::error("Failed to load face engine config instance.");
+    // Create engine context.
+    EngineContext::Settings settings;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
         return -1;
-    }
-    config->setValue("DescriptorFactory::Settings", "model", 45);
 
-    // Create FaceEngine root SDK object.
-    fsdk::IFaceEnginePtr faceEngine = fsdk::acquire(fsdk::createFaceEngine(fsdk::CFF_OMIT_SETTINGS));
-    if (!faceEngine) {
-        vlf::log::error("Failed to create face engine instance.");
+    // Create SDK components.
+    fsdk::IDescriptorFactoryPtr descriptorFactory = engineContext.getDescriptorFactory();
+    fsdk::IDescriptorMatcherPtr descriptorMatcher = engineContext.getMatcher();
+    if (!descriptorFactory || !descriptorMatcher)
         return -1;
-    }
-    faceEngine->setSettingsProvider(config);
-    faceEngine->setDataDirectory("./data/");
+    engineContext.logTimings();
 
-    // Create descriptor factory.
-    fsdk::IDescriptorFactoryPtr descriptorFactory = fsdk::acquire(faceEngine->createDescriptorFactory());
-    if (!descriptorFactory) {
-        vlf::log::error("Failed to create face descriptor factory instance.");
+    // Load face descriptors.
+    // The gallery is mapped once and all of its descriptors are loaded into a batch.
+    fsdk::IDescriptorBatchPtr descriptorBatch;
+    std::vector<GalleryFile::Entry> entries;
+    if (!GalleryFile::load(galleryPath, descriptorFactory, descriptorBatch, entries))
         return -1;
-    }
-
-    // Create CNN descriptor matcher.
-    fsdk::IDescriptorMatcherPtr descriptorMatcher =
-            fsdk::acquire(descriptorFactory->createMatcher(fsdk::DT_CNN));
-    if (!descriptorMatcher) {
-        vlf::log::error("Failed to create face descriptor matcher instance.");
+    const int galleryCount = static_cast<int>(entries.size());
+    if (firstIndex < 0 || firstIndex >= galleryCount || secondIndex < 0 || secondIndex >= galleryCount) {
+        vlf::log::error("Gallery holds %d descriptor(s), indices are out of range.", galleryCount);
         return -1;
     }
+    vlf::log::info("First descriptor: \"%s\".", entries[firstIndex].name.c_str());
+    vlf::log::info("Second descriptor: \"%s\".", entries[secondIndex].name.c_str());
 
-    // Create CNN face descriptors.
-    fsdk::IDescriptorPtr descriptor1 = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
-    fsdk::IDescriptorPtr descriptor2 = fsdk::acquire(descriptorFactory->createDescriptor(fsdk::DT_CNN));
+    fsdk::IDescriptorPtr descriptor1 = fsdk::acquire(descriptorBatch->getDescriptorSlow(firstIndex));
+    fsdk::IDescriptorPtr descriptor2 = fsdk::acquire(descriptorBatch->getDescriptorSlow(secondIndex));
     if (!descriptor1 || !descriptor2) {
-        vlf::log::error("Failed to create face descriptors instance.");
-        return -1;
-    }
-
-    // Load face descriptors.
-    std::vector<uint8_t> data;
-
-    data = std::move(readFile(firstDescriptorPath));
-    VectorArchive vectorArchive1(data);
-    if (!descriptor1->load(&vectorArchive1)) {
-        vlf::log::error("Failed to load face descriptor to vector.");
-        return -1;
-    }
-
-    data = std::move(readFile(secondDescriptorPath));
-    VectorArchive vectorArchive2(data);
-    if (!descriptor2->load(&vectorArchive2)) {
-        vlf::log::error("Failed to load face descriptor to vector.");
+        vlf::log::error("Failed to get face descriptors from the gallery.");
         return -1;
     }
 
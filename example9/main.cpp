@@ -0,0 +1,118 @@
+#include <FaceEngine.h>
+#include <vlf/Log.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "command_line.h"
+#include "engine_context.h"
+#include "face_tracker.h"
+#include "netpbm.h"
+
+// Helper function to load frames list.
+bool loadFramesList(
+        const char *listPath,
+        std::vector<std::string> &framesList
+);
+
+int main(int argc, char *argv[])
+{
+    // Parse command line arguments.
+    // Arguments:
+    // 1) path to a frames list, one PPM image path per line in playback order.
+    // Options:
+    // --interval <frames> - run full frame detection every given number of frames,
+    // --roi-scale <factor> - side of the search area around a face relative to the face,
+    // --detect-max-side <pixels> - run full frame detection on a copy downscaled to the given larger side.
+    FaceTracker::Settings trackerSettings;
+    CommandLine commandLine;
+    commandLine.addOption("--interval", trackerSettings.detectionInterval);
+    commandLine.addOption("--roi-scale", trackerSettings.roiScale);
+    commandLine.addDetectionMaxSide(trackerSettings.detectionMaxSide);
+    const bool validOptions = commandLine.parse(argc, argv);
+    const std::vector<char*> &arguments = commandLine.getArguments();
+    if (!validOptions || trackerSettings.detectionInterval < 1 || trackerSettings.roiScale < 1.f ||
+        arguments.size() != 1) {
+        std::cout << "USAGE: " << argv[0] << " <frames> [--interval <frames>] [--roi-scale <factor>]"
+                " [--detect-max-side <pixels>]\n"
+                " *frames - path to a list of PPM frames, one path per line\n"
+                " *interval - frames between full frame detections (default: 10, 1 - every frame)\n"
+                " *roi-scale - search area side relative to the face (default: 2)\n"
+                " *detect-max-side - larger side of the image used for full detection (default: full resolution)\n"
+                << std::endl;
+        return -1;
+    }
+    char *framesPath = arguments[0];
+
+    vlf::log::info("framesPath: \"%s\".", framesPath);
+    vlf::log::info("interval: %d.", trackerSettings.detectionInterval);
+    vlf::log::info("roi scale: %.2f.", trackerSettings.roiScale);
+
+    // Create engine context.
+    EngineContext::Settings settings;
+    EngineContext engineContext;
+    if (!engineContext.init(settings))
+        return -1;
+
+    // Create SDK components.
+    fsdk::IDetectorPtr detector = engineContext.getDetector();
+    if (!detector)
+        return -1;
+    engineContext.logTimings();
+
+    std::vector<std::string> framesList;
+    if (!loadFramesList(framesPath, framesList))
+        return -1;
+
+    // Face tracker.
+    // It detects the whole frame only every few frames or when a face is lost
+    // and otherwise searches for every face near its previous position.
+    FaceTracker tracker(detector, trackerSettings);
+
+    enum { MaxDetections = 32 };
+    fsdk::Detection detections[MaxDetections];
+    fsdk::IMTCNNDetector::Landmarks landmarks[MaxDetections];
+
+    for (const std::string &framePath : framesList) {
+        fsdk::Image frame;
+        if (!loadNetpbm(framePath.c_str(), fsdk::Format::R8G8B8, frame)) {
+            vlf::log::error("Failed to load image: \"%s\".", framePath.c_str());
+            return -1;
+        }
+
+        const int detectionsCount = tracker.track(frame, &detections[0], &landmarks[0], MaxDetections);
+        if (detectionsCount < 0)
+            return -1;
+
+        std::cout << "Frame \"" << framePath << "\": " << detectionsCount << " face(s)\n";
+        for (int detectionIndex = 0; detectionIndex < detectionsCount; ++detectionIndex) {
+            const fsdk::Detection &detection = detections[detectionIndex];
+            std::cout << "  Rect: x=" << detection.rect.x << " y=" << detection.rect.y
+                    << " w=" << detection.rect.width << " h=" << detection.rect.height
+                    << " score=" << detection.score << "\n";
+        }
+    }
+    std::cout << std::flush;
+
+    tracker.logStats();
+
+    return 0;
+}
+
+bool loadFramesList(
+        const char *listPath,
+        std::vector<std::string> &framesList
+) {
+    std::ifstream listFile(listPath);
+    if (!listFile) {
+        vlf::log::error("Failed to open file: %s.", listPath);
+        return false;
+    }
+    std::string framePath;
+    while (listFile >> framePath)
+        framesList.push_back(framePath);
+
+    return true;
+}